@@ -0,0 +1,305 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/dom/node.hpp>
+#include <ftxui/screen/screen.hpp>
+
+#include "game/board_view.h"
+#include "sim/definitions.h"
+#include "sim/simulation.h"
+#include "sim/snapshot.h"
+#include "sim/worker_pool.h"
+
+// Per-phase cost of one simulation tick on synthetic worlds. Each benchmark
+// takes {enemies, towers}; worlds are rebuilt outside the timed region so
+// every iteration measures the same state.
+
+namespace {
+
+// Open cells within two steps of the path, then the rest of the board.
+std::vector<Position> TowerSites(const Simulation &sim) {
+  std::vector<Position> near;
+  std::vector<Position> far;
+  const auto &mask = sim.path_mask();
+  for (int y = 0; y < sim.board().height; ++y) {
+    for (int x = 0; x < sim.board().width; ++x) {
+      if (mask.Test(x, y)) {
+        continue;
+      }
+      bool close = false;
+      for (int dy = -2; dy <= 2 && !close; ++dy) {
+        for (int dx = -2; dx <= 2 && !close; ++dx) {
+          const int nx = x + dx;
+          const int ny = y + dy;
+          close = mask.Test(nx, ny);
+        }
+      }
+      (close ? near : far).push_back({x, y});
+    }
+  }
+  near.insert(near.end(), far.begin(), far.end());
+  return near;
+}
+
+// Places up to `count` towers cycling through `types`, spread evenly along
+// the path; every second tower is upgraded. Dev mode covers the cost.
+void PlaceTowers(Simulation &sim, int count,
+                 const std::vector<Tower::Type> &types) {
+  const auto sites = TowerSites(sim);
+  const size_t stride =
+      std::max<size_t>(1, sites.size() / static_cast<size_t>(count));
+  int placed = 0;
+  for (size_t offset = 0; offset < stride && placed < count; ++offset) {
+    for (size_t i = offset; i < sites.size() && placed < count; i += stride) {
+      const auto type = types[static_cast<size_t>(placed) % types.size()];
+      auto result = sim.PlaceTower(type, sites[i]);
+      if (result == PlaceResult::CatatonicConflict) {
+        result = sim.PlaceTower(Tower::Type::Default, sites[i]);
+      }
+      if (result != PlaceResult::Placed) {
+        continue;
+      }
+      if (placed % 2 == 1) {
+        sim.UpgradeTowerAt(sites[i]);
+      }
+      ++placed;
+    }
+  }
+}
+
+// Spreads enemies evenly along the path with enough hp to survive the run.
+void AddEnemies(Simulation &sim, int count) {
+  constexpr std::array<EnemyType, 4> kTypes = {
+      EnemyType::Mouse, EnemyType::Rat, EnemyType::BigRat, EnemyType::Dog};
+  const float length = static_cast<float>(sim.path().size() - 1);
+  for (int i = 0; i < count; ++i) {
+    Enemy e;
+    e.path_progress =
+        length * static_cast<float>(i) / static_cast<float>(count);
+    e.hp = 1 << 20;
+    e.max_hp = e.hp;
+    e.speed = 1.0F;
+    e.type = kTypes[static_cast<size_t>(i) % kTypes.size()];
+    sim.AddEnemy(e);
+  }
+}
+
+Simulation MakeWorld(int enemies, int towers,
+                     const std::vector<Tower::Type> &types) {
+  Simulation sim(/*dev_mode=*/true);
+  for (const auto &def : SortedDefs()) {
+    sim.TryUnlock(def.type);
+  }
+  PlaceTowers(sim, towers, types);
+  AddEnemies(sim, enemies);
+  // Everything ready to fire on the measured tick.
+  for (auto &t : sim.towers()) {
+    t.cooldown = 0.0F;
+  }
+  return sim;
+}
+
+Simulation MakeMixedWorld(const benchmark::State &state) {
+  return MakeWorld(static_cast<int>(state.range(0)),
+                   static_cast<int>(state.range(1)),
+                   {Tower::Type::Default, Tower::Type::Thunder,
+                    Tower::Type::Fat, Tower::Type::Catatonic,
+                    Tower::Type::Galactic});
+}
+
+void SetCounters(benchmark::State &state, const Simulation &sim) {
+  state.counters["enemies"] = static_cast<double>(sim.enemies().size());
+  state.counters["towers"] = static_cast<double>(sim.towers().size());
+}
+
+// Runs `phase` once per iteration on a fresh copy of `base`.
+template <typename Phase>
+void RunPhase(benchmark::State &state, const Simulation &base, Phase phase) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    Simulation sim = base;
+    state.ResumeTiming();
+    phase(sim);
+    benchmark::DoNotOptimize(sim.enemies().hp.data());
+    benchmark::ClobberMemory();
+  }
+  SetCounters(state, base);
+}
+
+void BM_TowersAct(benchmark::State &state) {
+  const Simulation base = MakeMixedWorld(state);
+  RunPhase(state, base, [](Simulation &sim) { sim.TowersAct(); });
+}
+
+// TowersAct with planning spread over one thread per core.
+void BM_TowersActPooled(benchmark::State &state) {
+  static WorkerPool pool(0);
+  Simulation base = MakeMixedWorld(state);
+  base.SetWorkerPool(&pool);
+  RunPhase(state, base, [](Simulation &sim) { sim.TowersAct(); });
+  state.counters["threads"] = pool.size();
+}
+
+void BM_MoveEnemies(benchmark::State &state) {
+  const Simulation base = MakeMixedWorld(state);
+  RunPhase(state, base, [](Simulation &sim) { sim.MoveEnemies(); });
+}
+
+void BM_ResolveProjectiles(benchmark::State &state) {
+  Simulation base = MakeMixedWorld(state);
+  // One projectile per tower, already at its target's cell.
+  const size_t count = base.enemies().size();
+  const size_t shots = base.towers().size();
+  for (size_t i = 0; i < shots && count > 0; ++i) {
+    const auto cell = base.EnemyCellAt(i * count / shots);
+    Projectile p;
+    p.x = static_cast<float>(cell.x);
+    p.y = static_cast<float>(cell.y);
+    p.target = cell;
+    p.damage = 2;
+    base.AddProjectile(p);
+  }
+  RunPhase(state, base, [](Simulation &sim) { sim.ResolveProjectiles(); });
+}
+
+void BM_FireGalactic(benchmark::State &state) {
+  const Simulation base =
+      MakeWorld(static_cast<int>(state.range(0)),
+                static_cast<int>(state.range(1)), {Tower::Type::Galactic});
+  // Every galactic tower fires once at the enemy nearest to it, picked
+  // here so the timed region holds nothing but the shots.
+  std::vector<size_t> targets;
+  targets.reserve(base.towers().size());
+  for (const auto &t : base.towers()) {
+    const auto center = TowerCenter(t);
+    size_t best = 0;
+    for (size_t i = 1; i < base.enemies().size(); ++i) {
+      if (DistanceSquared(center, base.EnemyCellAt(i)) <
+          DistanceSquared(center, base.EnemyCellAt(best))) {
+        best = i;
+      }
+    }
+    targets.push_back(best);
+  }
+  RunPhase(state, base, [&targets](Simulation &sim) {
+    const auto &towers = sim.towers();
+    for (size_t k = 0; k < towers.size(); ++k) {
+      sim.FireGalactic(towers[k], targets[k]);
+    }
+  });
+}
+
+void BM_HandleKittyAttacks(benchmark::State &state) {
+  const Simulation base =
+      MakeWorld(static_cast<int>(state.range(0)),
+                static_cast<int>(state.range(1)), {Tower::Type::Kitty});
+  RunPhase(state, base, [](Simulation &sim) { sim.HandleKittyAttacks(); });
+}
+
+void BM_RenderBoard(benchmark::State &state) {
+  Simulation sim = MakeMixedWorld(state);
+  // A few ticks so projectiles, beams and highlights are on screen too.
+  for (int i = 0; i < 30; ++i) {
+    sim.Tick();
+  }
+  const BoardView view{};
+  BoardRenderer renderer;
+  for (auto _ : state) {
+    auto board = renderer.Render(sim, view);
+    auto screen = ftxui::Screen::Create(ftxui::Dimension::Fit(board));
+    ftxui::Render(screen, board);
+    benchmark::DoNotOptimize(screen.PixelAt(0, 0));
+  }
+  SetCounters(state, sim);
+}
+
+// One map on a side x side board with a straight path across the middle.
+const Definitions &SquareBoard(int side) {
+  static std::map<int, std::unique_ptr<Definitions>> boards;
+  auto &defs = boards[side];
+  if (defs == nullptr) {
+    std::istringstream in(
+        "{\"maps\": [{\"width\": " + std::to_string(side) +
+        ", \"height\": " + std::to_string(side) + ", \"path\": [[0, " +
+        std::to_string(side / 2) + "], [" + std::to_string(side - 1) +
+        ", " + std::to_string(side / 2) + "]]}]}");
+    defs = ParseDefinitions(in, "bench");
+  }
+  return *defs;
+}
+
+// An 80x40 viewport into boards of growing size holding the same world;
+// the cost should stay flat as the board grows.
+void BM_RenderViewport(benchmark::State &state) {
+  const int side = static_cast<int>(state.range(0));
+  Simulation sim(/*dev_mode=*/true, SquareBoard(side));
+  PlaceTowers(sim, 100, {Tower::Type::Default, Tower::Type::Galactic});
+  AddEnemies(sim, 1000);
+  for (int i = 0; i < 30; ++i) {
+    sim.Tick();
+  }
+  BoardView view{};
+  view.viewport = {80, 40};
+  view.cursor = {side / 2, side / 2};
+  view.camera = {side / 2 - 40, side / 2 - 20};
+  BoardRenderer renderer;
+  MinimapRenderer minimap;
+  for (auto _ : state) {
+    auto board = ftxui::hbox(
+        {renderer.Render(sim, view), minimap.Render(sim, view, {32, 12})});
+    auto screen = ftxui::Screen::Create(ftxui::Dimension::Fit(board));
+    ftxui::Render(screen, board);
+    benchmark::DoNotOptimize(screen.PixelAt(0, 0));
+  }
+  SetCounters(state, sim);
+  state.counters["side"] = side;
+}
+
+// Whole ticks a little way into the wave after a late-game save state, the
+// part of a full run that dominates its cost. Reads the snapshot named by
+// CATCAT_BENCH_SNAPSHOT (the bench_json target makes one at wave 95).
+void BM_TickLateGame(benchmark::State &state) {
+  const char *path = std::getenv("CATCAT_BENCH_SNAPSHOT");
+  Simulation base;
+  if (path == nullptr || !LoadSnapshotFile(base, path)) {
+    state.SkipWithError("set CATCAT_BENCH_SNAPSHOT to a save state");
+    return;
+  }
+  base.StartWave();
+  for (int i = 0; i < 300; ++i) {
+    base.Tick();
+  }
+  RunPhase(state, base, [](Simulation &sim) { sim.Tick(); });
+  state.counters["wave"] = base.wave();
+}
+
+void WorldSizes(benchmark::internal::Benchmark *b) {
+  b->ArgNames({"enemies", "towers"});
+  b->ArgsProduct({{10, 100, 1000, 10000}, {10, 100, 500}});
+  b->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_TowersAct)->Apply(WorldSizes);
+BENCHMARK(BM_TowersActPooled)->Apply(WorldSizes);
+BENCHMARK(BM_MoveEnemies)->Apply(WorldSizes);
+BENCHMARK(BM_ResolveProjectiles)->Apply(WorldSizes);
+BENCHMARK(BM_FireGalactic)->Apply(WorldSizes);
+BENCHMARK(BM_HandleKittyAttacks)->Apply(WorldSizes);
+BENCHMARK(BM_RenderBoard)->Apply(WorldSizes);
+BENCHMARK(BM_RenderViewport)
+    ->ArgName("side")
+    ->RangeMultiplier(4)
+    ->Range(128, 2048)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TickLateGame)->Unit(benchmark::kMicrosecond);
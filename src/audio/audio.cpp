@@ -1,9 +1,18 @@
 #include "audio.hpp"
 
+#include <array>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cmath>
+#include <cstdint>
 #include <memory>
 #include <algorithm>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -13,11 +22,37 @@
 #include <nlohmann/json.hpp>
 #include <fstream>
 
+// An event file decoded once into engine-format f32 PCM. Voices read it in
+// place, so playing an event never touches the filesystem or a decoder.
+struct PcmClip {
+  struct Free {
+    void operator()(void* frames) const { ma_free(frames, nullptr); }
+  };
+  std::unique_ptr<void, Free> frames;
+  ma_uint64 frame_count = 0;
+};
+
 struct EventEntry {
-  std::vector<std::string> files;
+  std::vector<size_t> clips;  // indices into Impl::clips_
   float volume = 1.0F;
 };
 
+// One preallocated sound reading a shared clip through its own cursor.
+struct Voice {
+  ma_audio_buffer_ref ref{};
+  ma_sound sound{};
+  uint64_t started = 0;  // play serial, for stealing the oldest
+  size_t event = kSfxEventCount;  // SfxEvent last played
+};
+
+// How many times each event was requested in one tick.
+using SfxBatch = std::array<uint16_t, kSfxEventCount>;
+
+constexpr size_t kVoiceCount = 32;
+constexpr size_t kMaxVoicesPerEvent = 4;  // further plays restart the oldest
+constexpr float kMaxBatchGain = 2.0F;     // cap on a collapsed batch's boost
+constexpr size_t kMaxQueuedBatches = 8;   // beyond this, ticks are merged
+
 struct MusicEntry {
   std::vector<std::string> files;
   std::vector<std::string> intro_files;
@@ -28,6 +63,52 @@ struct MusicEntry {
   float intro_end_sec = -1.0F;   // optional slice end
 };
 
+// One map's music, loaded ahead of when it plays. Both sounds start
+// decoding on miniaudio's job threads as soon as the deck is created, so a
+// deck prefetched during the last waves of a map is ready to start the
+// moment the map changes. Must not move once loading has begun.
+struct MusicDeck {
+  MusicDeck() { ma_fence_init(&loaded); }
+  ~MusicDeck() {
+    ma_fence_wait(&loaded);  // the job threads still hold the fence
+    if (intro_loaded) ma_sound_uninit(&intro);
+    if (main_loaded) ma_sound_uninit(&main);
+    ma_fence_uninit(&loaded);
+  }
+  MusicDeck(const MusicDeck&) = delete;
+  MusicDeck& operator=(const MusicDeck&) = delete;
+
+  // Whether both sounds have finished decoding, without waiting on the
+  // fence; a deck is only started, or destroyed, once this holds.
+  bool Decoded() const {
+    const auto done = [](const ma_sound& sound) {
+      auto* source = static_cast<ma_resource_manager_data_source*>(
+          ma_sound_get_data_source(&sound));
+      return ma_resource_manager_data_source_result(source) != MA_BUSY;
+    };
+    return (!intro_loaded || done(intro)) && (!main_loaded || done(main));
+  }
+
+  // Starts the loop once; safe from the intro's end callback.
+  void StartMain() {
+    if (main_loaded && !main_started.exchange(true)) ma_sound_start(&main);
+  }
+
+  int map = INT_MIN;
+  ma_fence loaded{};  // released when both sounds are fully decoded
+  ma_sound intro{};
+  ma_sound main{};
+  bool intro_loaded = false;
+  bool main_loaded = false;
+  bool shared_intro = false;  // the intro is a slice of the main track
+  std::atomic<bool> main_started{false};
+  float gain = 1.0F;
+  float loop_start_sec = -1.0F;
+  float loop_end_sec = -1.0F;
+  float intro_start_sec = -1.0F;
+  float intro_end_sec = -1.0F;
+};
+
 class AudioSystem::Impl {
  public:
   Impl() = default;
@@ -40,100 +121,134 @@ class AudioSystem::Impl {
         return false;
       }
       engine_init_ = true;
+      InitVoices();
+      sfx_thread_ = std::thread([this] { SfxLoop(); });
     }
     LoadConfig();
     return true;
   }
 
+  // Runs on the audio thread, so the loop starts without waiting a frame.
   static void IntroEnded(void* user_data, ma_sound* /*sound*/) {
     if (user_data == nullptr) return;
-    static_cast<Impl*>(user_data)->OnIntroEnded();
+    static_cast<MusicDeck*>(user_data)->StartMain();
   }
 
   void Shutdown() {
-    CleanupSounds(true);
     StopMusic();
+    next_music_.reset();
+    pending_music_.reset();
+    retired_music_.clear();
     if (engine_init_) {
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stop_ = true;
+      }
+      queue_wake_.notify_one();
+      sfx_thread_.join();
+      UninitVoices();
       ma_engine_uninit(&engine_);
       engine_init_ = false;
     }
   }
 
   void Update() {
-    if (intro_loaded_) {
-      if (ma_sound_is_playing(&intro_sound_) == MA_FALSE) {
-        OnIntroEnded();
-      }
+    EndTick();  // events queued by input between ticks
+    // Off the frame that changed tracks, and never while still decoding.
+    std::erase_if(retired_music_, [](const std::unique_ptr<MusicDeck>& deck) {
+      return deck->Decoded();
+    });
+    if (pending_music_ && pending_music_->Decoded()) {
+      StopMusic();
+      StartDeck(*pending_music_);
+      music_ = std::move(pending_music_);
     }
-    if (music_loaded_) {
-      if (ma_sound_is_playing(&music_sound_) == MA_FALSE && music_enabled_) {
-        ma_sound_start(&music_sound_);
-      }
+    if (!music_) return;
+    MusicDeck& deck = *music_;
+    if (deck.intro_loaded && ma_sound_is_playing(&deck.intro) == MA_FALSE) {
+      deck.StartMain();
+      ma_sound_uninit(&deck.intro);
+      deck.intro_loaded = false;
+    }
+    if (deck.main_started && ma_sound_is_playing(&deck.main) == MA_FALSE && music_enabled_) {
+      ma_sound_start(&deck.main);
     }
   }
 
-  void ReloadConfig() { LoadConfig(); }
+  void ReloadConfig() {
+    if (engine_init_) LoadConfig();
+  }
 
-  void PlayEvent(const std::string& name) {
+  void PlayEvent(SfxEvent event) {
     if (!engine_init_ || !sfx_enabled_) return;
-    auto it = events_.find(name);
-    if (it == events_.end() || it->second.files.empty()) return;
-    const auto& entry = it->second;
-    const auto& list = entry.files;
-    const size_t idx =
-        list.size() == 1 ? 0U : static_cast<size_t>(dist_(rng_) % static_cast<int>(list.size()));
-    const float vol = std::clamp(entry.volume, 0.0F, 2.0F);
-    CleanupSounds(false);
-
-    auto sound = std::make_unique<ma_sound>();
-    if (ma_sound_init_from_file(&engine_, list[idx].c_str(), MA_SOUND_FLAG_ASYNC, nullptr, nullptr,
-                                sound.get()) != MA_SUCCESS) {
-      return;
+    uint16_t& count = pending_[static_cast<size_t>(event)];
+    if (count < UINT16_MAX) ++count;
+    pending_any_ = true;
+  }
+
+  void EndTick() {
+    if (!pending_any_) return;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      if (queue_.size() < kMaxQueuedBatches) {
+        queue_.push_back(pending_);
+      } else {
+        // The audio thread is behind; fold this tick into the newest batch.
+        SfxBatch& last = queue_.back();
+        for (size_t i = 0; i < kSfxEventCount; ++i) {
+          last[i] = static_cast<uint16_t>(std::min<int>(last[i] + pending_[i], UINT16_MAX));
+        }
+      }
     }
-    ma_sound_set_volume(sound.get(), sfx_volume_ * vol);
-    ma_sound_start(sound.get());
-    active_sounds_.push_back(std::move(sound));
+    queue_wake_.notify_one();
+    pending_.fill(0);
+    pending_any_ = false;
   }
 
+  // Plays map_index's music, from the prefetched deck when it is the one
+  // asked for and loading it on the spot otherwise. A deck still decoding
+  // is left to Update(), and the current track plays on until then, so
+  // the game thread never waits on a decode.
   void SetMusicForMap(int map_index) {
     if (!engine_init_) return;
-    StopMusic();
-    if (!music_enabled_) return;
-    current_music_path_.clear();
-    current_loop_start_sec_ = -1.0F;
-    current_loop_end_sec_ = -1.0F;
-    current_intro_start_sec_ = -1.0F;
-    current_intro_end_sec_ = -1.0F;
-    current_initial_seek_sec_ = -1.0F;
-    shared_intro_ = false;
-    const auto it = music_.find(map_index);
-    if (it == music_.end() || it->second.files.empty()) return;
-    const auto& tracks = it->second.files;
-    const size_t idx = tracks.size() == 1
-                           ? 0U
-                           : static_cast<size_t>(dist_(rng_) % static_cast<int>(tracks.size()));
-    const std::string& path = tracks[idx];
-    current_music_path_ = path;
-    current_loop_start_sec_ = it->second.loop_start_sec;
-    current_loop_end_sec_ = it->second.loop_end_sec;
-    current_intro_start_sec_ = it->second.intro_start_sec;
-    current_intro_end_sec_ = it->second.intro_end_sec;
-    current_music_gain_ = std::clamp(it->second.volume, 0.0F, 2.0F);
-    if (!it->second.intro_files.empty()) {
-      const auto& intro_list = it->second.intro_files;
-      const size_t intro_idx =
-          intro_list.size() == 1
-              ? 0U
-              : static_cast<size_t>(dist_(rng_) % static_cast<int>(intro_list.size()));
-      const std::string& intro_path = intro_list[intro_idx];
-      if (intro_path == current_music_path_) {
-        shared_intro_ = true;
-        current_initial_seek_sec_ = current_intro_start_sec_ >= 0.0F ? current_intro_start_sec_ : 0.0F;
-      } else if (InitIntro(intro_path)) {
-        return;
-      }
+    if (pending_music_ && pending_music_->map == map_index && music_enabled_) {
+      return;  // already on its way
+    }
+    Retire(std::move(pending_music_));
+    if (!music_enabled_) {
+      StopMusic();
+      return;
+    }
+    std::unique_ptr<MusicDeck> deck;
+    if (next_music_ && next_music_->map == map_index) {
+      deck = std::move(next_music_);
+    } else {
+      deck = LoadDeck(map_index);
+    }
+    if (!deck) {
+      StopMusic();
+      return;
+    }
+    if (!deck->Decoded()) {
+      pending_music_ = std::move(deck);
+      return;
     }
-    StartMainMusic();
+    StopMusic();
+    StartDeck(*deck);
+    music_ = std::move(deck);
+  }
+
+  // Whether a track asked for is still decoding; Update() starts it.
+  bool MusicLoading() const { return pending_music_ != nullptr; }
+
+  // Starts loading map_index's music in the background for the next
+  // SetMusicForMap(); repeated calls for the same map do nothing.
+  void PrefetchMusicForMap(int map_index) {
+    if (!engine_init_ || !music_enabled_) return;
+    if (next_music_ && next_music_->map == map_index) return;
+    if (music_ && music_->map == map_index) return;
+    Retire(std::move(next_music_));
+    next_music_ = LoadDeck(map_index);
   }
 
   void ToggleSfx() { sfx_enabled_ = !sfx_enabled_; }
@@ -141,6 +256,7 @@ class AudioSystem::Impl {
     music_enabled_ = !music_enabled_;
     if (!music_enabled_) {
       StopMusic();
+      Retire(std::move(pending_music_));
     }
   }
 
@@ -159,8 +275,13 @@ class AudioSystem::Impl {
   }
 
   void LoadConfig() {
-    events_.clear();
-    music_.clear();
+    std::lock_guard<std::mutex> voice_lock(voice_mutex_);
+    StopVoices();
+    events_ = {};
+    clips_.clear();
+    music_entries_.clear();
+    Retire(std::move(next_music_));
+    Retire(std::move(pending_music_));
     if (config_path_.empty()) return;
     std::ifstream in(config_path_);
     if (!in) return;
@@ -178,27 +299,39 @@ class AudioSystem::Impl {
       if (v.contains("sfx")) sfx_volume_ = std::clamp(v["sfx"].get<float>(), 0.0F, 1.0F);
       if (v.contains("music")) music_volume_ = std::clamp(v["music"].get<float>(), 0.0F, 1.0F);
       ma_engine_set_volume(&engine_, sfx_volume_);
-      if (music_loaded_) ma_sound_set_volume(&music_sound_, music_volume_);
+      if (music_ && music_->main_loaded) {
+        ma_sound_set_volume(&music_->main, music_volume_ * music_->gain);
+      }
     }
     if (j.contains("events")) {
+      std::unordered_map<std::string, size_t> clip_index;  // path -> clip
       for (auto it = j["events"].begin(); it != j["events"].end(); ++it) {
+        const auto named =
+            std::find(kSfxEventNames.begin(), kSfxEventNames.end(), std::string_view(it.key()));
+        if (named == kSfxEventNames.end()) continue;  // nothing plays it
         EventEntry entry;
         const auto& v = it.value();
-          if (v.is_array()) {
-            for (const auto& f : v) {
-            entry.files.push_back(ResolvePath(base_dir, f.get<std::string>()));
-            }
-          } else if (v.is_object()) {
-            if (v.contains("files")) {
-              for (const auto& f : v["files"]) {
-              entry.files.push_back(ResolvePath(base_dir, f.get<std::string>()));
-              }
-            }
-            if (v.contains("volume") && v["volume"].is_number()) {
+        const auto add_file = [&](const nlohmann::json& f) {
+          const std::string path = ResolvePath(base_dir, f.get<std::string>());
+          const auto cached = clip_index.find(path);
+          if (cached != clip_index.end()) {
+            entry.clips.push_back(cached->second);
+          } else if (DecodeClip(path)) {
+            clip_index.emplace(path, clips_.size() - 1);
+            entry.clips.push_back(clips_.size() - 1);
+          }
+        };
+        if (v.is_array()) {
+          for (const auto& f : v) add_file(f);
+        } else if (v.is_object()) {
+          if (v.contains("files")) {
+            for (const auto& f : v["files"]) add_file(f);
+          }
+          if (v.contains("volume") && v["volume"].is_number()) {
             entry.volume = std::clamp(v["volume"].get<float>(), 0.0F, 2.0F);
           }
         }
-        events_[it.key()] = std::move(entry);
+        events_[static_cast<size_t>(named - kSfxEventNames.begin())] = std::move(entry);
       }
     }
     if (j.contains("music")) {
@@ -253,85 +386,117 @@ class AudioSystem::Impl {
             entry.intro_end_sec = v["intro_end"].get<float>();
           }
         }
-        music_[map_idx] = std::move(entry);
+        music_entries_[map_idx] = std::move(entry);
       }
     }
   }
 
+  // Silences the playing deck; Update() releases it.
   void StopMusic() {
-    if (intro_loaded_) {
-      ma_sound_uninit(&intro_sound_);
-      intro_loaded_ = false;
-    }
-    if (music_loaded_) {
-      ma_sound_uninit(&music_sound_);
-      music_loaded_ = false;
+    if (!music_) return;
+    if (music_->intro_loaded) ma_sound_stop(&music_->intro);
+    if (music_->main_loaded) ma_sound_stop(&music_->main);
+    Retire(std::move(music_));
+  }
+
+  // Hands a deck no longer wanted to Update(), which frees it once it has
+  // decoded; freeing it sooner would wait on its fence.
+  void Retire(std::unique_ptr<MusicDeck> deck) {
+    if (deck) retired_music_.push_back(std::move(deck));
+  }
+
+  // Picks map_index's tracks and starts decoding them; nullptr if the map
+  // has no music.
+  std::unique_ptr<MusicDeck> LoadDeck(int map_index) {
+    const auto it = music_entries_.find(map_index);
+    if (it == music_entries_.end() || it->second.files.empty()) return nullptr;
+    const MusicEntry& entry = it->second;
+    auto deck = std::make_unique<MusicDeck>();
+    deck->map = map_index;
+    deck->gain = std::clamp(entry.volume, 0.0F, 2.0F);
+    deck->loop_start_sec = entry.loop_start_sec;
+    deck->loop_end_sec = entry.loop_end_sec;
+    deck->intro_start_sec = entry.intro_start_sec;
+    deck->intro_end_sec = entry.intro_end_sec;
+    const auto& tracks = entry.files;
+    const size_t idx = tracks.size() == 1
+                           ? 0U
+                           : static_cast<size_t>(dist_(rng_) % static_cast<int>(tracks.size()));
+    const std::string& path = tracks[idx];
+    // Fully decoded so loops are seamless; decoding runs on the job threads.
+    constexpr ma_uint32 kMusicFlags = MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_ASYNC;
+    if (!entry.intro_files.empty()) {
+      const auto& intro_list = entry.intro_files;
+      const size_t intro_idx =
+          intro_list.size() == 1
+              ? 0U
+              : static_cast<size_t>(dist_(rng_) % static_cast<int>(intro_list.size()));
+      const std::string& intro_path = intro_list[intro_idx];
+      if (intro_path == path) {
+        deck->shared_intro = true;
+      } else {
+        deck->intro_loaded = ma_sound_init_from_file(&engine_, intro_path.c_str(), kMusicFlags,
+                                                     nullptr, &deck->loaded,
+                                                     &deck->intro) == MA_SUCCESS;
+      }
     }
+    deck->main_loaded = ma_sound_init_from_file(&engine_, path.c_str(), kMusicFlags, nullptr,
+                                                &deck->loaded, &deck->main) == MA_SUCCESS;
+    return deck;
   }
 
-  bool InitIntro(const std::string& path) {
-    constexpr ma_uint32 kFlags = MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_ASYNC;
-    if (ma_sound_init_from_file(&engine_, path.c_str(), kFlags, nullptr, nullptr,
-                                &intro_sound_) != MA_SUCCESS) {
-      intro_loaded_ = false;
-      return false;
+  // Applies the deck's slice and loop points, then starts its intro, or its
+  // loop when there is no separate intro. Only called once Decoded(), so
+  // the wait at most catches the fence's last release.
+  void StartDeck(MusicDeck& deck) {
+    ma_fence_wait(&deck.loaded);
+    if (deck.main_loaded) PrepareMain(deck);
+    if (deck.intro_loaded) {
+      PrepareIntro(deck);
+      ma_sound_start(&deck.intro);
+      return;
     }
+    deck.StartMain();
+  }
+
+  void PrepareIntro(MusicDeck& deck) {
     ma_uint32 rate = 0;
-    ma_sound_get_data_format(&intro_sound_, nullptr, nullptr, &rate, nullptr, 0);
+    ma_sound_get_data_format(&deck.intro, nullptr, nullptr, &rate, nullptr, 0);
     ma_uint64 length_frames = 0;
-    ma_sound_get_length_in_pcm_frames(&intro_sound_, &length_frames);
+    ma_sound_get_length_in_pcm_frames(&deck.intro, &length_frames);
     if (rate == 0) rate = 44100;
     ma_uint64 start_frame = 0;
     ma_uint64 end_frame = length_frames;
-    if (current_intro_start_sec_ >= 0.0F) {
-      start_frame = static_cast<ma_uint64>(current_intro_start_sec_ * static_cast<float>(rate));
+    if (deck.intro_start_sec >= 0.0F) {
+      start_frame = static_cast<ma_uint64>(deck.intro_start_sec * static_cast<float>(rate));
       start_frame = std::min(start_frame, length_frames);
-      ma_sound_seek_to_pcm_frame(&intro_sound_, start_frame);
+      ma_sound_seek_to_pcm_frame(&deck.intro, start_frame);
     }
-    if (current_intro_end_sec_ > 0.0F) {
-      end_frame = static_cast<ma_uint64>(current_intro_end_sec_ * static_cast<float>(rate));
+    if (deck.intro_end_sec > 0.0F) {
+      end_frame = static_cast<ma_uint64>(deck.intro_end_sec * static_cast<float>(rate));
       end_frame = std::min(end_frame, length_frames);
       if (end_frame > start_frame) {
-        ma_sound_set_stop_time_in_pcm_frames(&intro_sound_, end_frame);
+        ma_sound_set_stop_time_in_pcm_frames(&deck.intro, end_frame);
       }
     }
-    ma_sound_set_end_callback(&intro_sound_, IntroEnded, this);
-    ma_sound_set_looping(&intro_sound_, MA_FALSE);
-    ma_sound_set_volume(&intro_sound_, music_volume_ * current_music_gain_);
-    ma_sound_start(&intro_sound_);
-    intro_loaded_ = true;
-    return true;
+    ma_sound_set_end_callback(&deck.intro, IntroEnded, &deck);
+    ma_sound_set_looping(&deck.intro, MA_FALSE);
+    ma_sound_set_volume(&deck.intro, music_volume_ * deck.gain);
   }
 
-  void OnIntroEnded() {
-    if (intro_loaded_) {
-      ma_sound_uninit(&intro_sound_);
-      intro_loaded_ = false;
-    }
-    StartMainMusic();
-  }
-
-  bool StartMainMusic() {
-    if (current_music_path_.empty()) return false;
-    constexpr ma_uint32 kMusicFlags =
-        MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_ASYNC;  // fully decode for seamless looping
-    if (ma_sound_init_from_file(&engine_, current_music_path_.c_str(), kMusicFlags, nullptr,
-                                nullptr, &music_sound_) != MA_SUCCESS) {
-      music_loaded_ = false;
-      return false;
-    }
+  void PrepareMain(MusicDeck& deck) {
     ma_uint32 rate = 0;
-    ma_sound_get_data_format(&music_sound_, nullptr, nullptr, &rate, nullptr, 0);
+    ma_sound_get_data_format(&deck.main, nullptr, nullptr, &rate, nullptr, 0);
     ma_uint64 length_frames = 0;
-    ma_sound_get_length_in_pcm_frames(&music_sound_, &length_frames);
+    ma_sound_get_length_in_pcm_frames(&deck.main, &length_frames);
     if (rate == 0) rate = 44100;
     ma_uint64 loop_start_frame = 0;
     ma_uint64 loop_end_frame = length_frames;
-    if (current_loop_start_sec_ >= 0.0F) {
-      loop_start_frame = static_cast<ma_uint64>(current_loop_start_sec_ * static_cast<float>(rate));
+    if (deck.loop_start_sec >= 0.0F) {
+      loop_start_frame = static_cast<ma_uint64>(deck.loop_start_sec * static_cast<float>(rate));
     }
-    if (current_loop_end_sec_ > 0.0F) {
-      loop_end_frame = static_cast<ma_uint64>(current_loop_end_sec_ * static_cast<float>(rate));
+    if (deck.loop_end_sec > 0.0F) {
+      loop_end_frame = static_cast<ma_uint64>(deck.loop_end_sec * static_cast<float>(rate));
     }
 
     // Clamp and fallback sensibly if values are out of bounds.
@@ -348,64 +513,170 @@ class AudioSystem::Impl {
     }
 
     if (loop_start_frame < loop_end_frame) {
-      ma_data_source_set_loop_point_in_pcm_frames(ma_sound_get_data_source(&music_sound_),
+      ma_data_source_set_loop_point_in_pcm_frames(ma_sound_get_data_source(&deck.main),
                                                   loop_start_frame, loop_end_frame);
     }
     float seek_sec = -1.0F;
-    if (current_initial_seek_sec_ >= 0.0F) {
-      seek_sec = current_initial_seek_sec_;
-    } else if (!shared_intro_ && current_loop_start_sec_ >= 0.0F) {
-      seek_sec = current_loop_start_sec_;
+    if (deck.shared_intro) {
+      seek_sec = deck.intro_start_sec >= 0.0F ? deck.intro_start_sec : 0.0F;
+    } else if (deck.loop_start_sec >= 0.0F) {
+      seek_sec = deck.loop_start_sec;
     }
     if (seek_sec > 0.0F) {
       ma_uint64 seek_frame = static_cast<ma_uint64>(seek_sec * static_cast<float>(rate));
       seek_frame = std::min(seek_frame, length_frames);
-      ma_sound_seek_to_pcm_frame(&music_sound_, seek_frame);
+      ma_sound_seek_to_pcm_frame(&deck.main, seek_frame);
     }
-    ma_sound_set_looping(&music_sound_, MA_TRUE);
-    ma_sound_set_volume(&music_sound_, music_volume_ * current_music_gain_);
-    ma_sound_start(&music_sound_);
-    music_loaded_ = true;
+    ma_sound_set_looping(&deck.main, MA_TRUE);
+    ma_sound_set_volume(&deck.main, music_volume_ * deck.gain);
+  }
+
+  // Decodes path to engine-format PCM and appends it to clips_.
+  bool DecodeClip(const std::string& path) {
+    ma_decoder_config config = ma_decoder_config_init(
+        ma_format_f32, ma_engine_get_channels(&engine_), ma_engine_get_sample_rate(&engine_));
+    PcmClip clip;
+    void* frames = nullptr;
+    if (ma_decode_file(path.c_str(), &config, &clip.frame_count, &frames) != MA_SUCCESS) {
+      return false;
+    }
+    clip.frames.reset(frames);
+    clips_.push_back(std::move(clip));
     return true;
   }
 
-  void CleanupSounds(bool force_all) {
-    if (active_sounds_.empty()) return;
-    active_sounds_.erase(
-        std::remove_if(active_sounds_.begin(), active_sounds_.end(),
-                       [&](std::unique_ptr<ma_sound>& s) {
-                         if (!s) return true;
-                         if (force_all || ma_sound_is_playing(s.get()) == MA_FALSE) {
-                           ma_sound_uninit(s.get());
-                           return true;
-                         }
-                         return false;
-                       }),
-        active_sounds_.end());
+  void InitVoices() {
+    const ma_uint32 channels = ma_engine_get_channels(&engine_);
+    for (Voice& voice : voices_) {
+      if (ma_audio_buffer_ref_init(ma_format_f32, channels, nullptr, 0, &voice.ref) !=
+          MA_SUCCESS) {
+        break;
+      }
+      voice.ref.sampleRate = ma_engine_get_sample_rate(&engine_);
+      if (ma_sound_init_from_data_source(&engine_, &voice.ref, 0, nullptr, &voice.sound) !=
+          MA_SUCCESS) {
+        ma_audio_buffer_ref_uninit(&voice.ref);
+        break;
+      }
+      ++voice_count_;
+    }
+  }
+
+  void UninitVoices() {
+    for (size_t i = 0; i < voice_count_; ++i) {
+      ma_sound_uninit(&voices_[i].sound);
+      ma_audio_buffer_ref_uninit(&voices_[i].ref);
+    }
+    voice_count_ = 0;
+  }
+
+  // Silences every voice and detaches it from its clip, so clips_ can be
+  // released.
+  void StopVoices() {
+    for (size_t i = 0; i < voice_count_; ++i) {
+      ma_sound_stop(&voices_[i].sound);
+      ma_audio_buffer_ref_set_data(&voices_[i].ref, nullptr, 0);
+    }
+  }
+
+  // The oldest voice playing event once it has kMaxVoicesPerEvent of them;
+  // otherwise an idle voice, or failing that the one started longest ago.
+  Voice& AcquireVoice(size_t event) {
+    Voice* idle = nullptr;
+    Voice* oldest = &voices_[0];
+    Voice* oldest_same = nullptr;
+    size_t same = 0;
+    for (size_t i = 0; i < voice_count_; ++i) {
+      Voice& voice = voices_[i];
+      if (ma_sound_is_playing(&voice.sound) == MA_FALSE) {
+        if (idle == nullptr) idle = &voice;
+        continue;
+      }
+      if (voice.started < oldest->started) oldest = &voice;
+      if (voice.event == event) {
+        ++same;
+        if (oldest_same == nullptr || voice.started < oldest_same->started) oldest_same = &voice;
+      }
+    }
+    if (same >= kMaxVoicesPerEvent) return *oldest_same;
+    return idle != nullptr ? *idle : *oldest;
+  }
+
+  // Starts one voice for event, count times as loud as a single play up to
+  // kMaxBatchGain (identical sounds started together add up roughly with
+  // the square root of their number).
+  void StartEvent(size_t event, uint16_t count) {
+    const EventEntry& entry = events_[event];
+    if (entry.clips.empty() || voice_count_ == 0) return;
+    const auto& list = entry.clips;
+    const size_t idx = list.size() == 1 ? 0U : static_cast<size_t>(sfx_rng_() % list.size());
+    const PcmClip& clip = clips_[list[idx]];
+    const float batch_gain = std::min(std::sqrt(static_cast<float>(count)), kMaxBatchGain);
+
+    Voice& voice = AcquireVoice(event);
+    ma_sound_stop(&voice.sound);
+    ma_audio_buffer_ref_set_data(&voice.ref, clip.frames.get(), clip.frame_count);
+    ma_sound_seek_to_pcm_frame(&voice.sound, 0);
+    ma_sound_set_volume(&voice.sound, sfx_volume_ * entry.volume * batch_gain);
+    voice.started = ++play_serial_;
+    voice.event = event;
+    ma_sound_start(&voice.sound);
+  }
+
+  // The audio thread: starts the voices for each batch EndTick() queues.
+  void SfxLoop() {
+    std::vector<SfxBatch> batches;
+    batches.reserve(kMaxQueuedBatches);
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        queue_wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) return;
+        batches.swap(queue_);
+      }
+      std::lock_guard<std::mutex> voice_lock(voice_mutex_);
+      for (const SfxBatch& batch : batches) {
+        for (size_t event = 0; event < kSfxEventCount; ++event) {
+          if (batch[event] > 0) StartEvent(event, batch[event]);
+        }
+      }
+      batches.clear();
+    }
   }
 
   ma_engine engine_{};
   bool engine_init_ = false;
-  bool music_loaded_ = false;
-  bool intro_loaded_ = false;
-  ma_sound music_sound_{};
-  ma_sound intro_sound_{};
-  std::unordered_map<std::string, EventEntry> events_;
-  std::unordered_map<int, MusicEntry> music_;
+  std::array<EventEntry, kSfxEventCount> events_{};  // by SfxEvent
+  std::unordered_map<int, MusicEntry> music_entries_;
   std::string config_path_;
-  std::string current_music_path_;
-  float current_loop_start_sec_ = -1.0F;
-  float current_loop_end_sec_ = -1.0F;
-  float current_initial_seek_sec_ = -1.0F;
   float sfx_volume_ = 1.0F;
   float music_volume_ = 1.0F;
   bool sfx_enabled_ = true;
   bool music_enabled_ = true;
-  float current_music_gain_ = 1.0F;
-  float current_intro_start_sec_ = -1.0F;
-  float current_intro_end_sec_ = -1.0F;
-  bool shared_intro_ = false;
-  std::vector<std::unique_ptr<ma_sound>> active_sounds_;
+  std::unique_ptr<MusicDeck> music_;       // playing
+  std::unique_ptr<MusicDeck> next_music_;  // prefetched
+  std::unique_ptr<MusicDeck> pending_music_;  // asked for, still decoding
+  std::vector<std::unique_ptr<MusicDeck>> retired_music_;
+
+  // Game thread only: this tick's requests.
+  SfxBatch pending_{};
+  bool pending_any_ = false;
+
+  // Ticks waiting for the audio thread.
+  std::thread sfx_thread_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_wake_;
+  std::vector<SfxBatch> queue_;
+  bool stop_ = false;
+
+  // Owned by the audio thread while it plays a batch and by LoadConfig()
+  // while it replaces them.
+  std::mutex voice_mutex_;
+  std::vector<PcmClip> clips_;
+  std::array<Voice, kVoiceCount> voices_{};
+  size_t voice_count_ = 0;  // voices_[0, voice_count_) are initialised
+  uint64_t play_serial_ = 0;
+  std::mt19937 sfx_rng_{std::random_device{}()};
   std::mt19937 rng_{std::random_device{}()};
   std::uniform_int_distribution<int> dist_;
 };
@@ -414,9 +685,12 @@ AudioSystem::AudioSystem() : impl_(new Impl()) {}
 AudioSystem::~AudioSystem() { delete impl_; }
 bool AudioSystem::Init(const std::string& config_path) { return impl_->Init(config_path); }
 void AudioSystem::ReloadConfig() { impl_->ReloadConfig(); }
-void AudioSystem::PlayEvent(const std::string& name) { impl_->PlayEvent(name); }
+void AudioSystem::PlayEvent(SfxEvent event) { impl_->PlayEvent(event); }
+void AudioSystem::EndTick() { impl_->EndTick(); }
 void AudioSystem::SetMusicForMap(int map_index) { impl_->SetMusicForMap(map_index); }
+void AudioSystem::PrefetchMusicForMap(int map_index) { impl_->PrefetchMusicForMap(map_index); }
 void AudioSystem::Update() { impl_->Update(); }
+bool AudioSystem::MusicLoading() const { return impl_->MusicLoading(); }
 void AudioSystem::ToggleSfx() { impl_->ToggleSfx(); }
 void AudioSystem::ToggleMusic() { impl_->ToggleMusic(); }
 bool AudioSystem::SfxEnabled() const { return impl_->SfxEnabled(); }
@@ -429,11 +703,14 @@ AudioSystem::AudioSystem() : impl_(new Impl()) {}
 AudioSystem::~AudioSystem() { delete impl_; }
 bool AudioSystem::Init(const std::string&) { return false; }
 void AudioSystem::ReloadConfig() {}
-void AudioSystem::PlayEvent(const std::string&) {}
+void AudioSystem::PlayEvent(SfxEvent) {}
+void AudioSystem::EndTick() {}
 void AudioSystem::SetMusicForMap(int) {}
+void AudioSystem::PrefetchMusicForMap(int) {}
 void AudioSystem::ToggleSfx() {}
 void AudioSystem::ToggleMusic() {}
 bool AudioSystem::SfxEnabled() const { return false; }
 bool AudioSystem::MusicEnabled() const { return false; }
+bool AudioSystem::MusicLoading() const { return false; }
 
 #endif
@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 
+#include "sim/sfx.h"
+
 class AudioSystem {
  public:
   AudioSystem();
@@ -10,9 +12,18 @@ class AudioSystem {
 
   bool Init(const std::string& config_path);
   void ReloadConfig();
-  void PlayEvent(const std::string& name);
+  // Queues event for the current tick; repeats of one event within a tick
+  // collapse into a single, louder voice. Call from the game thread only.
+  void PlayEvent(SfxEvent event);
+  // Hands the tick's queued events to the audio thread, which starts them.
+  void EndTick();
   void SetMusicForMap(int map_index);
+  // Starts decoding map_index's music in the background so a later
+  // SetMusicForMap(map_index) switches to it without loading anything.
+  void PrefetchMusicForMap(int map_index);
   void Update();
+  // A track asked for is still decoding; Update() starts it once it is done.
+  bool MusicLoading() const;
   void ToggleSfx();
   void ToggleMusic();
   bool SfxEnabled() const;
@@ -0,0 +1,534 @@
+#include "board_view.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+#include <ftxui/dom/node.hpp>
+#include <ftxui/screen/screen.hpp>
+
+#include "sim/raster.h"
+
+using ftxui::bgcolor;
+using ftxui::bold;
+using ftxui::color;
+
+namespace {
+
+struct MapPalette {
+  ftxui::Color background = ftxui::Color::DarkGreen;
+  ftxui::Color path_color = ftxui::Color::DarkGoldenrod;
+};
+
+// Board colors, indexed like the simulation's map list.
+const MapPalette &PaletteFor(int map_index) {
+  static const std::vector<MapPalette> palettes = {
+      {ftxui::Color::DarkGreen, ftxui::Color::DarkGoldenrod},
+      {ftxui::Color::DarkSlateGray3, ftxui::Color::DarkTurquoise},
+      {ftxui::Color::DarkOliveGreen3, ftxui::Color::Gold3},
+      {ftxui::Color::DarkBlue, ftxui::Color::CornflowerBlue},
+      {ftxui::Color::DarkKhaki, ftxui::Color::DarkOrange},
+      {ftxui::Color::DarkSlateGray1, ftxui::Color::LightSkyBlue1},
+      {ftxui::Color::DarkOliveGreen3, ftxui::Color::GreenYellow},
+      {ftxui::Color::DarkMagenta, ftxui::Color::DeepPink3},
+      {ftxui::Color::DarkSeaGreen3, ftxui::Color::Chartreuse1},
+      {ftxui::Color::DarkRed, ftxui::Color::OrangeRed1},
+  };
+  return palettes[static_cast<size_t>(map_index) % palettes.size()];
+}
+
+struct AreaStyle {
+  ftxui::Color color;
+  char glyph;
+};
+
+AreaStyle StyleFor(AreaHighlight::Kind kind) {
+  switch (kind) {
+  case AreaHighlight::Kind::Swipe:
+    return {ftxui::Color::Pink1, '#'};
+  case AreaHighlight::Kind::Sleep:
+    return {ftxui::Color::Purple, '~'};
+  case AreaHighlight::Kind::Cosmic:
+    return {ftxui::Color::LightSteelBlue, '*'};
+  case AreaHighlight::Kind::Void:
+    return {ftxui::Color::DarkMagenta, '~'};
+  }
+  return {ftxui::Color::Pink1, '#'};
+}
+
+ftxui::Color BlendColor(const ftxui::Color &base, const ftxui::Color &overlay,
+                        float alpha) {
+  return ftxui::Color::Interpolate(alpha, base, overlay);
+}
+
+ftxui::Color EnemyColor(const Enemy &e) {
+  const float ratio =
+      static_cast<float>(e.hp) / static_cast<float>(std::max(1, e.max_hp));
+  if (ratio > 0.75F) {
+    return ftxui::Color::RedLight;
+  }
+  if (ratio > 0.5F) {
+    return ftxui::Color::Orange1;
+  }
+  if (ratio > 0.25F) {
+    return ftxui::Color::Yellow1;
+  }
+  return ftxui::Color::GrayLight;
+}
+
+// Marks the cells within range of center in mask, whose cell (0, 0) is
+// board cell origin; scans only the part of the bounding box in the mask.
+void MarkRange(BoardBitset &mask, const Position &origin, const Vec2 &center,
+               float range) {
+  const BoardSize &area = mask.board();
+  const int x0 =
+      std::max(origin.x, static_cast<int>(std::floor(center.x - range)));
+  const int y0 =
+      std::max(origin.y, static_cast<int>(std::floor(center.y - range)));
+  const int x1 = std::min(origin.x + area.width - 1,
+                          static_cast<int>(std::ceil(center.x + range)));
+  const int y1 = std::min(origin.y + area.height - 1,
+                          static_cast<int>(std::ceil(center.y + range)));
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      if (InRange(center, {x, y}, range)) {
+        mask.Set(x - origin.x, y - origin.y);
+      }
+    }
+  }
+}
+
+void MarkCells(BoardBitset &mask, const Position &origin,
+               const std::vector<Position> &cells) {
+  for (const auto &cell : cells) {
+    mask.Set(cell.x - origin.x, cell.y - origin.y);
+  }
+}
+
+float DisplayRange(const Tower &t) {
+  if (t.type == Tower::Type::Kitty && t.upgraded) {
+    return t.range + kKittyJumpBonusRange;
+  }
+  return t.range;
+}
+
+// True when both towers draw the same range overlay.
+bool SameOverlay(const Tower &a, const Tower &b) {
+  return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.type == b.type &&
+         a.size == b.size && a.upgraded == b.upgraded && a.range == b.range;
+}
+
+bool SamePosition(const Position &p, const Position &q) {
+  return p.x == q.x && p.y == q.y;
+}
+
+bool SamePath(const std::vector<Position> &a, const std::vector<Position> &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(), SamePosition);
+}
+
+// The part of the board view shows: its size clipped to the board, and its
+// top-left cell moved so it fits.
+BoardSize VisibleSize(const BoardView &view, const BoardSize &board) {
+  return {std::clamp(view.viewport.width, 1, board.width),
+          std::clamp(view.viewport.height, 1, board.height)};
+}
+
+Position VisibleOrigin(const BoardView &view, const BoardSize &board) {
+  const BoardSize size = VisibleSize(view, board);
+  return {std::clamp(view.camera.x, 0, board.width - size.width),
+          std::clamp(view.camera.y, 0, board.height - size.height)};
+}
+
+// Paints a composed frame straight into the screen, `columns` per cell with
+// the glyph in the first.
+class BoardNode : public ftxui::Node {
+public:
+  BoardNode(std::shared_ptr<const BoardGrid<BoardCell>> cells, int columns)
+      : cells_(std::move(cells)), columns_(columns) {}
+
+  void ComputeRequirement() override {
+    requirement_.min_x = columns_ * cells_->size().width;
+    requirement_.min_y = cells_->size().height;
+  }
+
+  void Render(ftxui::Screen &screen) override {
+    const BoardSize &size = cells_->size();
+    for (int y = 0; y < size.height && box_.y_min + y <= box_.y_max; ++y) {
+      for (int col = 0;
+           col < columns_ * size.width && box_.x_min + col <= box_.x_max;
+           ++col) {
+        const BoardCell &cell = (*cells_)(col / columns_, y);
+        auto &pixel = screen.PixelAt(box_.x_min + col, box_.y_min + y);
+        pixel.character.assign(1, col % columns_ == 0 ? cell.glyph : ' ');
+        pixel.background_color = cell.bg;
+        pixel.foreground_color = cell.fg;
+        if (cell.bold) {
+          pixel.bold = true;
+        }
+        if (cell.inverted) {
+          pixel.inverted = true;
+        }
+      }
+    }
+  }
+
+private:
+  std::shared_ptr<const BoardGrid<BoardCell>> cells_;
+  int columns_;
+};
+
+} // namespace
+
+Position FollowCursor(const Position &camera, const Position &cursor,
+                      const BoardSize &viewport, const BoardSize &board) {
+  const auto axis = [](int cam, int cur, int view, int extent) {
+    view = std::max(1, view);
+    const int margin = std::min(kCameraMargin, (view - 1) / 2);
+    cam = std::clamp(cam, cur - view + 1 + margin, cur - margin);
+    return std::clamp(cam, 0, std::max(0, extent - view));
+  };
+  return {axis(camera.x, cursor.x, viewport.width, board.width),
+          axis(camera.y, cursor.y, viewport.height, board.height)};
+}
+
+ftxui::Element BoardRenderer::Render(const Simulation &sim,
+                                     const BoardView &view) {
+  if (frame_.use_count() > 1) {
+    frame_ = std::make_shared<BoardGrid<BoardCell>>();
+  }
+  Compose(sim, view);
+  ftxui::Element board = std::make_shared<BoardNode>(frame_, 2);
+  if (sim.game_over()) {
+    board = board | bgcolor(ftxui::Color::Black) |
+            color(ftxui::Color::Grey70) | bold;
+  }
+  return board;
+}
+
+void BoardRenderer::RebuildMapLayer(const Simulation &sim,
+                                    const BoardSize &size) {
+  const auto &map = PaletteFor(sim.map_index());
+  map_layer_.Assign(size);
+  for (int y = 0; y < size.height; ++y) {
+    for (int x = 0; x < size.width; ++x) {
+      BoardCell &cell = map_layer_(x, y);
+      if (sim.path_mask().Test(origin_.x + x, origin_.y + y)) {
+        cell.bg = map.path_color;
+        cell.glyph = '.';
+        cell.fg = ftxui::Color::Black;
+      } else {
+        cell.bg = map.background;
+      }
+    }
+  }
+  map_origin_ = origin_;
+  map_index_ = sim.map_index();
+  map_path_ = sim.path();
+}
+
+void BoardRenderer::RebuildRangeLayer(const Simulation &sim) {
+  range_layer_.Resize(sim.board());
+  for (const auto &t : sim.towers()) {
+    if (!GetDef(t.type).show_range) {
+      continue;
+    }
+    const auto center = TowerCenter(t);
+    if (t.type == Tower::Type::Kitty && !t.upgraded) {
+      MarkCells(range_layer_, {}, KittyOverlayCells(center, sim.board()));
+    } else {
+      MarkRange(range_layer_, {}, center, DisplayRange(t));
+    }
+  }
+  range_towers_ = sim.towers();
+  range_layer_valid_ = true;
+}
+
+void BoardRenderer::Compose(const Simulation &sim, const BoardView &view) {
+  const BoardSize &board = sim.board();
+  const BoardSize size = VisibleSize(view, board);
+  origin_ = VisibleOrigin(view, board);
+  if (map_index_ != sim.map_index() || map_layer_.size() != size ||
+      !SamePosition(map_origin_, origin_) ||
+      !SamePath(map_path_, sim.path())) {
+    RebuildMapLayer(sim, size);
+  }
+  auto &cells = *frame_;
+  cells = map_layer_;
+  if (enemy_mask_.board() != size) {
+    preview_mask_.Resize(size);
+    enemy_mask_.Resize(size);
+  } else {
+    enemy_mask_.Reset();
+    preview_mask_.Reset();
+  }
+  // The frame cell showing board cell (x, y), or nullptr off the viewport.
+  const auto at = [&](int x, int y) -> BoardCell * {
+    const int lx = x - origin_.x;
+    const int ly = y - origin_.y;
+    return size.Contains(lx, ly) ? &cells(lx, ly) : nullptr;
+  };
+  // True if [x0, x1] x [y0, y1] reaches into the viewport.
+  const auto visible = [&](int x0, int y0, int x1, int y1) {
+    return x1 >= origin_.x && y1 >= origin_.y &&
+           x0 < origin_.x + size.width && y0 < origin_.y + size.height;
+  };
+
+  const bool show_overlay =
+      view.overlay_enabled || sim.held_tower().has_value();
+  if (show_overlay) {
+    const auto &towers = sim.towers();
+    if (!range_layer_valid_ || range_layer_.board() != board ||
+        !std::equal(towers.begin(), towers.end(), range_towers_.begin(),
+                    range_towers_.end(), SameOverlay)) {
+      RebuildRangeLayer(sim);
+    }
+    const TowerDef &preview_def = GetDef(view.selected_type);
+    if (preview_def.show_range) {
+      const Vec2 center = TowerCenterAt(view.cursor, preview_def.size);
+      if (preview_def.type == Tower::Type::Kitty) {
+        MarkCells(preview_mask_, origin_, KittyOverlayCells(center, board));
+      } else {
+        MarkRange(preview_mask_, origin_, center, preview_def.range);
+      }
+    }
+  }
+
+  for (const auto &t : sim.towers()) {
+    if (!visible(t.pos.x, t.pos.y, t.pos.x + t.size - 1,
+                 t.pos.y + t.size - 1)) {
+      continue;
+    }
+    const char glyph =
+        t.type == Tower::Type::Thunder     ? (t.upgraded ? 'T' : 't')
+        : t.type == Tower::Type::Fat       ? (t.upgraded ? 'F' : 'f')
+        : t.type == Tower::Type::Kitty     ? (t.upgraded ? 'K' : 'k')
+        : t.type == Tower::Type::Catatonic ? (t.upgraded ? 'C' : 'c')
+        : t.type == Tower::Type::Galactic  ? (t.upgraded ? 'G' : 'g')
+                                           : (t.upgraded ? 'D' : 'd');
+    const ftxui::Color bg =
+        t.type == Tower::Type::Thunder     ? ftxui::Color::Blue1
+        : t.type == Tower::Type::Fat       ? ftxui::Color::DarkOliveGreen3
+        : t.type == Tower::Type::Kitty     ? ftxui::Color::Pink1
+        : t.type == Tower::Type::Catatonic ? ftxui::Color::Purple
+        : t.type == Tower::Type::Galactic  ? ftxui::Color::LightSteelBlue
+                                           : ftxui::Color::Gold1;
+    for (int dy = 0; dy < t.size; ++dy) {
+      for (int dx = 0; dx < t.size; ++dx) {
+        BoardCell *cell = at(t.pos.x + dx, t.pos.y + dy);
+        if (cell == nullptr) {
+          continue;
+        }
+        cell->glyph = glyph;
+        cell->bg = bg;
+        cell->fg = ftxui::Color::Black;
+        cell->bold = true;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < sim.enemies().size(); ++i) {
+    const auto pos = sim.EnemyCellAt(i);
+    BoardCell *cell = at(pos.x, pos.y);
+    if (cell == nullptr) {
+      continue;
+    }
+    const Enemy e = sim.enemies().Get(i);
+    char g = 'r';
+    ftxui::Color fg = EnemyColor(e);
+    std::optional<ftxui::Color> bg_override;
+    switch (e.type) {
+    case EnemyType::Mouse:
+      g = 'm';
+      fg = ftxui::Color::Grey70;
+      bg_override = std::nullopt; // keep path background
+      break;
+    case EnemyType::Rat:
+      g = 'r';
+      fg = EnemyColor(e);
+      bg_override = ftxui::Color::Grey23;
+      break;
+    case EnemyType::BigRat:
+      g = 'R';
+      fg = ftxui::Color::RedLight;
+      bg_override = ftxui::Color::Grey35;
+      break;
+    case EnemyType::Dog:
+      g = 'D';
+      fg = ftxui::Color::White;
+      bg_override = ftxui::Color::DarkRed;
+      break;
+    }
+    cell->glyph = g;
+    if (bg_override.has_value())
+      cell->bg = *bg_override;
+    cell->fg = fg;
+    enemy_mask_.Set(pos.x - origin_.x, pos.y - origin_.y);
+  }
+
+  for (const auto &p : sim.projectiles()) {
+    BoardCell *cell = at(static_cast<int>(std::round(p.x)),
+                         static_cast<int>(std::round(p.y)));
+    if (cell == nullptr) {
+      continue;
+    }
+    cell->glyph = '*';
+    cell->fg = ftxui::Color::SkyBlue1;
+  }
+
+  const CellRect view_rect = RectOf(origin_, size);
+  for (const auto &b : sim.beams()) {
+    ForLineCells(b.from, b.to, view_rect, [&](int x, int y) {
+      BoardCell &cell = *at(x, y);
+      cell.glyph = '-';
+      cell.fg = ftxui::Color::CyanLight;
+    });
+  }
+
+  for (const auto &ah : sim.area_highlights()) {
+    const auto style = StyleFor(ah.kind);
+    for (const auto &p : ah.cells) {
+      BoardCell *cell = at(p.x, p.y);
+      if (cell == nullptr) {
+        continue;
+      }
+      cell->glyph = style.glyph;
+      cell->fg = style.color;
+      cell->bg = BlendColor(cell->bg, style.color, 0.08F);
+    }
+  }
+
+  for (const auto &sw : sim.shockwaves()) {
+    ForRingSpans(sw.center, sw.radius, 0.6F, view_rect,
+                 [&](int y, int x0, int x1) {
+                   BoardCell *cell = at(x0, y);
+                   for (int x = x0; x < x1; ++x, ++cell) {
+                     cell->glyph = 'o';
+                     cell->fg = ftxui::Color::YellowLight;
+                   }
+                 });
+  }
+
+  for (const auto &hs : sim.hit_splats()) {
+    BoardCell *cell = at(hs.pos.x, hs.pos.y);
+    if (cell == nullptr) {
+      continue;
+    }
+    cell->glyph = 'x';
+    cell->bg = ftxui::Color::White;
+    cell->fg = ftxui::Color::Red3;
+  }
+
+  if (show_overlay) {
+    for (int y = 0; y < size.height; ++y) {
+      for (int x = 0; x < size.width; ++x) {
+        if (enemy_mask_.Test(x, y)) {
+          continue;
+        }
+        BoardCell &cell = cells(x, y);
+        if (range_layer_.Test(origin_.x + x, origin_.y + y)) {
+          cell.bg = BlendColor(cell.bg, ftxui::Color::DarkSeaGreen, 0.25F);
+        }
+        if (preview_mask_.Test(x, y)) {
+          cell.bg = BlendColor(cell.bg, ftxui::Color::LightSkyBlue1, 0.45F);
+        }
+      }
+    }
+
+    const auto &held = sim.held_tower();
+    const TowerDef &preview_def_place =
+        GetDef(held.has_value() ? held->tower.type : view.selected_type);
+    const bool can_place_preview =
+        view.cursor.x >= 0 && view.cursor.y >= 0 &&
+        view.cursor.x + preview_def_place.size - 1 < board.width &&
+        view.cursor.y + preview_def_place.size - 1 < board.height &&
+        !sim.OccupiesPath(view.cursor, preview_def_place.size) &&
+        !sim.OverlapsTower(view.cursor, preview_def_place.size);
+    for (int dy = 0; dy < preview_def_place.size; ++dy) {
+      for (int dx = 0; dx < preview_def_place.size; ++dx) {
+        BoardCell *cell = at(view.cursor.x + dx, view.cursor.y + dy);
+        if (cell == nullptr) {
+          continue;
+        }
+        cell->glyph = can_place_preview ? '+' : 'X';
+        cell->fg = can_place_preview ? ftxui::Color(ftxui::Color::LightSkyBlue1)
+                                     : ftxui::Color(ftxui::Color::RedLight);
+      }
+    }
+  }
+
+  if (sim.game_over()) {
+    for (auto &cell : cells.cells()) {
+      cell.bg = ftxui::Color::Grey23;
+      cell.fg = ftxui::Color::Grey70;
+    }
+  }
+
+  if (BoardCell *cell = at(view.cursor.x, view.cursor.y)) {
+    cell->inverted = true;
+  }
+}
+
+ftxui::Element MinimapRenderer::Render(const Simulation &sim,
+                                       const BoardView &view,
+                                       const BoardSize &max_size) {
+  if (frame_.use_count() > 1) {
+    frame_ = std::make_shared<BoardGrid<BoardCell>>();
+  }
+  constexpr uint8_t kPath = 1U;
+  constexpr uint8_t kTower = 2U;
+  const BoardSize &board = sim.board();
+  // A terminal cell is about twice as tall as wide and a board cell two
+  // columns wide, so blocks twice as tall as wide keep the board's shape.
+  const auto ceil_div = [](int a, int b) { return (a + b - 1) / b; };
+  const int block_w =
+      std::max({1, ceil_div(board.width, std::max(1, max_size.width)),
+                ceil_div(board.height, 2 * std::max(1, max_size.height))});
+  const int block_h = 2 * block_w;
+  const BoardSize size{ceil_div(board.width, block_w),
+                       ceil_div(board.height, block_h)};
+  enemies_.Assign(size);
+  marks_.Assign(size);
+  for (const auto &p : sim.path()) {
+    marks_(p.x / block_w, p.y / block_h) |= kPath;
+  }
+  for (const auto &t : sim.towers()) {
+    if (board.Contains(t.pos)) {
+      marks_(t.pos.x / block_w, t.pos.y / block_h) |= kTower;
+    }
+  }
+  for (size_t i = 0; i < sim.enemies().size(); ++i) {
+    const auto pos = sim.EnemyCellAt(i);
+    uint16_t &count = enemies_(pos.x / block_w, pos.y / block_h);
+    count = static_cast<uint16_t>(std::min(count + 1, 0xFFFF));
+  }
+
+  const auto &palette = PaletteFor(sim.map_index());
+  const Position origin = VisibleOrigin(view, board);
+  const BoardSize visible = VisibleSize(view, board);
+  const int vx0 = origin.x / block_w;
+  const int vy0 = origin.y / block_h;
+  const int vx1 = (origin.x + visible.width - 1) / block_w;
+  const int vy1 = (origin.y + visible.height - 1) / block_h;
+  auto &cells = *frame_;
+  cells.Assign(size);
+  for (int y = 0; y < size.height; ++y) {
+    for (int x = 0; x < size.width; ++x) {
+      BoardCell &cell = cells(x, y);
+      const uint8_t marks = marks_(x, y);
+      const uint16_t enemies = enemies_(x, y);
+      cell.bg = (marks & kPath) != 0 ? palette.path_color : palette.background;
+      if (enemies > 0) {
+        cell.glyph = enemies < 4 ? 'o' : 'O';
+        cell.fg = ftxui::Color::RedLight;
+      } else if ((marks & kTower) != 0) {
+        cell.glyph = '#';
+        cell.fg = ftxui::Color::Gold1;
+      }
+      const bool inside = x >= vx0 && x <= vx1 && y >= vy0 && y <= vy1;
+      cell.inverted =
+          inside && (x == vx0 || x == vx1 || y == vy0 || y == vy1);
+    }
+  }
+  return std::make_shared<BoardNode>(frame_, 1);
+}
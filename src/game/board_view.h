@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/screen/color.hpp>
+
+#include "sim/board_grid.h"
+#include "sim/simulation.h"
+
+// UI state the board renderer needs on top of the simulation.
+struct BoardView {
+  Position cursor{};
+  Tower::Type selected_type = Tower::Type::Default;
+  bool overlay_enabled = true;
+  // The window of the board on screen: viewport cells from camera, its
+  // top-left cell. Clipped to the board when drawn.
+  Position camera{};
+  BoardSize viewport{};
+};
+
+// Cursor cells kept between the cursor and the viewport's edges.
+constexpr int kCameraMargin = 3;
+
+// Where the camera goes so the viewport keeps the cursor kCameraMargin
+// cells inside it, moving as little as possible from camera and staying
+// on the board.
+Position FollowCursor(const Position &camera, const Position &cursor,
+                      const BoardSize &viewport, const BoardSize &board);
+
+// One board cell as drawn; every cell is two terminal columns wide.
+struct BoardCell {
+  char glyph = ' ';
+  ftxui::Color fg = ftxui::Color::White;
+  ftxui::Color bg = ftxui::Color::DarkGreen;
+  bool bold = false;
+  bool inverted = false;
+};
+
+// Draws the play field inside the viewport: path, towers, enemies, effects
+// and the placement preview under the cursor. Only viewport cells are
+// built and anything outside it is skipped, so a frame costs what the
+// terminal shows rather than what the board holds. Kept between frames:
+// the map layer is rebuilt only when the path or the viewport moves and
+// the tower range overlay only when towers change. Render() returns a
+// single node that paints the cells straight into the screen instead of
+// one text element per cell.
+class BoardRenderer {
+public:
+  ftxui::Element Render(const Simulation &sim, const BoardView &view);
+
+  // Cells drawn by the last Render(), the viewport row-major.
+  const BoardGrid<BoardCell> &cells() const { return *frame_; }
+  // Board cell of cells()(0, 0).
+  const Position &origin() const { return origin_; }
+
+private:
+  // Ground and path for the size-cell viewport at origin_.
+  void RebuildMapLayer(const Simulation &sim, const BoardSize &size);
+  void RebuildRangeLayer(const Simulation &sim);
+  void Compose(const Simulation &sim, const BoardView &view);
+
+  Position origin_{};
+  BoardGrid<BoardCell> map_layer_; // the viewport's ground and path
+  Position map_origin_{};
+  std::vector<Position> map_path_; // path map_layer_ was built from
+  int map_index_ = -1;
+  BoardBitset range_layer_;         // whole board
+  std::vector<Tower> range_towers_; // towers range_layer_ was built from
+  bool range_layer_valid_ = false;
+  BoardBitset preview_mask_; // viewport cells
+  BoardBitset enemy_mask_;   // viewport cells
+  // Shared with the node returned by Render(); replaced only while an older
+  // frame's node still holds it.
+  std::shared_ptr<BoardGrid<BoardCell>> frame_ =
+      std::make_shared<BoardGrid<BoardCell>>();
+};
+
+// A small overview of a board larger than the viewport. Each minimap cell
+// sums up a block of board cells (path, cats and how many enemies stand
+// there) and the viewport is outlined. Built from the path, tower and enemy
+// lists, so it costs what they hold plus its own size, whatever the board's
+// area.
+class MinimapRenderer {
+public:
+  // At most max_size cells, one terminal column each.
+  ftxui::Element Render(const Simulation &sim, const BoardView &view,
+                        const BoardSize &max_size);
+
+private:
+  BoardGrid<uint16_t> enemies_; // per block
+  BoardGrid<uint8_t> marks_;    // per block: path and tower bits
+  std::shared_ptr<BoardGrid<BoardCell>> frame_ =
+      std::make_shared<BoardGrid<BoardCell>>();
+};
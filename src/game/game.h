@@ -1,7 +1,23 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
+#include <string>
+
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 
+struct GameOptions {
+  bool dev_mode = false;
+  std::optional<uint64_t> seed; // unset: a random seed
+  std::string record_path;      // non-empty: write a replay log there
+  // Non-empty: resume from this save state if it exists, and save to it
+  // on quit.
+  std::string resume_path;
+  // Non-empty: log a Chrome trace of tick phases and frames, written there
+  // on quit.
+  std::string trace_path;
+};
+
 ftxui::Component MakeGameComponent(ftxui::ScreenInteractive &screen,
-                                   bool dev_mode = false);
+                                   const GameOptions &options = {});
@@ -1,19 +1,109 @@
+#include <cstdio>
+#include <iostream>
+#include <limits>
 #include <string>
+#include <utility>
 
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 
 #include "game/game.h"
+#include "sim/batch.h"
+#include "sim/definitions.h"
+#include "sim/headless.h"
+#include "sim/replay.h"
 #include "version/version.h"
 
+namespace {
+
+void PrintResult(const HeadlessResult &result) {
+  const char *outcome = result.victory     ? "victory"
+                        : result.game_over ? "game_over"
+                                           : "stopped";
+  std::printf("wave=%d map=%d lives=%d kibbles=%d result=%s ticks=%lld "
+              "elapsed_ms=%.3f\n",
+              result.wave, result.map_index + 1, result.lives, result.kibbles,
+              outcome, result.ticks, result.elapsed_ms);
+  if (result.tick_stats.has_value()) {
+    const TickStats &t = *result.tick_stats;
+    std::printf("ticks_per_sec=%.0f tick_p50_us=%.2f tick_p99_us=%.2f "
+                "tick_max_us=%.2f peak_enemies=%zu\n",
+                t.ticks_per_sec, t.p50_us, t.p99_us, t.max_us,
+                result.peak_enemies);
+  }
+}
+
+} // namespace
+
 int main(int argc, const char *argv[]) {
+  GameOptions game_options;
   bool dev_mode = false;
   bool show_version = false;
+  bool headless = false;
+  HeadlessOptions headless_options;
+  bool max_waves_given = false;
+  bool stress = false;
+  std::string batch_path;
+  int batch_jobs = 0;
+  std::string replay_path;
+  std::string defs_path;
   for (int i = 1; i < argc; ++i) {
-    if (std::string(argv[i]) == "--dev") {
+    const std::string arg = argv[i];
+    if (arg == "--dev") {
       dev_mode = true;
-    } else if (std::string(argv[i]) == "--version") {
+    } else if (arg == "--version") {
       show_version = true;
+    } else if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--script" && i + 1 < argc) {
+      headless_options.script_path = argv[++i];
+    } else if (arg == "--max-waves" && i + 1 < argc) {
+      headless_options.max_waves = std::stoi(argv[++i]);
+      max_waves_given = true;
+    } else if (arg == "--max-ticks" && i + 1 < argc) {
+      headless_options.max_ticks = std::stoll(argv[++i]);
+    } else if (arg == "--endless") {
+      headless_options.waves.endless = true;
+      headless_options.tick_stats = true;
+    } else if (arg == "--stress") {
+      // Endless swarms that grow fast and never end the run on leaks.
+      headless_options.waves.endless = true;
+      headless_options.waves.swarm_every = 5;
+      headless_options.waves.growth = 4.0F;
+      headless_options.waves.leaks_cost_lives = false;
+      headless_options.tick_stats = true;
+      stress = true;
+      headless = true;
+    } else if (arg == "--tick-stats") {
+      headless_options.tick_stats = true;
+    } else if (arg == "--wave-growth" && i + 1 < argc) {
+      headless_options.waves.growth = std::stof(argv[++i]);
+    } else if (arg == "--swarm-every" && i + 1 < argc) {
+      headless_options.waves.swarm_every = std::stoi(argv[++i]);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      headless_options.threads = std::stoi(argv[++i]);
+    } else if (arg == "--batch" && i + 1 < argc) {
+      batch_path = argv[++i];
+    } else if (arg == "--jobs" && i + 1 < argc) {
+      batch_jobs = std::stoi(argv[++i]);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      headless_options.seed = std::stoull(argv[++i]);
+      game_options.seed = headless_options.seed;
+    } else if (arg == "--record" && i + 1 < argc) {
+      game_options.record_path = argv[++i];
+    } else if (arg == "--replay" && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (arg == "--snapshot" && i + 1 < argc) {
+      headless_options.snapshot_path = argv[++i];
+    } else if (arg == "--save" && i + 1 < argc) {
+      headless_options.save_path = argv[++i];
+    } else if (arg == "--resume" && i + 1 < argc) {
+      game_options.resume_path = argv[++i];
+    } else if (arg == "--trace" && i + 1 < argc) {
+      headless_options.trace_path = argv[++i];
+      game_options.trace_path = headless_options.trace_path;
+    } else if (arg == "--defs" && i + 1 < argc) {
+      defs_path = argv[++i];
     }
   }
 
@@ -21,12 +111,49 @@ int main(int argc, const char *argv[]) {
     CheckForUpdates(false, true);
     return 0;
   }
-  if (CheckForUpdates() == UpdateAction::Exit) {
+  if (!defs_path.empty()) {
+    auto defs = LoadDefinitions(defs_path);
+    if (defs == nullptr) {
+      return 1;
+    }
+    Definitions::SetActive(std::move(defs));
+  }
+  if (!batch_path.empty()) {
+    const auto runs = LoadBatch(batch_path);
+    if (!runs.has_value()) {
+      return 1;
+    }
+    return RunBatch(*runs, batch_jobs, std::cout) ? 0 : 1;
+  }
+  if (!replay_path.empty()) {
+    const auto log = LoadReplay(replay_path);
+    if (!log.has_value()) {
+      return 1;
+    }
+    PrintResult(RunReplay(*log, headless_options.threads));
+    return 0;
+  }
+  if (headless) {
+    headless_options.dev_mode = dev_mode;
+    if (headless_options.waves.endless && !max_waves_given) {
+      // Stress runs stop ten endless levels in by default.
+      headless_options.max_waves =
+          stress ? 200 : std::numeric_limits<int>::max();
+    }
+    const auto result = RunHeadless(headless_options);
+    if (!result.has_value()) {
+      return 1;
+    }
+    PrintResult(*result);
     return 0;
   }
-
+  if (!game_options.record_path.empty() && !game_options.resume_path.empty()) {
+    std::cerr << "catcat: --record cannot be combined with --resume\n";
+    return 1;
+  }
   auto screen = ftxui::ScreenInteractive::Fullscreen();
-  auto component = MakeGameComponent(screen, dev_mode);
+  game_options.dev_mode = dev_mode;
+  auto component = MakeGameComponent(screen, game_options);
   screen.Loop(component);
   return 0;
 }
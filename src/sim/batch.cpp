@@ -0,0 +1,181 @@
+#include "sim/batch.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include <nlohmann/json.hpp>
+
+#include "sim/snapshot.h"
+#include "sim/worker_pool.h"
+
+namespace {
+
+using nlohmann::json;
+
+// Overwrites run, seed and count with the fields j sets. Throws
+// json::exception on a field of the wrong type.
+void ApplyFields(const json &j, BatchRun &run, uint64_t &seed, int &count) {
+  auto &o = run.options;
+  run.name = j.value("name", run.name);
+  seed = j.value("seed", seed);
+  count = j.value("count", count);
+  o.dev_mode = j.value("dev", o.dev_mode);
+  o.script_path = j.value("script", o.script_path);
+  o.snapshot_path = j.value("snapshot", o.snapshot_path);
+  o.max_waves = j.value("max_waves", o.max_waves);
+  o.difficulty.offset = j.value("difficulty_offset", o.difficulty.offset);
+  o.difficulty.per_map = j.value("difficulty_per_map", o.difficulty.per_map);
+  o.max_ticks = j.value("max_ticks", o.max_ticks);
+  o.waves.endless = j.value("endless", o.waves.endless);
+  o.waves.growth = j.value("wave_growth", o.waves.growth);
+  o.waves.swarm_every = j.value("swarm_every", o.waves.swarm_every);
+  o.waves.leaks_cost_lives =
+      j.value("leaks_cost_lives", o.waves.leaks_cost_lives);
+}
+
+const char *Outcome(const HeadlessResult &r) {
+  return r.victory ? "victory" : r.game_over ? "game_over" : "stopped";
+}
+
+// For a run that could not be played, with the reason.
+std::string ErrorLine(size_t index, const BatchRun &run,
+                      const std::string &error) {
+  nlohmann::ordered_json j;
+  j["run"] = index;
+  j["name"] = run.name;
+  j["seed"] = run.options.seed.value_or(0);
+  j["result"] = "error";
+  j["error"] = error;
+  return j.dump();
+}
+
+std::string ResultLine(size_t index, const BatchRun &run,
+                       const HeadlessResult &r) {
+  nlohmann::ordered_json j; // keys in the order written
+  j["run"] = index;
+  j["name"] = run.name;
+  j["seed"] = run.options.seed.value_or(0);
+  j["result"] = Outcome(r);
+  j["wave"] = r.wave;
+  j["map"] = r.map_index + 1;
+  j["lives"] = r.lives;
+  j["kibbles"] = r.kibbles;
+  j["lives_lost"] = r.lives_lost_per_map;
+  j["ticks"] = r.ticks;
+  j["elapsed_ms"] = r.elapsed_ms;
+  return j.dump();
+}
+
+} // namespace
+
+std::optional<std::vector<BatchRun>> ParseBatch(std::istream &in,
+                                                const std::string &origin) {
+  std::vector<BatchRun> runs;
+  try {
+    const json doc = json::parse(in);
+    BatchRun defaults;
+    uint64_t default_seed = 1;
+    int default_count = 1;
+    const json *list = &doc;
+    if (doc.is_object()) {
+      if (doc.contains("defaults")) {
+        ApplyFields(doc.at("defaults"), defaults, default_seed,
+                    default_count);
+      }
+      list = &doc.at("runs");
+    }
+    if (!list->is_array()) {
+      std::cerr << "catcat: " << origin << ": expected an array of runs\n";
+      return std::nullopt;
+    }
+    for (const auto &entry : *list) {
+      BatchRun run = defaults;
+      uint64_t seed = default_seed;
+      int count = default_count;
+      ApplyFields(entry, run, seed, count);
+      for (int i = 0; i < count; ++i) {
+        run.options.seed = seed + static_cast<uint64_t>(i);
+        runs.push_back(run);
+      }
+    }
+  } catch (const json::exception &e) {
+    std::cerr << "catcat: " << origin << ": " << e.what() << "\n";
+    return std::nullopt;
+  }
+  return runs;
+}
+
+std::optional<std::vector<BatchRun>> LoadBatch(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "catcat: cannot open batch file " << path << "\n";
+    return std::nullopt;
+  }
+  return ParseBatch(in, path);
+}
+
+bool RunBatch(const std::vector<BatchRun> &runs, int jobs, std::ostream &out) {
+  // Each script is parsed once, then only read by the workers.
+  std::map<std::string, HeadlessScript> scripts;
+  for (const auto &run : runs) {
+    const auto &path = run.options.script_path;
+    if (path.empty() || scripts.contains(path)) {
+      continue;
+    }
+    auto script = LoadHeadlessScript(path);
+    if (!script.has_value()) {
+      return false;
+    }
+    scripts.emplace(path, std::move(*script));
+  }
+  // Snapshots are mapped once and restored by every run that starts there.
+  std::map<std::string, SnapshotFile> snapshots;
+  for (const auto &run : runs) {
+    const auto &path = run.options.snapshot_path;
+    if (path.empty() || snapshots.contains(path)) {
+      continue;
+    }
+    auto snapshot = SnapshotFile::Open(path);
+    if (!snapshot.has_value()) {
+      return false;
+    }
+    snapshots.emplace(path, std::move(*snapshot));
+  }
+
+  const HeadlessScript no_script;
+  std::mutex out_mutex; // taken once per finished run, never mid-game
+  std::atomic<bool> all_played{true};
+  WorkerPool pool(jobs);
+  pool.ParallelFor(
+      runs.size(),
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          HeadlessOptions options = runs[i].options;
+          options.threads = 1; // runs already fill the cores
+          options.save_path.clear(); // runs would all share one file
+          options.trace_path.clear();
+          const auto it = scripts.find(options.script_path);
+          const auto snap = snapshots.find(options.snapshot_path);
+          const auto result = RunHeadless(
+              options, it == scripts.end() ? no_script : it->second,
+              snap == snapshots.end() ? std::span<const std::byte>{}
+                                      : snap->second.bytes());
+          if (!result.has_value()) {
+            all_played = false;
+          }
+          const std::string line =
+              result.has_value()
+                  ? ResultLine(i, runs[i], *result)
+                  : ErrorLine(i, runs[i],
+                              "snapshot " + options.snapshot_path +
+                                  " does not fit this game");
+          std::lock_guard<std::mutex> lock(out_mutex);
+          out << line << std::endl;
+        }
+      },
+      /*chunk=*/1);
+  return all_played;
+}
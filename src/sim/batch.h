@@ -0,0 +1,35 @@
+#pragma once
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "sim/headless.h"
+
+// One seeded headless game in a batch.
+struct BatchRun {
+  std::string name;
+  HeadlessOptions options;
+};
+
+// Reads a runs file, either {"defaults": {...}, "runs": [...]} or a bare
+// array of runs. A run (or the defaults) may set name, seed, count, dev,
+// script, snapshot, max_waves, difficulty_offset and difficulty_per_map;
+// whatever a run leaves out comes from the defaults. A run with count N
+// expands into N runs seeded seed, seed + 1, ... (seed defaults to 1), so
+// runs from one snapshot still differ. Script and snapshot paths are
+// relative to the working directory, as with --script. Prints the problem
+// and returns std::nullopt on error; origin names the input in messages.
+std::optional<std::vector<BatchRun>> ParseBatch(std::istream &in,
+                                                const std::string &origin);
+std::optional<std::vector<BatchRun>> LoadBatch(const std::string &path);
+
+// Plays every run on `jobs` threads (0 = one per core), one run per task,
+// and writes each result to out as a JSON line as soon as it finishes, so
+// lines arrive in completion order; "run" is the index into runs. Runs
+// share nothing but the loaded scripts and snapshots and the output stream.
+// Returns false, running nothing, if a script or snapshot cannot be loaded.
+// A run whose snapshot does not fit the loaded definitions is written as
+// "result": "error" with the reason, and makes the return false too.
+bool RunBatch(const std::vector<BatchRun> &runs, int jobs, std::ostream &out);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+// Board dimensions and the coordinate types shared by the simulation.
+
+// The default board, used by every built-in map.
+constexpr int kBoardWidth = 48;
+constexpr int kBoardHeight = 28;
+// Largest side a map may declare.
+constexpr int kMaxBoardSide = 4096;
+
+struct Position {
+  int x = 0;
+  int y = 0;
+};
+
+struct Vec2 {
+  float x = 0.0F;
+  float y = 0.0F;
+};
+
+// A board's size in cells. Each map has its own; cells are numbered
+// row-major.
+struct BoardSize {
+  int width = kBoardWidth;
+  int height = kBoardHeight;
+
+  bool Contains(int x, int y) const {
+    return x >= 0 && y >= 0 && x < width && y < height;
+  }
+  bool Contains(const Position &p) const { return Contains(p.x, p.y); }
+  size_t cells() const {
+    return static_cast<size_t>(width) * static_cast<size_t>(height);
+  }
+  size_t Index(int x, int y) const {
+    return static_cast<size_t>(y) * static_cast<size_t>(width) +
+           static_cast<size_t>(x);
+  }
+
+  friend bool operator==(const BoardSize &, const BoardSize &) = default;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sim/board.h"
+
+// One bit per board cell, rows packed into 64-bit words (bit x % 64 of word
+// x / 64 is column x). Boards up to 64 wide, like the default one, keep one
+// word per row. Sized by the board it covers; masks combined with each
+// other must cover the same board. Reads and writes off the board are
+// ignored.
+class BoardBitset {
+public:
+  BoardBitset() : BoardBitset(BoardSize{}) {}
+  explicit BoardBitset(const BoardSize &board) { Resize(board); }
+
+  // Covers board instead, with every cell clear.
+  void Resize(const BoardSize &board) {
+    board_ = board;
+    stride_ = (static_cast<size_t>(board.width) + 63) / 64;
+    words_.assign(stride_ * static_cast<size_t>(board.height), 0);
+  }
+  const BoardSize &board() const { return board_; }
+
+  bool OnBoard(int x, int y) const { return board_.Contains(x, y); }
+
+  bool Test(int x, int y) const {
+    return OnBoard(x, y) && ((Word(x, y) >> (x % 64)) & 1U) != 0;
+  }
+  bool Test(const Position &p) const { return Test(p.x, p.y); }
+  void Set(int x, int y) {
+    if (OnBoard(x, y)) {
+      Word(x, y) |= uint64_t{1} << (x % 64);
+    }
+  }
+  void Set(const Position &p) { Set(p.x, p.y); }
+  void Clear(int x, int y) {
+    if (OnBoard(x, y)) {
+      Word(x, y) &= ~(uint64_t{1} << (x % 64));
+    }
+  }
+  void Reset() { std::fill(words_.begin(), words_.end(), 0); }
+
+  // Sets or clears every cell in [x0, x1] x [y0, y1], clipped to the board.
+  void SetRect(int x0, int y0, int x1, int y1) {
+    ForRect(*this, x0, y0, x1, y1, [](uint64_t &word, uint64_t bits) {
+      word |= bits;
+      return false;
+    });
+  }
+  void ClearRect(int x0, int y0, int x1, int y1) {
+    ForRect(*this, x0, y0, x1, y1, [](uint64_t &word, uint64_t bits) {
+      word &= ~bits;
+      return false;
+    });
+  }
+  // True if any cell in [x0, x1] x [y0, y1] (clipped to the board) is set.
+  bool AnyInRect(int x0, int y0, int x1, int y1) const {
+    return ForRect(*this, x0, y0, x1, y1, [](uint64_t word, uint64_t bits) {
+      return (word & bits) != 0;
+    });
+  }
+
+  BoardBitset &operator|=(const BoardBitset &other) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      words_[i] |= other.words_[i];
+    }
+    return *this;
+  }
+  BoardBitset &operator&=(const BoardBitset &other) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      words_[i] &= other.words_[i];
+    }
+    return *this;
+  }
+  // Clears every cell set in other.
+  BoardBitset &AndNot(const BoardBitset &other) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      words_[i] &= ~other.words_[i];
+    }
+    return *this;
+  }
+  friend BoardBitset operator|(BoardBitset a, const BoardBitset &b) {
+    return a |= b;
+  }
+  friend BoardBitset operator&(BoardBitset a, const BoardBitset &b) {
+    return a &= b;
+  }
+  friend bool operator==(const BoardBitset &a, const BoardBitset &b) {
+    return a.board_ == b.board_ && a.words_ == b.words_;
+  }
+
+  int Count() const {
+    int count = 0;
+    for (uint64_t word : words_) {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+  bool None() const {
+    return std::all_of(words_.begin(), words_.end(),
+                       [](uint64_t word) { return word == 0; });
+  }
+
+  // Calls fn(x, y) for every set cell in row-major order.
+  template <typename Fn> void ForEach(Fn &&fn) const {
+    for (int y = 0; y < board_.height; ++y) {
+      const size_t row = static_cast<size_t>(y) * stride_;
+      for (size_t w = 0; w < stride_; ++w) {
+        const int base = static_cast<int>(w * 64);
+        for (uint64_t bits = words_[row + w]; bits != 0; bits &= bits - 1) {
+          fn(base + std::countr_zero(bits), y);
+        }
+      }
+    }
+  }
+
+private:
+  uint64_t &Word(int x, int y) {
+    return words_[static_cast<size_t>(y) * stride_ +
+                  static_cast<size_t>(x / 64)];
+  }
+  uint64_t Word(int x, int y) const {
+    return words_[static_cast<size_t>(y) * stride_ +
+                  static_cast<size_t>(x / 64)];
+  }
+
+  // Calls fn(word, bits) for every word overlapping [x0, x1] x [y0, y1]
+  // clipped to the board, with bits the rectangle's columns in that word.
+  // Stops early and returns true once fn does. Self is const for reads.
+  template <typename Self, typename Fn>
+  static bool ForRect(Self &self, int x0, int y0, int x1, int y1, Fn fn) {
+    x0 = std::max(0, x0);
+    x1 = std::min(self.board_.width - 1, x1);
+    y0 = std::max(0, y0);
+    y1 = std::min(self.board_.height - 1, y1);
+    if (x0 > x1) {
+      return false;
+    }
+    for (int y = y0; y <= y1; ++y) {
+      const size_t row = static_cast<size_t>(y) * self.stride_;
+      for (int w = x0 / 64; w <= x1 / 64; ++w) {
+        const int lo = std::max(x0, w * 64) - w * 64;
+        const int hi = std::min(x1, w * 64 + 63) - w * 64;
+        const int span = hi - lo + 1;
+        const uint64_t ones =
+            span == 64 ? ~uint64_t{0} : (uint64_t{1} << span) - 1;
+        if (fn(self.words_[row + static_cast<size_t>(w)], ones << lo)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  BoardSize board_;
+  size_t stride_ = 1; // words per row
+  std::vector<uint64_t> words_;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "sim/board.h"
+
+// One T per board cell in a single row-major allocation, sized at run time.
+// Indexing does no bounds checks; callers clip to size() first.
+template <typename T> class BoardGrid {
+public:
+  BoardGrid() : BoardGrid(BoardSize{}) {}
+  explicit BoardGrid(const BoardSize &size, const T &fill = T{})
+      : size_(size), cells_(size.cells(), fill) {}
+
+  // Resizes to size with every cell set to fill; keeps the allocation when
+  // it is already large enough.
+  void Assign(const BoardSize &size, const T &fill = T{}) {
+    size_ = size;
+    cells_.assign(size.cells(), fill);
+  }
+  void Fill(const T &fill) { std::fill(cells_.begin(), cells_.end(), fill); }
+
+  const BoardSize &size() const { return size_; }
+
+  T &operator()(int x, int y) { return cells_[size_.Index(x, y)]; }
+  const T &operator()(int x, int y) const { return cells_[size_.Index(x, y)]; }
+  T &operator[](const Position &p) { return (*this)(p.x, p.y); }
+  const T &operator[](const Position &p) const { return (*this)(p.x, p.y); }
+
+  std::span<T> Row(int y) {
+    return std::span<T>(cells_).subspan(size_.Index(0, y),
+                                        static_cast<size_t>(size_.width));
+  }
+  std::span<const T> Row(int y) const {
+    return std::span<const T>(cells_).subspan(
+        size_.Index(0, y), static_cast<size_t>(size_.width));
+  }
+  // Every cell, row-major.
+  std::span<T> cells() { return cells_; }
+  std::span<const T> cells() const { return cells_; }
+
+private:
+  BoardSize size_;
+  std::vector<T> cells_;
+};
@@ -0,0 +1,73 @@
+#include "sim/cone_stencils.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+uint64_t ConeStencils::Key(int size, float range, int target_dx,
+                           int target_dy) {
+  // Offsets are bounded by the board, so 12 bits each is plenty.
+  return (static_cast<uint64_t>(std::bit_cast<uint32_t>(range)) << 32) |
+         (static_cast<uint64_t>(static_cast<uint8_t>(size)) << 24) |
+         (static_cast<uint64_t>(static_cast<uint16_t>(target_dx) & 0xFFFU)
+          << 12) |
+         (static_cast<uint64_t>(static_cast<uint16_t>(target_dy) & 0xFFFU));
+}
+
+const ConeStencil &ConeStencils::Get(int size, float range, int target_dx,
+                                     int target_dy) {
+  const uint64_t key = Key(size, range, target_dx, target_dy);
+  auto it = stencils_.find(key);
+  if (it == stencils_.end()) {
+    it = stencils_
+             .emplace(key, Build(size, range, target_dx, target_dy))
+             .first;
+  }
+  return it->second;
+}
+
+const ConeStencil *ConeStencils::Find(int size, float range, int target_dx,
+                                      int target_dy) const {
+  const auto it = stencils_.find(Key(size, range, target_dx, target_dy));
+  return it == stencils_.end() ? nullptr : &it->second;
+}
+
+// Same arithmetic as aiming from the tower's center on the board: with the
+// tower at the origin every coordinate is a small integer or half-integer,
+// so the floats match the absolute-position computation exactly.
+ConeStencil ConeStencils::Build(int size, float range, int target_dx,
+                                int target_dy) {
+  const float cx = (static_cast<float>(size) - 1.0F) / 2.0F;
+  const float cy = cx;
+  const float dx = static_cast<float>(target_dx) - cx;
+  const float dy = static_cast<float>(target_dy) - cy;
+  const float len = std::max(0.001F, std::sqrt(dx * dx + dy * dy));
+  const float ndx = dx / len;
+  const float ndy = dy / len;
+  const float cone_cos = std::cos(0.6F); // ~60 deg cone
+
+  ConeStencil stencil;
+  stencil.half = static_cast<int>(std::ceil(range)) + size;
+  const int side = 2 * stencil.half + 1;
+  stencil.bits.assign(static_cast<size_t>(side * side + 63) / 64, 0);
+  for (int y = -stencil.half; y <= stencil.half; ++y) {
+    for (int x = -stencil.half; x <= stencil.half; ++x) {
+      const float vx = static_cast<float>(x) - cx;
+      const float vy = static_cast<float>(y) - cy;
+      const float dist2 = vx * vx + vy * vy;
+      if (dist2 > range * range)
+        continue;
+      const float dist = std::sqrt(dist2);
+      if (dist < 0.1F)
+        continue;
+      const float dot = (vx / dist) * ndx + (vy / dist) * ndy;
+      if (dot >= cone_cos) {
+        const auto bit = static_cast<size_t>((y + stencil.half) * side +
+                                             (x + stencil.half));
+        stencil.bits[bit / 64] |= uint64_t{1} << (bit % 64);
+        stencil.offsets.push_back({x, y});
+      }
+    }
+  }
+  return stencil;
+}
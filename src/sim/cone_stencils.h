@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "sim/board.h"
+
+// The galactic cone aimed from a tower at one target cell, as offsets from
+// the tower's top-left cell. A shot only depends on the tower's size and
+// range and the target's offset, so every shot with the same shape reuses
+// the stencil instead of rescanning the board.
+struct ConeStencil {
+  int half = 0; // mask window spans [-half, half] on both axes
+  std::vector<uint64_t> bits;    // window mask, row-major
+  std::vector<Position> offsets; // cells in the cone, row-major
+
+  bool Contains(int dx, int dy) const {
+    if (dx < -half || dx > half || dy < -half || dy > half) {
+      return false;
+    }
+    const auto bit = static_cast<size_t>((dy + half) * (2 * half + 1) +
+                                         (dx + half));
+    return (bits[bit / 64] >> (bit % 64)) & 1U;
+  }
+};
+
+// Lazily built cone stencils keyed by tower size, range and target offset.
+class ConeStencils {
+public:
+  const ConeStencil &Get(int size, float range, int target_dx, int target_dy);
+  // The stencil if Get() already built it, else nullptr. Safe to call from
+  // several threads as long as none of them calls Get() or Clear().
+  const ConeStencil *Find(int size, float range, int target_dx,
+                          int target_dy) const;
+  void Clear() { stencils_.clear(); }
+  size_t size() const { return stencils_.size(); }
+
+private:
+  static uint64_t Key(int size, float range, int target_dx, int target_dy);
+  static ConeStencil Build(int size, float range, int target_dx,
+                           int target_dy);
+
+  std::unordered_map<uint64_t, ConeStencil> stencils_;
+};
@@ -0,0 +1,275 @@
+#include "sim/definitions.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+namespace {
+
+using nlohmann::json;
+
+constexpr std::array<TowerDef, kTowerTypeCount> kBuiltinTowers = {{
+    {Tower::Type::Default, "Default Cat", 35, 3, 4.5F, 0.85F, true, 1},
+    {Tower::Type::Fat, "Fat Cat", 35, 4, 2.4F, 1.4F, true, 2},
+    {Tower::Type::Kitty, "Kitty Cat", 50, 3, 3.0F, 1.0F, true, 1},
+    {Tower::Type::Thunder, "Thundercat", 100, 6, 999.0F, 2.6F, false, 1},
+    {Tower::Type::Catatonic, "Catatonic", 150, 2, 3.2F, 2.2F, true, 1},
+    {Tower::Type::Galactic, "Galacticat", 200, 20, 7.5F, 2.5F, true, 1},
+}};
+constexpr std::array<const char *, kTowerTypeCount> kTowerKeys = {
+    "default", "fat", "kitty", "thunder", "catatonic", "galactic"};
+
+constexpr std::array<EnemyDef, kEnemyTypeCount> kBuiltinEnemies = {{
+    {2, 1.0F, 0.95F, 0.05F, 8},    // Mouse
+    {5, 2.5F, 0.65F, 0.065F, 12},  // Rat
+    {15, 4.0F, 0.55F, 0.045F, 20}, // BigRat
+    {28, 6.0F, 0.9F, 0.055F, 30},  // Dog
+}};
+constexpr std::array<const char *, kEnemyTypeCount> kEnemyKeys = {
+    "mouse", "rat", "bigrat", "dog"};
+
+constexpr int kMaxPathWidth = 4;
+constexpr int kMinBoardSide = 8;
+
+struct BuiltinMap {
+  std::span<const Position> anchors;
+  int path_width;
+};
+
+constexpr Position kMap1[] = {{0, kBoardHeight / 2},
+                              {12, kBoardHeight / 2},
+                              {12, 4},
+                              {30, 4},
+                              {30, kBoardHeight - 5},
+                              {kBoardWidth - 1, kBoardHeight - 5}};
+constexpr Position kMap2[] = {{0, 3},
+                              {10, 3},
+                              {10, 12},
+                              {25, 12},
+                              {25, kBoardHeight - 6},
+                              {kBoardWidth - 1, kBoardHeight - 6}};
+constexpr Position kMap3[] = {{0, kBoardHeight - 4},
+                              {15, kBoardHeight - 4},
+                              {15, 6},
+                              {32, 6},
+                              {32, kBoardHeight / 2},
+                              {kBoardWidth - 1, kBoardHeight / 2}};
+constexpr Position kMap4[] = {{0, kBoardHeight / 2},
+                              {8, kBoardHeight / 2},
+                              {8, 6},
+                              {20, 6},
+                              {20, kBoardHeight - 8},
+                              {35, kBoardHeight - 8},
+                              {35, 5},
+                              {kBoardWidth - 1, 5}};
+constexpr Position kMap5[] = {{0, 8},
+                              {14, 8},
+                              {14, kBoardHeight - 6},
+                              {28, kBoardHeight - 6},
+                              {28, 6},
+                              {kBoardWidth - 1, 6}};
+constexpr Position kMap6[] = {{0, kBoardHeight / 2},
+                              {10, kBoardHeight / 2},
+                              {10, 3},
+                              {20, 3},
+                              {20, kBoardHeight - 4},
+                              {40, kBoardHeight - 4},
+                              {40, 8},
+                              {kBoardWidth - 1, 8}};
+constexpr Position kMap7[] = {{0, kBoardHeight - 5},
+                              {18, kBoardHeight - 5},
+                              {18, 5},
+                              {kBoardWidth - 2, 5},
+                              {kBoardWidth - 2, kBoardHeight / 2}};
+constexpr Position kMap8[] = {{0, 4},
+                              {8, 4},
+                              {8, kBoardHeight - 4},
+                              {24, kBoardHeight - 4},
+                              {24, 4},
+                              {kBoardWidth - 1, 4}};
+constexpr Position kMap9[] = {{0, kBoardHeight / 2},
+                              {12, kBoardHeight / 2},
+                              {12, 6},
+                              {22, 6},
+                              {22, kBoardHeight - 7},
+                              {34, kBoardHeight - 7},
+                              {34, 5},
+                              {kBoardWidth - 1, 5}};
+constexpr Position kMap10[] = {{0, 2},
+                               {16, 2},
+                               {16, kBoardHeight - 3},
+                               {30, kBoardHeight - 3},
+                               {30, 7},
+                               {kBoardWidth - 1, 7}};
+
+constexpr std::array<BuiltinMap, 10> kBuiltinMaps = {{
+    {kMap1, 1},
+    {kMap2, 2},
+    {kMap3, 1},
+    {kMap4, 3},
+    {kMap5, 2},
+    {kMap6, 2},
+    {kMap7, 1},
+    {kMap8, 2},
+    {kMap9, 2},
+    {kMap10, 3},
+}};
+
+// Empty if map is usable, otherwise what is wrong with it.
+std::string MapProblem(const MapDef &map) {
+  if (map.anchors.size() < 2) {
+    return "needs at least two path points";
+  }
+  if (map.path_width < 1 || map.path_width > kMaxPathWidth) {
+    return "path_width must be 1 to " + std::to_string(kMaxPathWidth);
+  }
+  if (map.board.width < kMinBoardSide || map.board.height < kMinBoardSide ||
+      map.board.width > kMaxBoardSide || map.board.height > kMaxBoardSide) {
+    return "width and height must be " + std::to_string(kMinBoardSide) +
+           " to " + std::to_string(kMaxBoardSide);
+  }
+  for (size_t i = 0; i < map.anchors.size(); ++i) {
+    const Position &p = map.anchors[i];
+    if (!map.board.Contains(p)) {
+      return "path point " + std::to_string(i) + " is off the board";
+    }
+    if (i > 0 && p.x != map.anchors[i - 1].x && p.y != map.anchors[i - 1].y) {
+      return "path points " + std::to_string(i - 1) + " and " +
+             std::to_string(i) + " are not in a straight line";
+    }
+  }
+  return {};
+}
+
+std::unique_ptr<const Definitions> &ActiveSlot() {
+  static std::unique_ptr<const Definitions> active;
+  return active;
+}
+
+} // namespace
+
+Definitions::Definitions() : towers_(kBuiltinTowers), enemies_(kBuiltinEnemies) {
+  maps_.reserve(kBuiltinMaps.size());
+  for (const auto &m : kBuiltinMaps) {
+    maps_.push_back(
+        {{m.anchors.begin(), m.anchors.end()}, m.path_width, BoardSize{}});
+  }
+  SortByCost();
+}
+
+void Definitions::SortByCost() {
+  by_cost_ = towers_;
+  std::sort(by_cost_.begin(), by_cost_.end(),
+            [](const TowerDef &a, const TowerDef &b) {
+              if (a.cost == b.cost)
+                return a.name < b.name;
+              return a.cost < b.cost;
+            });
+}
+
+const Definitions &Definitions::Builtin() {
+  static const Definitions builtin;
+  return builtin;
+}
+
+const Definitions &Definitions::Active() {
+  const auto &active = ActiveSlot();
+  return active ? *active : Builtin();
+}
+
+void Definitions::SetActive(std::unique_ptr<const Definitions> defs) {
+  ActiveSlot() = std::move(defs);
+}
+
+std::unique_ptr<Definitions> ParseDefinitions(std::istream &in,
+                                              const std::string &origin) {
+  std::unique_ptr<Definitions> defs(new Definitions());
+  const auto fail = [&](const std::string &problem) {
+    std::cerr << "catcat: " << origin << ": " << problem << "\n";
+    return nullptr;
+  };
+  try {
+    const json doc = json::parse(in);
+    if (!doc.is_object()) {
+      return fail("expected an object");
+    }
+    const json towers = doc.value("towers", json::object());
+    const json enemies = doc.value("enemies", json::object());
+    for (const auto &[key, j] : towers.items()) {
+      const auto it = std::find(kTowerKeys.begin(), kTowerKeys.end(), key);
+      if (it == kTowerKeys.end()) {
+        return fail("unknown tower \"" + key + "\"");
+      }
+      const auto index = static_cast<size_t>(it - kTowerKeys.begin());
+      TowerDef &d = defs->towers_[index];
+      if (j.contains("name")) {
+        defs->names_[index] = j.at("name").get<std::string>();
+        d.name = defs->names_[index];
+      }
+      d.cost = j.value("cost", d.cost);
+      d.damage = j.value("damage", d.damage);
+      d.range = j.value("range", d.range);
+      d.fire_rate = j.value("fire_rate", d.fire_rate);
+      d.show_range = j.value("show_range", d.show_range);
+      d.size = j.value("size", d.size);
+      if (d.name.empty() || d.cost <= 0 || d.damage < 0 || d.range <= 0.0F ||
+          d.fire_rate <= 0.0F || d.size < 1 || d.size > 2) {
+        return fail("tower \"" + key + "\" has an out-of-range value");
+      }
+    }
+    for (const auto &[key, j] : enemies.items()) {
+      const auto it = std::find(kEnemyKeys.begin(), kEnemyKeys.end(), key);
+      if (it == kEnemyKeys.end()) {
+        return fail("unknown enemy \"" + key + "\"");
+      }
+      EnemyDef &d = defs->enemies_[static_cast<size_t>(it - kEnemyKeys.begin())];
+      d.hp = j.value("hp", d.hp);
+      d.hp_per_level = j.value("hp_per_level", d.hp_per_level);
+      d.speed = j.value("speed", d.speed);
+      d.speed_per_level = j.value("speed_per_level", d.speed_per_level);
+      d.bounty = j.value("bounty", d.bounty);
+      if (d.hp <= 0 || d.hp_per_level < 0.0F || d.speed <= 0.0F ||
+          d.speed_per_level < 0.0F || d.bounty < 0) {
+        return fail("enemy \"" + key + "\" has an out-of-range value");
+      }
+    }
+    if (doc.contains("maps")) {
+      std::vector<MapDef> maps;
+      for (const auto &j : doc.at("maps")) {
+        MapDef map;
+        map.path_width = j.value("path_width", 1);
+        map.board.width = j.value("width", kBoardWidth);
+        map.board.height = j.value("height", kBoardHeight);
+        for (const auto &p : j.at("path")) {
+          map.anchors.push_back({p.at(0).get<int>(), p.at(1).get<int>()});
+        }
+        const std::string problem = MapProblem(map);
+        if (!problem.empty()) {
+          return fail("map " + std::to_string(maps.size() + 1) + ": " +
+                      problem);
+        }
+        maps.push_back(std::move(map));
+      }
+      if (maps.empty()) {
+        return fail("\"maps\" is empty");
+      }
+      defs->maps_ = std::move(maps);
+    }
+  } catch (const json::exception &e) {
+    return fail(e.what());
+  }
+  defs->SortByCost();
+  return defs;
+}
+
+std::unique_ptr<Definitions> LoadDefinitions(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "catcat: cannot open definitions file " << path << "\n";
+    return nullptr;
+  }
+  return ParseDefinitions(in, path);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sim/board.h"
+#include "sim/enemy_store.h"
+
+struct Tower {
+  enum class Type { Default, Fat, Kitty, Thunder, Catatonic, Galactic };
+
+  Position pos{};
+  Position home{};
+  int damage = 2;
+  float range = 3.2F;
+  float cooldown = 0.0F;  // time until next shot
+  float fire_rate = 1.2F; // seconds between shots
+  Type type = Type::Default;
+  int size = 1; // 1x1 or 2x2 for Fat
+  bool upgraded = false;
+};
+
+constexpr int kTowerTypeCount = 6;
+constexpr int kEnemyTypeCount = 4;
+
+struct TowerDef {
+  Tower::Type type;
+  std::string_view name;
+  int cost;
+  int damage;
+  float range;
+  float fire_rate;
+  bool show_range;
+  int size;
+};
+
+// Hit points and speed scale linearly with DifficultyLevel().
+struct EnemyDef {
+  int hp;             // at level 0
+  float hp_per_level; // added hp, truncated
+  float speed;        // cells per second at level 0, before kSpeedFactor
+  float speed_per_level;
+  int bounty; // kibbles per kill
+};
+
+struct MapDef {
+  std::vector<Position> anchors;
+  int path_width = 1;
+  BoardSize board; // the default 48x28 unless the map sets its own
+};
+
+// Every tower, enemy and map the game knows, indexed by type or map number.
+// The built-in content is a set of constexpr tables; a definitions file
+// overrides any of it without recompiling. Built once and then only read,
+// so simulations on any thread can share one. Not copyable or movable:
+// the name views point into the object.
+class Definitions {
+public:
+  // The built-in towers, enemies and maps.
+  static const Definitions &Builtin();
+  // The set GetDef(), SortedDefs() and new simulations use; Builtin()
+  // unless SetActive() replaced it. Replace it only before creating any
+  // simulation, since simulations keep a pointer to theirs.
+  static const Definitions &Active();
+  static void SetActive(std::unique_ptr<const Definitions> defs);
+
+  Definitions(const Definitions &) = delete;
+  Definitions &operator=(const Definitions &) = delete;
+
+  const TowerDef &tower(Tower::Type type) const {
+    return towers_[static_cast<size_t>(type)];
+  }
+  // Ordered by cost, then name; drives number keys and the shop.
+  std::span<const TowerDef> towers_by_cost() const { return by_cost_; }
+  const EnemyDef &enemy(EnemyType type) const {
+    return enemies_[static_cast<size_t>(type)];
+  }
+  const std::vector<MapDef> &maps() const { return maps_; }
+
+private:
+  friend std::unique_ptr<Definitions>
+  ParseDefinitions(std::istream &in, const std::string &origin);
+
+  Definitions(); // the built-in tables
+  void SortByCost();
+
+  std::array<TowerDef, kTowerTypeCount> towers_{};
+  std::array<TowerDef, kTowerTypeCount> by_cost_{};
+  std::array<EnemyDef, kEnemyTypeCount> enemies_{};
+  std::vector<MapDef> maps_;
+  std::array<std::string, kTowerTypeCount> names_; // renamed towers
+};
+
+// Reads a JSON definitions file over the built-in content:
+//
+//   {"towers":  {"fat": {"cost": 40, "name": "Chonk Cat"}},
+//    "enemies": {"dog": {"hp": 30, "bounty": 35}},
+//    "maps":    [{"path_width": 2, "path": [[0, 3], [20, 3], [20, 9]]},
+//                {"width": 512, "height": 512, "path": [[0, 9], [511, 9]]}]}
+//
+// Towers (default, fat, kitty, thunder, catatonic, galactic) and enemies
+// (mouse, rat, bigrat, dog) change only the fields given; "maps", if
+// present, replaces the whole list, each map on a 48x28 board unless it
+// gives "width" and "height". Prints the problem and returns nullptr
+// if the file is malformed or a value is out of range.
+std::unique_ptr<Definitions> ParseDefinitions(std::istream &in,
+                                              const std::string &origin);
+std::unique_ptr<Definitions> LoadDefinitions(const std::string &path);
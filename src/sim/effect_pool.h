@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Storage for short-lived effects: projectiles, beams, splats, highlights.
+// Expired entries are compacted in place but their slots are kept, so an
+// effect that owns a buffer (beam and highlight cells) reuses it instead of
+// freeing and reallocating it. Given a capacity the pool is a ring: once
+// full, Acquire() overwrites the oldest entry in place. Entries are indexed
+// and iterated oldest first either way.
+template <typename T> class EffectPool {
+  template <typename Pool, typename Value> class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value *;
+    using reference = Value &;
+
+    Iterator() = default;
+    Iterator(Pool *pool, size_t i) : pool_(pool), i_(i) {}
+    reference operator*() const { return (*pool_)[i_]; }
+    pointer operator->() const { return &(*pool_)[i_]; }
+    Iterator &operator++() {
+      ++i_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator before = *this;
+      ++i_;
+      return before;
+    }
+    friend bool operator==(const Iterator &a, const Iterator &b) {
+      return a.i_ == b.i_;
+    }
+
+  private:
+    Pool *pool_ = nullptr;
+    size_t i_ = 0;
+  };
+
+public:
+  using iterator = Iterator<EffectPool, T>;
+  using const_iterator = Iterator<const EffectPool, const T>;
+
+  EffectPool() = default;
+  explicit EffectPool(size_t capacity) : capacity_(capacity) {}
+
+  // Appends an entry and returns it. The slot may hold a previous entry's
+  // data; callers overwrite every field, clearing owned vectors rather than
+  // replacing them so their capacity is kept.
+  T &Acquire() {
+    if (capacity_ != 0 && live_ == capacity_) {
+      // The oldest slot becomes the newest; nothing else moves.
+      T &oldest = slots_[head_];
+      head_ = head_ + 1 == capacity_ ? 0 : head_ + 1;
+      return oldest;
+    }
+    // Slots are only added before the ring first wraps, while head_ is 0,
+    // so a new slot is always entry live_.
+    if (live_ == slots_.size()) {
+      slots_.emplace_back();
+    }
+    return Slot(live_++);
+  }
+  void Push(const T &value) { Acquire() = value; }
+  // Drops the entry returned by the last Acquire().
+  void PopBack() { --live_; }
+
+  // Removes the entries for which dead(entry) is true, keeping the order of
+  // the rest. dead() sees every live entry once, oldest first.
+  template <typename Pred> void RemoveIf(Pred &&dead) {
+    size_t kept = 0;
+    for (size_t i = 0; i < live_; ++i) {
+      if (dead(Slot(i))) {
+        continue;
+      }
+      if (kept != i) {
+        std::swap(Slot(kept), Slot(i));
+      }
+      ++kept;
+    }
+    live_ = kept;
+  }
+  void Clear() {
+    live_ = 0;
+    head_ = 0;
+  }
+
+  size_t size() const { return live_; }
+  bool empty() const { return live_ == 0; }
+  // Entry i, counting from the oldest.
+  T &operator[](size_t i) { return Slot(i); }
+  const T &operator[](size_t i) const { return Slot(i); }
+  const T &front() const { return Slot(0); }
+  const T &back() const { return Slot(live_ - 1); }
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, live_}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, live_}; }
+
+private:
+  // Slot of entry i: (head_ + i) % capacity, without the division.
+  size_t SlotIndex(size_t i) const {
+    const size_t j = head_ + i;
+    return j >= slots_.size() ? j - slots_.size() : j;
+  }
+  T &Slot(size_t i) { return slots_[SlotIndex(i)]; }
+  const T &Slot(size_t i) const { return slots_[SlotIndex(i)]; }
+
+  std::vector<T> slots_;
+  size_t head_ = 0; // slot of the oldest entry
+  size_t live_ = 0;
+  size_t capacity_ = 0; // 0 = unbounded
+};
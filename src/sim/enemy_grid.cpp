@@ -0,0 +1,39 @@
+#include "sim/enemy_grid.h"
+
+#include <algorithm>
+#include <cstdint>
+
+void EnemyGrid::Build(const BoardSize &board, const std::vector<int> &xs,
+                      const std::vector<int> &ys) {
+  // Enemies cross into a new cell only every few ticks, so most rebuilds
+  // find nothing changed and keep the old order.
+  bool same = board == board_ && cells_.size() == xs.size();
+  board_ = board;
+  cells_.resize(xs.size());
+  for (size_t i = 0; i < xs.size(); ++i) {
+    const auto cell = static_cast<uint32_t>(board.Index(xs[i], ys[i]));
+    same = same && cells_[i] == cell;
+    cells_[i] = cell;
+  }
+  if (same) {
+    return;
+  }
+  entries_.resize(cells_.size());
+  for (size_t i = 0; i < cells_.size(); ++i) {
+    entries_[i] = Key(cells_[i], i);
+  }
+  std::sort(entries_.begin(), entries_.end());
+}
+
+void EnemyGrid::CollectRect(int x0, int y0, int x1, int y1,
+                            std::vector<size_t> &out) const {
+  ForEachInRect(x0, y0, x1, y1, [&](size_t i) { out.push_back(i); });
+}
+
+bool EnemyGrid::Clamp(int &x0, int &y0, int &x1, int &y1) const {
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, board_.width - 1);
+  y1 = std::min(y1, board_.height - 1);
+  return x0 <= x1 && y0 <= y1;
+}
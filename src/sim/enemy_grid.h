@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sim/board.h"
+
+// Enemy indices sorted by board cell. Rebuilt once per tick so range, cone
+// and line queries only visit the rows inside their bounding box; building
+// and keeping it costs per enemy, however large the board is.
+class EnemyGrid {
+public:
+  // Buckets enemy i under cell (xs[i], ys[i]); cells must lie on board.
+  // Does nothing if the board and cells match the previous build.
+  void Build(const BoardSize &board, const std::vector<int> &xs,
+             const std::vector<int> &ys);
+
+  // Calls fn(index) for every enemy whose cell is in [x0, x1] x [y0, y1]
+  // (clamped to the board), bucket by bucket in row-major order.
+  template <typename Fn>
+  void ForEachInRect(int x0, int y0, int x1, int y1, Fn &&fn) const {
+    if (entries_.empty() || !Clamp(x0, y0, x1, y1)) {
+      return;
+    }
+    auto it = entries_.begin();
+    for (int y = y0; y <= y1 && it != entries_.end(); ++y) {
+      // Rows only move forward, so each search starts where the last ended.
+      it = std::lower_bound(it, entries_.end(), Key(board_.Index(x0, y), 0));
+      const uint64_t end = Key(board_.Index(x1, y) + 1, 0);
+      for (; it != entries_.end() && *it < end; ++it) {
+        fn(static_cast<size_t>(*it & 0xFFFFFFFFU));
+      }
+    }
+  }
+
+  // Appends the enemies in [x0, x1] x [y0, y1] to out.
+  void CollectRect(int x0, int y0, int x1, int y1,
+                   std::vector<size_t> &out) const;
+  // Appends the enemies standing on cell p to out.
+  void CollectCell(const Position &p, std::vector<size_t> &out) const {
+    CollectRect(p.x, p.y, p.x, p.y, out);
+  }
+
+private:
+  // Sorting keys by cell, then by enemy, orders buckets row-major and each
+  // bucket by ascending enemy.
+  static uint64_t Key(size_t cell, size_t index) {
+    return static_cast<uint64_t>(cell) << 32U | static_cast<uint64_t>(index);
+  }
+  bool Clamp(int &x0, int &y0, int &x1, int &y1) const;
+
+  BoardSize board_;
+  std::vector<uint32_t> cells_;   // cell of enemy i, as of the last build
+  std::vector<uint64_t> entries_; // Key(cell, i) of every enemy, ascending
+};
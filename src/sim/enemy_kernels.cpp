@@ -0,0 +1,243 @@
+#include "sim/enemy_kernels.h"
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CATCAT_KERNEL_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CATCAT_KERNEL_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CATCAT_KERNEL_NEON 1
+#endif
+
+namespace {
+
+// Scalar forms of each kernel, also used for the tails of the SIMD loops.
+// Products and sums are kept as separate statements so no compiler fuses
+// them into an FMA the vector paths don't use.
+
+void AdvanceOne(float &progress, float speed, float &sleep, float dt) {
+  if (sleep > 0.0F) {
+    const float left = sleep - dt;
+    sleep = left > 0.0F ? left : 0.0F;
+    return;
+  }
+  const float step = speed * dt;
+  progress = progress + step;
+}
+
+#if defined(CATCAT_KERNEL_AVX2) || defined(CATCAT_KERNEL_SSE2)
+int CountBits(int bits) {
+  int count = 0;
+  for (; bits != 0; bits &= bits - 1) {
+    ++count;
+  }
+  return count;
+}
+#endif
+
+bool InRangeOne(int x, int y, float cx, float cy, float range2) {
+  const float dx = cx - static_cast<float>(x);
+  const float dy = cy - static_cast<float>(y);
+  const float dx2 = dx * dx;
+  const float dy2 = dy * dy;
+  const float d2 = dx2 + dy2;
+  return d2 <= range2;
+}
+
+} // namespace
+
+void AdvanceEnemies(float *progress, const float *speed, float *sleep_timer,
+                    size_t n, float dt) {
+  size_t i = 0;
+#if defined(CATCAT_KERNEL_AVX2)
+  const __m256 vdt = _mm256_set1_ps(dt);
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    const __m256 p = _mm256_loadu_ps(progress + i);
+    const __m256 s = _mm256_loadu_ps(speed + i);
+    const __m256 sl = _mm256_loadu_ps(sleep_timer + i);
+    const __m256 asleep = _mm256_cmp_ps(sl, zero, _CMP_GT_OQ);
+    const __m256 left = _mm256_max_ps(_mm256_sub_ps(sl, vdt), zero);
+    const __m256 moved = _mm256_add_ps(p, _mm256_mul_ps(s, vdt));
+    _mm256_storeu_ps(sleep_timer + i, _mm256_blendv_ps(sl, left, asleep));
+    _mm256_storeu_ps(progress + i, _mm256_blendv_ps(moved, p, asleep));
+  }
+#elif defined(CATCAT_KERNEL_SSE2)
+  const __m128 vdt = _mm_set1_ps(dt);
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    const __m128 p = _mm_loadu_ps(progress + i);
+    const __m128 s = _mm_loadu_ps(speed + i);
+    const __m128 sl = _mm_loadu_ps(sleep_timer + i);
+    const __m128 asleep = _mm_cmpgt_ps(sl, zero);
+    const __m128 left = _mm_max_ps(_mm_sub_ps(sl, vdt), zero);
+    const __m128 moved = _mm_add_ps(p, _mm_mul_ps(s, vdt));
+    _mm_storeu_ps(sleep_timer + i, _mm_or_ps(_mm_and_ps(asleep, left),
+                                             _mm_andnot_ps(asleep, sl)));
+    _mm_storeu_ps(progress + i, _mm_or_ps(_mm_and_ps(asleep, p),
+                                          _mm_andnot_ps(asleep, moved)));
+  }
+#elif defined(CATCAT_KERNEL_NEON)
+  const float32x4_t vdt = vdupq_n_f32(dt);
+  const float32x4_t zero = vdupq_n_f32(0.0F);
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t p = vld1q_f32(progress + i);
+    const float32x4_t s = vld1q_f32(speed + i);
+    const float32x4_t sl = vld1q_f32(sleep_timer + i);
+    const uint32x4_t asleep = vcgtq_f32(sl, zero);
+    const float32x4_t left = vmaxq_f32(vsubq_f32(sl, vdt), zero);
+    const float32x4_t moved = vaddq_f32(p, vmulq_f32(s, vdt));
+    vst1q_f32(sleep_timer + i, vbslq_f32(asleep, left, sl));
+    vst1q_f32(progress + i, vbslq_f32(asleep, p, moved));
+  }
+#endif
+  for (; i < n; ++i) {
+    AdvanceOne(progress[i], speed[i], sleep_timer[i], dt);
+  }
+}
+
+int ZeroFinished(const float *progress, int *hp, size_t n,
+                 float end_progress) {
+  int finished = 0;
+  size_t i = 0;
+#if defined(CATCAT_KERNEL_AVX2)
+  const __m256 end = _mm256_set1_ps(end_progress);
+  for (; i + 8 <= n; i += 8) {
+    const __m256 done =
+        _mm256_cmp_ps(_mm256_loadu_ps(progress + i), end, _CMP_GE_OQ);
+    const int bits = _mm256_movemask_ps(done);
+    if (bits == 0) {
+      continue;
+    }
+    finished += CountBits(bits);
+    auto *dst = reinterpret_cast<__m256i *>(hp + i);
+    const __m256i h = _mm256_loadu_si256(dst);
+    _mm256_storeu_si256(dst,
+                        _mm256_andnot_si256(_mm256_castps_si256(done), h));
+  }
+#elif defined(CATCAT_KERNEL_SSE2)
+  const __m128 end = _mm_set1_ps(end_progress);
+  for (; i + 4 <= n; i += 4) {
+    const __m128 done = _mm_cmpge_ps(_mm_loadu_ps(progress + i), end);
+    const int bits = _mm_movemask_ps(done);
+    if (bits == 0) {
+      continue;
+    }
+    finished += CountBits(bits);
+    auto *dst = reinterpret_cast<__m128i *>(hp + i);
+    const __m128i h = _mm_loadu_si128(dst);
+    _mm_storeu_si128(dst, _mm_andnot_si128(_mm_castps_si128(done), h));
+  }
+#elif defined(CATCAT_KERNEL_NEON)
+  const float32x4_t end = vdupq_n_f32(end_progress);
+  for (; i + 4 <= n; i += 4) {
+    const uint32x4_t done = vcgeq_f32(vld1q_f32(progress + i), end);
+    if (vmaxvq_u32(done) == 0) {
+      continue;
+    }
+    finished += static_cast<int>(vaddvq_u32(vshrq_n_u32(done, 31)));
+    const int32x4_t h = vld1q_s32(hp + i);
+    vst1q_s32(hp + i, vbicq_s32(h, vreinterpretq_s32_u32(done)));
+  }
+#endif
+  for (; i < n; ++i) {
+    if (progress[i] >= end_progress) {
+      hp[i] = 0;
+      ++finished;
+    }
+  }
+  return finished;
+}
+
+size_t KeepInRange(const int *xs, const int *ys, size_t *indices, size_t n,
+                   float cx, float cy, float range2) {
+  size_t kept = 0;
+  size_t i = 0;
+#if defined(CATCAT_KERNEL_AVX2)
+  const __m256 vcx = _mm256_set1_ps(cx);
+  const __m256 vcy = _mm256_set1_ps(cy);
+  const __m256 vr2 = _mm256_set1_ps(range2);
+  for (; i + 8 <= n; i += 8) {
+    const size_t *idx = indices + i;
+    const __m256i x = _mm256_setr_epi32(xs[idx[0]], xs[idx[1]], xs[idx[2]],
+                                        xs[idx[3]], xs[idx[4]], xs[idx[5]],
+                                        xs[idx[6]], xs[idx[7]]);
+    const __m256i y = _mm256_setr_epi32(ys[idx[0]], ys[idx[1]], ys[idx[2]],
+                                        ys[idx[3]], ys[idx[4]], ys[idx[5]],
+                                        ys[idx[6]], ys[idx[7]]);
+    const __m256 dx = _mm256_sub_ps(vcx, _mm256_cvtepi32_ps(x));
+    const __m256 dy = _mm256_sub_ps(vcy, _mm256_cvtepi32_ps(y));
+    const __m256 d2 =
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    const int bits = _mm256_movemask_ps(_mm256_cmp_ps(d2, vr2, _CMP_LE_OQ));
+    for (int lane = 0; lane < 8; ++lane) {
+      if ((bits >> lane) & 1) {
+        indices[kept++] = idx[lane];
+      }
+    }
+  }
+#elif defined(CATCAT_KERNEL_SSE2)
+  const __m128 vcx = _mm_set1_ps(cx);
+  const __m128 vcy = _mm_set1_ps(cy);
+  const __m128 vr2 = _mm_set1_ps(range2);
+  for (; i + 4 <= n; i += 4) {
+    const size_t *idx = indices + i;
+    const __m128i x =
+        _mm_setr_epi32(xs[idx[0]], xs[idx[1]], xs[idx[2]], xs[idx[3]]);
+    const __m128i y =
+        _mm_setr_epi32(ys[idx[0]], ys[idx[1]], ys[idx[2]], ys[idx[3]]);
+    const __m128 dx = _mm_sub_ps(vcx, _mm_cvtepi32_ps(x));
+    const __m128 dy = _mm_sub_ps(vcy, _mm_cvtepi32_ps(y));
+    const __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    const int bits = _mm_movemask_ps(_mm_cmple_ps(d2, vr2));
+    for (int lane = 0; lane < 4; ++lane) {
+      if ((bits >> lane) & 1) {
+        indices[kept++] = idx[lane];
+      }
+    }
+  }
+#elif defined(CATCAT_KERNEL_NEON)
+  const float32x4_t vcx = vdupq_n_f32(cx);
+  const float32x4_t vcy = vdupq_n_f32(cy);
+  const float32x4_t vr2 = vdupq_n_f32(range2);
+  for (; i + 4 <= n; i += 4) {
+    const size_t *idx = indices + i;
+    const int32_t xa[4] = {xs[idx[0]], xs[idx[1]], xs[idx[2]], xs[idx[3]]};
+    const int32_t ya[4] = {ys[idx[0]], ys[idx[1]], ys[idx[2]], ys[idx[3]]};
+    const float32x4_t dx = vsubq_f32(vcx, vcvtq_f32_s32(vld1q_s32(xa)));
+    const float32x4_t dy = vsubq_f32(vcy, vcvtq_f32_s32(vld1q_s32(ya)));
+    const float32x4_t d2 = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+    uint32_t in[4];
+    vst1q_u32(in, vcleq_f32(d2, vr2));
+    const size_t lanes[4] = {idx[0], idx[1], idx[2], idx[3]};
+    for (int lane = 0; lane < 4; ++lane) {
+      if (in[lane] != 0) {
+        indices[kept++] = lanes[lane];
+      }
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    const size_t idx = indices[i];
+    if (InRangeOne(xs[idx], ys[idx], cx, cy, range2)) {
+      indices[kept++] = idx;
+    }
+  }
+  return kept;
+}
+
+const char *EnemyKernelIsa() {
+#if defined(CATCAT_KERNEL_AVX2)
+  return "avx2";
+#elif defined(CATCAT_KERNEL_SSE2)
+  return "sse2";
+#elif defined(CATCAT_KERNEL_NEON)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+// Vectorized loops over EnemyStore columns. The variant is picked at compile
+// time: AVX2 when built with it, else SSE2 on x86-64, NEON on arm64, or plain
+// scalar code. Every variant does the same float operations in the same
+// order as the scalar loop, so results do not depend on the variant.
+
+// Advances awake enemies by speed * dt and counts sleeping ones down.
+void AdvanceEnemies(float *progress, const float *speed, float *sleep_timer,
+                    size_t n, float dt);
+
+// Zeroes hp for every enemy at or past end_progress; returns how many.
+int ZeroFinished(const float *progress, int *hp, size_t n, float end_progress);
+
+// Keeps the indices whose cell (xs[i], ys[i]) lies within range2 squared
+// distance of (cx, cy), preserving their order. Returns the new count.
+size_t KeepInRange(const int *xs, const int *ys, size_t *indices, size_t n,
+                   float cx, float cy, float range2);
+
+// Which variant was compiled in: "avx2", "sse2", "neon" or "scalar".
+const char *EnemyKernelIsa();
@@ -0,0 +1,73 @@
+#include "sim/enemy_store.h"
+
+namespace {
+
+template <typename T>
+void Compact(std::vector<T> &column, const std::vector<int> &hp) {
+  size_t out = 0;
+  for (size_t i = 0; i < column.size(); ++i) {
+    if (hp[i] > 0) {
+      column[out++] = column[i];
+    }
+  }
+  column.resize(out);
+}
+
+} // namespace
+
+void EnemyStore::Add(const Enemy &e) {
+  path_progress.push_back(e.path_progress);
+  speed.push_back(e.speed);
+  hp.push_back(e.hp);
+  max_hp.push_back(e.max_hp);
+  lane_offset.push_back(e.lane_offset);
+  type.push_back(e.type);
+  sleep_timer.push_back(e.sleep_timer);
+  x.push_back(0);
+  y.push_back(0);
+}
+
+Enemy EnemyStore::Get(size_t i) const {
+  Enemy e;
+  e.path_progress = path_progress[i];
+  e.speed = speed[i];
+  e.hp = hp[i];
+  e.max_hp = max_hp[i];
+  e.lane_offset = lane_offset[i];
+  e.type = type[i];
+  e.sleep_timer = sleep_timer[i];
+  return e;
+}
+
+void EnemyStore::Clear() {
+  path_progress.clear();
+  speed.clear();
+  hp.clear();
+  max_hp.clear();
+  lane_offset.clear();
+  type.clear();
+  sleep_timer.clear();
+  x.clear();
+  y.clear();
+}
+
+bool EnemyStore::RemoveDead() {
+  size_t alive = 0;
+  for (int h : hp) {
+    alive += h > 0 ? 1 : 0;
+  }
+  if (alive == hp.size()) {
+    return false;
+  }
+  // hp is the key for every other column, so compact it last.
+  Compact(path_progress, hp);
+  Compact(speed, hp);
+  Compact(max_hp, hp);
+  Compact(lane_offset, hp);
+  Compact(type, hp);
+  Compact(sleep_timer, hp);
+  Compact(x, hp);
+  Compact(y, hp);
+  Compact(hp, hp);
+  return true;
+}
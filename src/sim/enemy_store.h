@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+enum class EnemyType { Mouse, Rat, BigRat, Dog };
+
+struct Enemy {
+  float path_progress = 0.0F; // index along path cells
+  float speed = 1.0F;         // cells per second
+  int hp = 1;
+  int max_hp = 1;
+  int lane_offset = 0; // lateral offset from center path
+  EnemyType type = EnemyType::Rat;
+  float sleep_timer = 0.0F;
+};
+
+// Enemies stored as parallel columns, so the per-tick kernels stream only the
+// fields they touch. Index i names the same enemy in every column.
+struct EnemyStore {
+  std::vector<float> path_progress;
+  std::vector<float> speed;
+  std::vector<int> hp;
+  std::vector<int> max_hp;
+  std::vector<int> lane_offset;
+  std::vector<EnemyType> type;
+  std::vector<float> sleep_timer;
+  // Board cell per enemy as of the last refresh; the simulation keeps these
+  // current before any range query reads them.
+  std::vector<int> x;
+  std::vector<int> y;
+
+  size_t size() const { return hp.size(); }
+  bool empty() const { return hp.empty(); }
+
+  void Add(const Enemy &e);
+  // Copy of enemy i in struct form, for rendering and tests.
+  Enemy Get(size_t i) const;
+  void Clear();
+  // Drops enemies with hp <= 0, keeping survivors in their original order.
+  // Returns true if anything was removed.
+  bool RemoveDead();
+};
@@ -0,0 +1,20 @@
+#include "sim/fixed_step_clock.h"
+
+#include <algorithm>
+
+FixedStepClock::FixedStepClock(Duration period, int max_periods)
+    : period_(std::max(period, Duration(1))),
+      max_periods_(std::max(1, max_periods)) {}
+
+int FixedStepClock::Advance(Duration elapsed) {
+  if (elapsed > Duration::zero()) {
+    backlog_ += elapsed;
+  }
+  const auto due = static_cast<long long>(backlog_ / period_);
+  backlog_ %= period_;
+  if (due > max_periods_) {
+    dropped_periods_ += due - max_periods_;
+    return max_periods_;
+  }
+  return static_cast<int>(due);
+}
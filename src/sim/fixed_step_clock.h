@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+// Turns measured wall time into a whole number of fixed-length periods.
+// Time left over carries into the next call. If the caller falls more than
+// max_periods behind (a slow terminal, a suspended process), the extra time
+// is dropped: frames are skipped rather than the game running slow or
+// bursting through a long catch-up.
+class FixedStepClock {
+public:
+  using Duration = std::chrono::steady_clock::duration;
+  static constexpr int kDefaultMaxPeriods = 5;
+
+  explicit FixedStepClock(Duration period,
+                          int max_periods = kDefaultMaxPeriods);
+
+  // Adds elapsed time and returns how many periods are now due, at most
+  // max_periods. Negative elapsed time is ignored.
+  int Advance(Duration elapsed);
+  void Reset() { backlog_ = Duration::zero(); }
+
+  Duration backlog() const { return backlog_; }
+  // Periods discarded by the cap since construction.
+  long long dropped_periods() const { return dropped_periods_; }
+
+private:
+  Duration period_;
+  int max_periods_;
+  Duration backlog_ = Duration::zero();
+  long long dropped_periods_ = 0;
+};
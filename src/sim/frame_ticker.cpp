@@ -0,0 +1,100 @@
+#include "sim/frame_ticker.h"
+
+#include <utility>
+
+FrameTicker::FrameTicker(Clock::duration period, std::function<void()> post)
+    : period_(period), post_(std::move(post)),
+      next_tick_(Clock::now() + period) {
+  thread_ = std::thread([this] { Loop(); });
+}
+
+FrameTicker::~FrameTicker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_cv_.notify_one();
+  thread_.join();
+}
+
+void FrameTicker::Run() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  deadline_.reset();
+  next_tick_ = Clock::now() + period_;
+  changed_ = true;
+  changed_cv_.notify_one();
+}
+
+void FrameTicker::Sleep(std::optional<Clock::time_point> deadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+  deadline_ = deadline;
+  changed_ = true;
+  changed_cv_.notify_one();
+}
+
+void FrameTicker::Wake() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  wake_ = true;
+  changed_ = true;
+  changed_cv_.notify_one();
+}
+
+void FrameTicker::Handled() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_ = false;
+  changed_ = true; // a wake or deadline held back may post now
+  changed_cv_.notify_one();
+}
+
+bool FrameTicker::running() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_;
+}
+
+void FrameTicker::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto interrupted = [this] { return stop_ || changed_; };
+  while (!stop_) {
+    std::optional<Clock::time_point> due;
+    if (wake_) {
+      due = Clock::now();
+    } else if (running_) {
+      due = next_tick_;
+    } else {
+      due = deadline_;
+    }
+    if (!due.has_value()) {
+      changed_cv_.wait(lock, interrupted);
+      changed_ = false;
+      continue;
+    }
+    if (changed_cv_.wait_until(lock, *due, interrupted)) {
+      changed_ = false;
+      continue; // look at the new schedule
+    }
+    if (pending_) {
+      if (running_ && !wake_) {
+        // The frame still queued covers this period.
+        next_tick_ = Clock::now() + period_;
+        continue;
+      }
+      // A wake or deadline may report a change the queued frame predates,
+      // so it is kept until that frame is handled.
+      changed_cv_.wait(lock, interrupted);
+      changed_ = false;
+      continue;
+    }
+    wake_ = false;
+    deadline_.reset();
+    next_tick_ = Clock::now() + period_;
+    pending_ = true;
+    lock.unlock();
+    post_();
+    lock.lock();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Wakes a UI thread for frames from a thread of its own. While running it
+// posts every period; asleep it posts nothing until Wake() or the deadline
+// it was given, so an idle game costs no CPU. Each post calls `post`, and
+// no further post is made until the frame is marked Handled(), so a slow UI
+// thread is never flooded: periodic frames due meanwhile are skipped, while
+// a wake or deadline posts once the frame is handled. Every method may be
+// called from any thread.
+class FrameTicker {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  FrameTicker(Clock::duration period, std::function<void()> post);
+  ~FrameTicker();
+  FrameTicker(const FrameTicker &) = delete;
+  FrameTicker &operator=(const FrameTicker &) = delete;
+
+  // Posts every period from now on; does nothing if already running.
+  void Run();
+  // Stops the periodic posts. If a deadline is given, one post is made then.
+  void Sleep(std::optional<Clock::time_point> deadline = std::nullopt);
+  // Posts once as soon as possible, running or not.
+  void Wake();
+  // The last posted frame has been handled; the next can be posted.
+  void Handled();
+
+  bool running() const;
+
+private:
+  void Loop();
+
+  const Clock::duration period_;
+  const std::function<void()> post_;
+  mutable std::mutex mutex_;
+  std::condition_variable changed_cv_;
+  bool changed_ = false; // the schedule moved since the thread last looked
+  bool stop_ = false;
+  bool running_ = true;
+  bool wake_ = false;
+  bool pending_ = false; // posted and not yet handled
+  std::optional<Clock::time_point> deadline_;
+  Clock::time_point next_tick_;
+  std::thread thread_;
+};
@@ -0,0 +1,281 @@
+#include "sim/headless.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "sim/simulation.h"
+#include "sim/snapshot.h"
+#include "sim/tick_profiler.h"
+#include "sim/worker_pool.h"
+
+namespace {
+
+std::optional<Tower::Type> ParseTowerType(const std::string &name) {
+  if (name == "default")
+    return Tower::Type::Default;
+  if (name == "fat")
+    return Tower::Type::Fat;
+  if (name == "kitty")
+    return Tower::Type::Kitty;
+  if (name == "thunder")
+    return Tower::Type::Thunder;
+  if (name == "catatonic")
+    return Tower::Type::Catatonic;
+  if (name == "galactic")
+    return Tower::Type::Galactic;
+  return std::nullopt;
+}
+
+// Rate and percentiles of the tick times in ns; sorts them.
+TickStats SummarizeTicks(std::vector<uint32_t> &ns) {
+  TickStats stats;
+  if (ns.empty()) {
+    return stats;
+  }
+  std::sort(ns.begin(), ns.end());
+  double total = 0.0;
+  for (uint32_t t : ns) {
+    total += static_cast<double>(t);
+  }
+  const auto at = [&](size_t pct) {
+    return static_cast<double>(ns[(ns.size() - 1) * pct / 100]) / 1000.0;
+  };
+  stats.ticks_per_sec =
+      total > 0.0 ? static_cast<double>(ns.size()) * 1e9 / total : 0.0;
+  stats.p50_us = at(50);
+  stats.p99_us = at(99);
+  stats.max_us = static_cast<double>(ns.back()) / 1000.0;
+  return stats;
+}
+
+} // namespace
+
+// Script format, one command per line ('#' starts a comment):
+//   wave <n>                  following commands run before wave n starts
+//   place <type> <x> <y>      unlock if needed, then place a cat
+//   fill <type> <x0> <y0> <x1> <y1>
+//                             place one in every free cell of the rectangle
+//   upgrade <x> <y>
+//   sell <x> <y>
+std::optional<HeadlessScript> LoadHeadlessScript(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "catcat: cannot open script " << path << "\n";
+    return std::nullopt;
+  }
+  std::vector<ScriptedAction> actions;
+  int wave = 1;
+  int line_no = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    ++line_no;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    std::string cmd;
+    if (!(ss >> cmd)) {
+      continue;
+    }
+    ScriptedAction a;
+    bool ok = false;
+    if (cmd == "wave") {
+      ok = static_cast<bool>(ss >> wave);
+      if (ok) {
+        continue;
+      }
+    } else if (cmd == "place") {
+      std::string type_name;
+      ok = static_cast<bool>(ss >> type_name >> a.pos.x >> a.pos.y);
+      const auto type = ParseTowerType(type_name);
+      ok = ok && type.has_value();
+      if (ok) {
+        a.kind = ScriptedAction::Kind::Place;
+        a.type = *type;
+      }
+    } else if (cmd == "fill") {
+      std::string type_name;
+      Position to{};
+      ok = static_cast<bool>(ss >> type_name >> a.pos.x >> a.pos.y >> to.x >>
+                             to.y);
+      const auto type = ParseTowerType(type_name);
+      ok = ok && type.has_value();
+      if (ok) {
+        // Row by row; a cell already taken just fails to place.
+        a.kind = ScriptedAction::Kind::Place;
+        a.type = *type;
+        a.wave = wave;
+        const Position from = a.pos;
+        for (int y = std::min(from.y, to.y); y <= std::max(from.y, to.y);
+             ++y) {
+          for (int x = std::min(from.x, to.x); x <= std::max(from.x, to.x);
+               ++x) {
+            a.pos = {x, y};
+            actions.push_back(a);
+          }
+        }
+        continue;
+      }
+    } else if (cmd == "upgrade" || cmd == "sell") {
+      ok = static_cast<bool>(ss >> a.pos.x >> a.pos.y);
+      a.kind = cmd == "upgrade" ? ScriptedAction::Kind::Upgrade
+                                : ScriptedAction::Kind::Sell;
+    }
+    if (!ok) {
+      std::cerr << "catcat: " << path << ":" << line_no
+                << ": cannot parse '" << line << "'\n";
+      return std::nullopt;
+    }
+    a.wave = wave;
+    actions.push_back(a);
+  }
+  std::stable_sort(actions.begin(), actions.end(),
+                   [](const ScriptedAction &a, const ScriptedAction &b) {
+                     return a.wave < b.wave;
+                   });
+  return actions;
+}
+
+std::optional<HeadlessResult> RunHeadless(const HeadlessOptions &options) {
+  HeadlessScript script;
+  if (!options.script_path.empty()) {
+    auto loaded = LoadHeadlessScript(options.script_path);
+    if (!loaded.has_value()) {
+      return std::nullopt;
+    }
+    script = std::move(*loaded);
+  }
+  std::optional<SnapshotFile> snapshot;
+  if (!options.snapshot_path.empty()) {
+    snapshot = SnapshotFile::Open(options.snapshot_path);
+    if (!snapshot.has_value()) {
+      return std::nullopt;
+    }
+  }
+  return RunHeadless(options, script,
+                     snapshot ? snapshot->bytes()
+                              : std::span<const std::byte>{});
+}
+
+std::optional<HeadlessResult>
+RunHeadless(const HeadlessOptions &options, const HeadlessScript &script,
+            std::span<const std::byte> snapshot) {
+  const auto start = std::chrono::steady_clock::now();
+  Simulation sim(options.dev_mode);
+  if (!snapshot.empty() && !sim.RestoreSnapshot(snapshot)) {
+    std::cerr << "catcat: "
+              << (options.snapshot_path.empty() ? std::string("snapshot")
+                                                : options.snapshot_path)
+              << ": snapshot does not fit this game\n";
+    return std::nullopt;
+  }
+  if (options.seed.has_value()) {
+    sim.Seed(*options.seed);
+  }
+  sim.SetDifficultyCurve(options.difficulty);
+  sim.SetWaveRules(options.waves);
+  std::unique_ptr<TickProfiler> profiler;
+  if (!options.trace_path.empty()) {
+    profiler = std::make_unique<TickProfiler>();
+    profiler->StartTrace();
+    sim.SetProfiler(profiler.get());
+  }
+  std::unique_ptr<WorkerPool> pool;
+  if (options.threads != 1) {
+    pool = std::make_unique<WorkerPool>(options.threads);
+    sim.SetWorkerPool(pool.get());
+  }
+  HeadlessResult result;
+  result.lives_lost_per_map.assign(static_cast<size_t>(sim.map_count()), 0);
+  // Actions for waves a snapshot has already started were applied before it
+  // was saved.
+  size_t next_action = 0;
+  while (next_action < script.size() &&
+         script[next_action].wave <= sim.wave()) {
+    ++next_action;
+  }
+  const auto ticks_left = [&] {
+    return options.max_ticks <= 0 || result.ticks < options.max_ticks;
+  };
+  std::vector<uint32_t> tick_ns;
+  while (!sim.game_over() && !sim.victory() &&
+         sim.wave() < options.max_waves && ticks_left()) {
+    const int upcoming = sim.wave() + 1;
+    for (; next_action < script.size() && script[next_action].wave <= upcoming;
+         ++next_action) {
+      const auto &a = script[next_action];
+      switch (a.kind) {
+      case ScriptedAction::Kind::Place:
+        if (sim.TryUnlock(a.type)) {
+          sim.PlaceTower(a.type, a.pos);
+        }
+        break;
+      case ScriptedAction::Kind::Upgrade:
+        sim.UpgradeTowerAt(a.pos);
+        break;
+      case ScriptedAction::Kind::Sell:
+        sim.SellTowerAt(a.pos);
+        break;
+      }
+    }
+    sim.StartWave();
+    if (!sim.wave_active()) {
+      break;
+    }
+    while (sim.wave_active() && !sim.game_over() && !sim.victory() &&
+           ticks_left()) {
+      // Lives are lost before a cleared wave can move on to the next map.
+      const auto map = static_cast<size_t>(sim.map_index());
+      const int lost = sim.lives_lost();
+      if (options.before_tick) {
+        options.before_tick(sim);
+      }
+      if (options.tick_stats) {
+        const auto tick_start = std::chrono::steady_clock::now();
+        sim.Tick();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - tick_start)
+                            .count();
+        tick_ns.push_back(static_cast<uint32_t>(std::clamp<int64_t>(
+            ns, 0, std::numeric_limits<uint32_t>::max())));
+      } else {
+        sim.Tick();
+      }
+      if (options.after_tick) {
+        options.after_tick(sim);
+      }
+      result.lives_lost_per_map[map] += sim.lives_lost() - lost;
+      result.peak_enemies = std::max(result.peak_enemies, sim.enemies().size());
+      ++result.ticks;
+    }
+  }
+  if (options.tick_stats) {
+    result.tick_stats = SummarizeTicks(tick_ns);
+  }
+
+  // A run asked for a file it did not get has failed, whatever it played.
+  bool written = true;
+  if (!options.save_path.empty()) {
+    written = WriteSnapshotFile(sim, options.save_path);
+  }
+  if (profiler) {
+    written = profiler->WriteTraceFile(options.trace_path) && written;
+  }
+  if (!written) {
+    return std::nullopt;
+  }
+  result.wave = sim.wave();
+  result.map_index = sim.map_index();
+  result.lives = sim.lives();
+  result.kibbles = sim.kibbles();
+  result.victory = sim.victory();
+  result.game_over = sim.game_over();
+  result.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return result;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "sim/simulation.h"
+
+struct HeadlessOptions {
+  bool dev_mode = false;
+  std::string script_path; // optional scripted tower placements
+  std::string snapshot_path; // optional save state to start from
+  std::string save_path;     // optional: save state written at the end
+  std::string trace_path;    // optional: Chrome trace of the tick phases
+  int max_waves = 100;
+  long long max_ticks = 0; // stop after this many ticks; 0 = no limit
+  int threads = 1; // tower-planning threads, caller included; 0 = all cores
+  std::optional<uint64_t> seed; // unset: a random seed (or the snapshot's)
+  DifficultyCurve difficulty;
+  WaveRules waves;
+  bool tick_stats = false; // time every tick for HeadlessResult::tick_stats
+  // Called right before and right after every Tick(), e.g. to measure what
+  // a tick costs; either may be left empty.
+  std::function<void(const Simulation &)> before_tick;
+  std::function<void(const Simulation &)> after_tick;
+};
+
+// Wall-clock cost of a run's ticks: the sustained rate and percentiles of
+// single tick times over the whole run.
+struct TickStats {
+  double ticks_per_sec = 0.0;
+  double p50_us = 0.0;
+  double p99_us = 0.0;
+  double max_us = 0.0;
+};
+
+struct HeadlessResult {
+  int wave = 0;
+  int map_index = 0;
+  int lives = 0;
+  int kibbles = 0;
+  bool victory = false;
+  bool game_over = false;
+  long long ticks = 0;
+  double elapsed_ms = 0.0;
+  std::vector<int> lives_lost_per_map; // indexed by map
+  size_t peak_enemies = 0;             // most alive after any tick
+  std::optional<TickStats> tick_stats; // with HeadlessOptions::tick_stats
+};
+
+// One scripted action, applied before the wave it is tagged with.
+struct ScriptedAction {
+  enum class Kind { Place, Upgrade, Sell };
+  int wave = 1; // applied before this wave starts
+  Kind kind = Kind::Place;
+  Tower::Type type = Tower::Type::Default;
+  Position pos{};
+};
+using HeadlessScript = std::vector<ScriptedAction>;
+
+// Parses a script file (format in headless.cpp). Prints the problem and
+// returns std::nullopt if it cannot be read or parsed.
+std::optional<HeadlessScript> LoadHeadlessScript(const std::string &path);
+
+// Runs the simulation with no screen, audio or rendering, stepping Tick()
+// with a fixed timestep as fast as the CPU allows. Waves are started back to
+// back and scripted actions are applied before the wave they are tagged with.
+// A non-empty snapshot (already checked by SnapshotFile::Open) is restored
+// first; a seed given in options then replaces its random state, and the
+// options' difficulty curve replaces the saved one. The
+// script and snapshot are passed in already loaded, so options.script_path
+// and options.snapshot_path are ignored. Prints the problem and returns
+// std::nullopt, playing nothing, if the snapshot does not fit the loaded
+// definitions (a map or tower it names is missing or elsewhere), or after
+// playing if the save state or trace cannot be written.
+std::optional<HeadlessResult>
+RunHeadless(const HeadlessOptions &options, const HeadlessScript &script,
+            std::span<const std::byte> snapshot = {});
+// As above, loading options.script_path and options.snapshot_path first.
+// Returns std::nullopt if either could not be loaded or restored.
+std::optional<HeadlessResult> RunHeadless(const HeadlessOptions &options);
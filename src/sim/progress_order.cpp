@@ -0,0 +1,65 @@
+#include "sim/progress_order.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+
+void ProgressOrder::Build(const std::vector<float> &progress) {
+  const auto ahead = [&](uint32_t a, uint32_t b) {
+    const float pa = progress[a];
+    const float pb = progress[b];
+    return pa > pb || (pa == pb && a < b);
+  };
+  if (order_.size() > progress.size()) {
+    // Enemies were dropped without RemoveDead; nothing to start from.
+    order_.resize(progress.size());
+    std::iota(order_.begin(), order_.end(), 0U);
+    std::sort(order_.begin(), order_.end(), ahead);
+  } else {
+    // order_ holds enemies 0..order_.size() - 1, maybe out of date; the
+    // rest are new and start at the back.
+    const size_t known = order_.size();
+    order_.resize(progress.size());
+    std::iota(order_.begin() + static_cast<std::ptrdiff_t>(known),
+              order_.end(), static_cast<uint32_t>(known));
+    for (size_t i = 1; i < order_.size(); ++i) {
+      const uint32_t moving = order_[i];
+      size_t j = i;
+      for (; j > 0 && ahead(moving, order_[j - 1]); --j) {
+        order_[j] = order_[j - 1];
+      }
+      order_[j] = moving;
+    }
+  }
+  ranks_.resize(order_.size());
+  for (size_t r = 0; r < order_.size(); ++r) {
+    ranks_[order_[r]] = static_cast<uint32_t>(r);
+  }
+}
+
+void ProgressOrder::RemoveDead(const std::vector<int> &hp) {
+  if (order_.size() > hp.size()) {
+    order_.clear(); // out of step with the enemies; Build starts over
+    return;
+  }
+  // Survivors keep their relative order, so each one's new index is the
+  // number of survivors before it.
+  renumbered_.resize(order_.size());
+  uint32_t alive = 0;
+  for (size_t i = 0; i < order_.size(); ++i) {
+    renumbered_[i] = alive;
+    alive += hp[i] > 0 ? 1U : 0U;
+  }
+  if (alive == order_.size()) {
+    return;
+  }
+  size_t out = 0;
+  for (const uint32_t i : order_) {
+    if (hp[i] > 0) {
+      order_[out++] = renumbered_[i];
+    }
+  }
+  order_.resize(out);
+}
+
+void ProgressOrder::Clear() { order_.clear(); }
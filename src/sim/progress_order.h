@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Enemy indices ordered front to back: highest path progress first, ties to
+// the lower index. Front, middle and back picks become positions in order()
+// instead of a sort per shot.
+class ProgressOrder {
+public:
+  // Orders enemies 0..progress.size() - 1. Enemies rarely overtake each
+  // other, so starting from the previous order an insertion pass costs
+  // about one comparison per enemy. Enemies added since the last build
+  // join at the back and move up from there, so spawns cost the same.
+  void Build(const std::vector<float> &progress);
+  // Drops the enemies with hp <= 0 and renumbers the rest the way
+  // EnemyStore::RemoveDead compacts them; call it just before that.
+  void RemoveDead(const std::vector<int> &hp);
+  // Forgets the order, for when every enemy is replaced at once.
+  void Clear();
+
+  std::span<const uint32_t> order() const { return order_; }
+  // Position of enemy i in order(); lower is further along the path.
+  uint32_t rank(size_t i) const { return ranks_[i]; }
+
+private:
+  std::vector<uint32_t> order_;
+  std::vector<uint32_t> ranks_; // inverse of order_
+  std::vector<uint32_t> renumbered_; // RemoveDead scratch
+};
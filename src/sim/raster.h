@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "sim/board.h"
+
+// Rasterizers for effects drawn on the board: they produce only the cells
+// an effect covers instead of testing every cell, clipped to a rectangle.
+
+// Cells x0..x1 by y0..y1, inclusive; empty when x1 < x0 or y1 < y0.
+struct CellRect {
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = -1;
+  int y1 = -1;
+
+  bool Contains(int x, int y) const {
+    return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+  }
+};
+
+// The size cells from origin.
+inline CellRect RectOf(const Position &origin, const BoardSize &size) {
+  return {origin.x, origin.y, origin.x + size.width - 1,
+          origin.y + size.height - 1};
+}
+
+namespace raster_detail {
+
+// round(i * d / n), halves away from zero, for 0 <= i <= n.
+inline int Step(int i, int d, int n) {
+  const int q = (2 * i * std::abs(d) + n) / (2 * n);
+  return d < 0 ? -q : q;
+}
+
+} // namespace raster_detail
+
+// Calls fn(x, y) for the cells of the segment from..to that lie in clip, in
+// order from `from`. The segment takes one cell per step along its longer
+// axis (cell i is from + round(i * (to - from) / n)), so it has no gaps or
+// doubled cells, and steps off the clip along that axis are never visited.
+template <typename Fn>
+void ForLineCells(const Position &from, const Position &to,
+                  const CellRect &clip, Fn &&fn) {
+  const int dx = to.x - from.x;
+  const int dy = to.y - from.y;
+  const int n = std::max(std::abs(dx), std::abs(dy));
+  if (n == 0) {
+    if (clip.Contains(from.x, from.y)) {
+      fn(from.x, from.y);
+    }
+    return;
+  }
+  const bool x_major = std::abs(dx) >= std::abs(dy);
+  const int start = x_major ? from.x : from.y;
+  const int lo = x_major ? clip.x0 : clip.y0;
+  const int hi = x_major ? clip.x1 : clip.y1;
+  const bool forward = (x_major ? dx : dy) > 0;
+  const int first = std::max(0, forward ? lo - start : start - hi);
+  const int last = std::min(n, forward ? hi - start : start - lo);
+  for (int i = first; i <= last; ++i) {
+    const int x = from.x + raster_detail::Step(i, dx, n);
+    const int y = from.y + raster_detail::Step(i, dy, n);
+    if (clip.Contains(x, y)) {
+      fn(x, y);
+    }
+  }
+}
+
+// Calls fn(y, x_begin, x_end) for each run of cells [x_begin, x_end) in clip
+// whose centres are strictly within half_width of the circle of radius
+// around center. A row has at most two runs, one each side of the centre.
+// Their ends come from the circle equations and are settled with the
+// per-cell test, so the cells are exactly those a full scan would find.
+template <typename Fn>
+void ForRingSpans(const Vec2 &center, float radius, float half_width,
+                  const CellRect &clip, Fn &&fn) {
+  const auto in_ring = [&](int x, int y) {
+    const float dx = center.x - static_cast<float>(x);
+    const float dy = center.y - static_cast<float>(y);
+    return std::abs(std::sqrt(dx * dx + dy * dy) - radius) < half_width;
+  };
+  const float outer = radius + half_width;
+  const float inner = radius - half_width;
+  const int mid = static_cast<int>(std::floor(center.x));
+  const int y0 =
+      std::max(clip.y0, static_cast<int>(std::floor(center.y - outer)));
+  const int y1 =
+      std::min(clip.y1, static_cast<int>(std::ceil(center.y + outer)));
+  for (int y = y0; y <= y1; ++y) {
+    // Within each half of the row the distance grows with |x - centre|,
+    // so the ring's cells there are contiguous: widen the estimate by a
+    // cell and trim it back with the exact test.
+    const auto emit = [&](int a, int b) {
+      while (a <= b && !in_ring(a, y)) {
+        ++a;
+      }
+      while (b >= a && !in_ring(b, y)) {
+        --b;
+      }
+      a = std::max(a, clip.x0);
+      b = std::min(b, clip.x1);
+      if (a <= b) {
+        fn(y, a, b + 1);
+      }
+    };
+    const float dy = center.y - static_cast<float>(y);
+    const float reach = std::sqrt(std::max(0.0F, outer * outer - dy * dy));
+    const float hole2 = inner * inner - dy * dy;
+    const bool has_hole = inner > 0.0F && hole2 > 0.0F;
+    const float hole = has_hole ? std::sqrt(hole2) : 0.0F;
+    const int left_end =
+        has_hole ? static_cast<int>(std::floor(center.x - hole)) + 1 : mid;
+    const int right_begin =
+        has_hole ? static_cast<int>(std::ceil(center.x + hole)) - 1 : mid + 1;
+    emit(static_cast<int>(std::ceil(center.x - reach)) - 1,
+         std::min(mid, left_end));
+    emit(std::max(mid + 1, right_begin),
+         static_cast<int>(std::floor(center.x + reach)) + 1);
+  }
+}
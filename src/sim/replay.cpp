@@ -0,0 +1,303 @@
+#include "sim/replay.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "sim/worker_pool.h"
+
+namespace {
+
+constexpr std::array<char, 4> kMagic = {'C', 'C', 'R', 'P'};
+constexpr uint8_t kVersion = 1;
+constexpr uint8_t kDevModeFlag = 1U << 0U;
+constexpr uint8_t kEndTag = 0xFF; // kind byte of the end marker
+
+using Kind = InputEvent::Kind;
+
+bool HasPosition(Kind kind) {
+  return kind == Kind::PlaceTower || kind == Kind::PickUpTower ||
+         kind == Kind::PlaceHeld || kind == Kind::UpgradeTower ||
+         kind == Kind::SellTower;
+}
+
+bool HasType(Kind kind) {
+  return kind == Kind::PlaceTower || kind == Kind::Unlock;
+}
+
+bool HasFlag(Kind kind) {
+  return kind == Kind::SetAutoWaves || kind == Kind::SetFastForward ||
+         kind == Kind::AdvanceMap;
+}
+
+// Bounds-checked reads over the whole log.
+class Reader {
+public:
+  explicit Reader(std::string data) : data_(std::move(data)) {}
+
+  bool AtEnd() const { return pos_ == data_.size(); }
+
+  bool Byte(uint8_t &out) {
+    if (AtEnd()) {
+      return false;
+    }
+    out = static_cast<uint8_t>(data_[pos_++]);
+    return true;
+  }
+
+  bool Varint(uint64_t &out) {
+    out = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t b = 0;
+      if (!Byte(b)) {
+        return false;
+      }
+      out |= static_cast<uint64_t>(b & 0x7FU) << shift;
+      if ((b & 0x80U) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool Coord(int &out) {
+    uint64_t v = 0;
+    if (!Varint(v) || v > 0xFFFFU) {
+      return false;
+    }
+    out = static_cast<int>(v);
+    return true;
+  }
+
+private:
+  std::string data_;
+  size_t pos_ = 0;
+};
+
+// Reads one event after its tick delta. False on malformed data.
+bool ReadEvent(Reader &r, uint8_t kind_byte, InputEvent &e) {
+  if (kind_byte > static_cast<uint8_t>(Kind::Reset)) {
+    return false;
+  }
+  e.kind = static_cast<Kind>(kind_byte);
+  if (HasType(e.kind)) {
+    uint8_t type = 0;
+    if (!r.Byte(type) || type >= kTowerTypeCount) {
+      return false;
+    }
+    e.type = static_cast<Tower::Type>(type);
+  }
+  if (HasPosition(e.kind) && !(r.Coord(e.pos.x) && r.Coord(e.pos.y))) {
+    return false;
+  }
+  if (HasFlag(e.kind)) {
+    uint8_t flag = 0;
+    if (!r.Byte(flag) || flag > 1) {
+      return false;
+    }
+    e.flag = flag != 0;
+  }
+  return true;
+}
+
+} // namespace
+
+InputResult ApplyInput(Simulation &sim, const InputEvent &event) {
+  InputResult result;
+  switch (event.kind) {
+  case Kind::PlaceTower:
+    result.place = sim.PlaceTower(event.type, event.pos);
+    break;
+  case Kind::PickUpTower:
+    result.ok = sim.PickUpTower(event.pos);
+    break;
+  case Kind::PlaceHeld:
+    result.place = sim.PlaceHeld(event.pos);
+    break;
+  case Kind::CancelHold:
+    sim.CancelHold();
+    break;
+  case Kind::UpgradeTower:
+    result.ok = sim.UpgradeTowerAt(event.pos);
+    break;
+  case Kind::SellTower:
+    result.ok = sim.SellTowerAt(event.pos);
+    break;
+  case Kind::Unlock:
+    result.ok = sim.TryUnlock(event.type);
+    break;
+  case Kind::StartWave:
+    sim.StartWave();
+    break;
+  case Kind::SetAutoWaves:
+    sim.SetAutoWaves(event.flag);
+    break;
+  case Kind::SetFastForward:
+    sim.SetFastForward(event.flag);
+    break;
+  case Kind::AdvanceMap:
+    sim.AdvanceMap(event.flag);
+    break;
+  case Kind::Reset:
+    sim.Reset();
+    break;
+  }
+  return result;
+}
+
+ReplayWriter::ReplayWriter(std::ostream &out, uint64_t seed, bool dev_mode)
+    : out_(out) {
+  out_.write(kMagic.data(), kMagic.size());
+  WriteByte(kVersion);
+  WriteByte(dev_mode ? kDevModeFlag : 0);
+  for (unsigned i = 0; i < 8; ++i) {
+    WriteByte(static_cast<uint8_t>(seed >> (8 * i)));
+  }
+  out_.flush();
+}
+
+void ReplayWriter::Record(const InputEvent &event) {
+  WriteVarint(event.tick - last_tick_);
+  last_tick_ = event.tick;
+  WriteByte(static_cast<uint8_t>(event.kind));
+  if (HasType(event.kind)) {
+    WriteByte(static_cast<uint8_t>(event.type));
+  }
+  if (HasPosition(event.kind)) {
+    WriteVarint(static_cast<uint64_t>(event.pos.x));
+    WriteVarint(static_cast<uint64_t>(event.pos.y));
+  }
+  if (HasFlag(event.kind)) {
+    WriteByte(event.flag ? 1 : 0);
+  }
+  out_.flush(); // inputs are rare; keep the file current
+}
+
+void ReplayWriter::Finish(uint64_t end_tick) {
+  WriteVarint(end_tick - last_tick_);
+  last_tick_ = end_tick;
+  WriteByte(kEndTag);
+  out_.flush();
+}
+
+void ReplayWriter::WriteVarint(uint64_t value) {
+  while (value >= 0x80U) {
+    WriteByte(static_cast<uint8_t>(value | 0x80U));
+    value >>= 7U;
+  }
+  WriteByte(static_cast<uint8_t>(value));
+}
+
+void ReplayWriter::WriteByte(uint8_t value) {
+  out_.put(static_cast<char>(value));
+}
+
+std::optional<ReplayLog> ReadReplay(std::istream &in,
+                                    const std::string &origin) {
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  Reader r(std::move(data));
+  const auto fail = [&](const char *what) -> std::optional<ReplayLog> {
+    std::cerr << "catcat: " << origin << ": " << what << "\n";
+    return std::nullopt;
+  };
+
+  for (const char c : kMagic) {
+    uint8_t b = 0;
+    if (!r.Byte(b) || static_cast<char>(b) != c) {
+      return fail("not a replay log");
+    }
+  }
+  uint8_t version = 0;
+  uint8_t flags = 0;
+  if (!r.Byte(version) || version != kVersion || !r.Byte(flags)) {
+    return fail("unsupported replay version");
+  }
+  ReplayLog log;
+  log.dev_mode = (flags & kDevModeFlag) != 0;
+  for (unsigned i = 0; i < 8; ++i) {
+    uint8_t b = 0;
+    if (!r.Byte(b)) {
+      return fail("truncated header");
+    }
+    log.seed |= static_cast<uint64_t>(b) << (8 * i);
+  }
+
+  uint64_t tick = 0;
+  while (!r.AtEnd()) {
+    uint64_t delta = 0;
+    uint8_t kind = 0;
+    if (!r.Varint(delta) || !r.Byte(kind)) {
+      break; // cut off mid-record; keep what was complete
+    }
+    tick += delta;
+    if (kind == kEndTag) {
+      log.end_tick = tick;
+      return log;
+    }
+    InputEvent e;
+    e.tick = tick;
+    if (!ReadEvent(r, kind, e)) {
+      if (r.AtEnd()) {
+        break;
+      }
+      return fail("malformed event");
+    }
+    log.events.push_back(e);
+  }
+  log.end_tick = log.events.empty() ? 0 : log.events.back().tick;
+  return log;
+}
+
+std::optional<ReplayLog> LoadReplay(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "catcat: cannot open replay " << path << "\n";
+    return std::nullopt;
+  }
+  return ReadReplay(in, path);
+}
+
+HeadlessResult RunReplay(const ReplayLog &log, int threads) {
+  const auto start = std::chrono::steady_clock::now();
+  Simulation sim(log.dev_mode);
+  sim.Seed(log.seed);
+  std::unique_ptr<WorkerPool> pool;
+  if (threads != 1) {
+    pool = std::make_unique<WorkerPool>(threads);
+    sim.SetWorkerPool(pool.get());
+  }
+  HeadlessResult result;
+  result.lives_lost_per_map.assign(static_cast<size_t>(sim.map_count()), 0);
+  size_t next = 0;
+  for (uint64_t tick = 0;; ++tick) {
+    for (; next < log.events.size() && log.events[next].tick <= tick; ++next) {
+      ApplyInput(sim, log.events[next]);
+    }
+    if (tick >= log.end_tick) {
+      break;
+    }
+    const auto map = static_cast<size_t>(sim.map_index());
+    const int lost = sim.lives_lost();
+    sim.Tick();
+    result.lives_lost_per_map[map] += sim.lives_lost() - lost;
+    ++result.ticks;
+  }
+
+  result.wave = sim.wave();
+  result.map_index = sim.map_index();
+  result.lives = sim.lives();
+  result.kibbles = sim.kibbles();
+  result.victory = sim.victory();
+  result.game_over = sim.game_over();
+  result.elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  return result;
+}
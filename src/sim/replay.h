@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "sim/headless.h"
+#include "sim/simulation.h"
+
+// One player command, stamped with the number of Tick() calls the session
+// had made when it was issued. Everything that changes the simulation from
+// outside goes through one of these, so a seed plus the event list replays
+// a session exactly.
+struct InputEvent {
+  enum class Kind : uint8_t {
+    PlaceTower,
+    PickUpTower,
+    PlaceHeld,
+    CancelHold,
+    UpgradeTower,
+    SellTower,
+    Unlock,
+    StartWave,
+    SetAutoWaves,
+    SetFastForward,
+    AdvanceMap,
+    Reset,
+  };
+  uint64_t tick = 0;
+  Kind kind = Kind::StartWave;
+  Tower::Type type = Tower::Type::Default; // PlaceTower, Unlock
+  Position pos{};    // PlaceTower through SellTower
+  bool flag = false; // SetAutoWaves, SetFastForward, AdvanceMap (dev skip)
+};
+
+// What the command returned; which field is meaningful depends on the kind.
+struct InputResult {
+  PlaceResult place = PlaceResult::Placed; // PlaceTower, PlaceHeld
+  bool ok = true; // PickUpTower, UpgradeTower, SellTower, Unlock
+};
+
+// Calls the Simulation method the event names.
+InputResult ApplyInput(Simulation &sim, const InputEvent &event);
+
+// A recorded session: the seed and mode it started with, its inputs in
+// tick order, and how many ticks it ran for.
+struct ReplayLog {
+  uint64_t seed = 0;
+  bool dev_mode = false;
+  uint64_t end_tick = 0;
+  std::vector<InputEvent> events;
+};
+
+// Streams a replay log as the session runs, so an abnormal exit loses at
+// most the end marker. The format is a 14-byte header (magic "CCRP",
+// version, flags, little-endian seed) then one record per event: a varint
+// tick delta, a kind byte and a few payload bytes.
+class ReplayWriter {
+public:
+  ReplayWriter(std::ostream &out, uint64_t seed, bool dev_mode);
+
+  // Events must arrive in tick order.
+  void Record(const InputEvent &event);
+  // Marks the session's length; nothing may be recorded after it.
+  void Finish(uint64_t end_tick);
+
+private:
+  void WriteVarint(uint64_t value);
+  void WriteByte(uint8_t value);
+
+  std::ostream &out_;
+  uint64_t last_tick_ = 0;
+};
+
+// Parses a log written by ReplayWriter. A log cut off after a complete
+// event ends at that event's tick. Prints the problem and returns
+// std::nullopt if the data is not a replay log.
+std::optional<ReplayLog> ReadReplay(std::istream &in,
+                                    const std::string &origin);
+std::optional<ReplayLog> LoadReplay(const std::string &path);
+
+// Plays a log back headless, ticking as fast as the CPU allows. threads
+// is as for HeadlessOptions.
+HeadlessResult RunReplay(const ReplayLog &log, int threads = 1);
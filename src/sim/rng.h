@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+// PCG32 (O'Neill): 64 bits of state, 32-bit outputs. Unlike std::mt19937
+// with the std distributions, the same seed gives the same draws on every
+// compiler and standard library, so seeds and replays are portable. It is
+// plain data and can be copied or saved byte for byte.
+struct Rng {
+  uint64_t state = 0x853c49e6748fea9bULL;
+  uint64_t inc = 0xda3e39cb94b95bdbULL;
+
+  void Seed(uint64_t seed, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+    state = 0;
+    inc = (stream << 1U) | 1U;
+    Next();
+    state += seed;
+    Next();
+  }
+
+  uint32_t Next() {
+    const uint64_t old = state;
+    state = old * 6364136223846793005ULL + inc;
+    const auto xorshifted = static_cast<uint32_t>(((old >> 18U) ^ old) >> 27U);
+    const auto rot = static_cast<uint32_t>(old >> 59U);
+    return (xorshifted >> rot) | (xorshifted << ((32U - rot) & 31U));
+  }
+
+  // Uniform in [min, max), from the top 24 bits of one draw.
+  float Uniform(float min, float max) {
+    const float unit = static_cast<float>(Next() >> 8U) * (1.0F / 16777216.0F);
+    return min + (max - min) * unit;
+  }
+
+  // Uniform in [lo, hi], rejecting the draws that would bias the modulo.
+  int UniformInt(int lo, int hi) {
+    const auto range = static_cast<uint32_t>(
+        static_cast<int64_t>(hi) - static_cast<int64_t>(lo) + 1);
+    if (range == 0) {
+      return static_cast<int>(Next()); // the full 32-bit range
+    }
+    const uint32_t threshold = (0U - range) % range;
+    uint32_t draw = Next();
+    while (draw < threshold) {
+      draw = Next();
+    }
+    return static_cast<int>(static_cast<int64_t>(lo) + draw % range);
+  }
+};
+
+// Fisher-Yates shuffle on Rng, in place of std::shuffle whose draws differ
+// between standard libraries.
+template <typename It> void Shuffle(It first, It last, Rng &rng) {
+  const auto count = std::distance(first, last);
+  for (auto i = count - 1; i > 0; --i) {
+    const auto j = rng.UniformInt(0, static_cast<int>(i));
+    using std::swap;
+    swap(first[i], first[j]);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Sound effects the simulation asks for. Each is resolved to its audio.json
+// "events" entry once when the config loads, so playing one is an array
+// index rather than a string lookup.
+enum class SfxEvent : uint8_t {
+  RatDie,
+  MouseDie,
+  BigRatDie,
+  DogDie,
+  TowerDefaultShoot,
+  TowerThunderShoot,
+  TowerFatShoot,
+  TowerKittyShoot,
+  TowerCatatonicShoot,
+  TowerGalacticShoot,
+  WaveStart,
+  MapChange,
+  LifeLost,
+  Unlock,
+  Place,
+  Sell,
+  Count,
+};
+constexpr size_t kSfxEventCount = static_cast<size_t>(SfxEvent::Count);
+
+// The audio.json event key of each SfxEvent, indexed by its value.
+constexpr std::array<const char *, kSfxEventCount> kSfxEventNames = {
+    "rat_die",
+    "mouse_die",
+    "bigrat_die",
+    "dog_die",
+    "tower_default_shoot",
+    "tower_thunder_shoot",
+    "tower_fat_shoot",
+    "tower_kitty_shoot",
+    "tower_catatonic_shoot",
+    "tower_galactic_shoot",
+    "wave_start",
+    "map_change",
+    "life_lost",
+    "unlock",
+    "place",
+    "sell",
+};
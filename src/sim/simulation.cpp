@@ -0,0 +1,1711 @@
+#include "sim/simulation.h"
+
+#include "sim/enemy_kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <utility>
+
+float DistanceSquared(const Vec2 &a, const Position &b) {
+  const float dx = a.x - static_cast<float>(b.x);
+  const float dy = a.y - static_cast<float>(b.y);
+  return dx * dx + dy * dy;
+}
+
+bool InRange(const Vec2 &center, const Position &cell, float range) {
+  return DistanceSquared(center, cell) <= range * range;
+}
+
+Vec2 TowerCenterAt(const Position &p, int size) {
+  const float cx =
+      static_cast<float>(p.x) + (static_cast<float>(size) - 1.0F) / 2.0F;
+  const float cy =
+      static_cast<float>(p.y) + (static_cast<float>(size) - 1.0F) / 2.0F;
+  return {cx, cy};
+}
+
+Vec2 TowerCenter(const Tower &t) { return TowerCenterAt(t.pos, t.size); }
+
+std::vector<Position> KittyOverlayCells(const Vec2 &center,
+                                        const BoardSize &board) {
+  std::vector<Position> cells;
+  const std::array<std::pair<int, int>, 4> dirs = {
+      std::pair<int, int>{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  for (const auto &[px, py] : dirs) {
+    const int perp_x = -py;
+    const int perp_y = px;
+    const std::array<int, 3> offs = {-1, 0, 1}; // overlapping 2-wide bands
+    for (int step = 1; step <= 3; ++step) {
+      for (int off : offs) {
+        const int gx =
+            static_cast<int>(std::round(center.x)) + px * step + perp_x * off;
+        const int gy =
+            static_cast<int>(std::round(center.y)) + py * step + perp_y * off;
+        if (!board.Contains(gx, gy)) {
+          continue;
+        }
+        cells.push_back({gx, gy});
+      }
+    }
+  }
+  return cells;
+}
+
+const TowerDef &GetDef(Tower::Type type) {
+  return Definitions::Active().tower(type);
+}
+
+std::span<const TowerDef> SortedDefs() {
+  return Definitions::Active().towers_by_cost();
+}
+
+Simulation::Simulation(bool dev_mode, const Definitions &defs)
+    : defs_(&defs), maps_(defs.maps()), dev_mode_(dev_mode) {
+  std::random_device device;
+  rng_.Seed((static_cast<uint64_t>(device()) << 32U) | device());
+  Reset();
+}
+
+void Simulation::Reset() {
+  wave_active_ = false;
+  game_over_ = false;
+  victory_ = false;
+  wave_ = 0;
+  map_index_ = 0;
+  kibbles_ = dev_mode_ ? 1000000 : kStartingKibbles;
+  lives_ = kStartingLives;
+  lives_lost_ = 0;
+  spawn_remaining_ = 0;
+  spawn_cooldown_ms_ = 0;
+  auto_waves_ = false;
+  fast_forward_ = false;
+  towers_.clear();
+  tower_cells_.Clear(board());
+  enemies_.Clear();
+  progress_order_.Clear();
+  enemy_grid_dirty_ = true;
+  hit_splats_.Clear();
+  projectiles_.Clear();
+  shockwaves_.Clear();
+  beams_.Clear();
+  area_highlights_.Clear();
+  held_tower_.reset();
+  unlocked_thunder_ = unlocked_fat_ = unlocked_kitty_ = false;
+  unlocked_catatonic_ = unlocked_galactic_ = false;
+  if (dev_mode_) {
+    unlocked_thunder_ = unlocked_fat_ = unlocked_kitty_ = true;
+    unlocked_catatonic_ = unlocked_galactic_ = true;
+  }
+  BuildPath();
+  SetMusic(map_index_);
+}
+
+bool Simulation::TryUnlock(Tower::Type type) {
+  if (IsUnlocked(type)) {
+    return true;
+  }
+  const TowerDef &def = defs_->tower(type);
+  const int unlock_cost = def.cost * 10;
+  if (kibbles_ < unlock_cost) {
+    return false;
+  }
+  kibbles_ -= unlock_cost;
+  Unlock(type);
+  Sfx(SfxEvent::Unlock);
+  return true;
+}
+
+void Simulation::Sfx(SfxEvent event) {
+  if (sfx_handler_)
+    sfx_handler_(event);
+}
+
+void Simulation::SetMusic(int map_idx) {
+  if (music_handler_)
+    music_handler_(map_idx);
+}
+
+void Simulation::TowerOccupancyMaskSkipping(
+    const std::vector<size_t> &skip_indices, BoardBitset &out) const {
+  // Towers never overlap, so clearing a skipped footprint frees only cells
+  // that tower owns.
+  out = tower_cells_.occupied();
+  for (size_t idx : skip_indices) {
+    if (idx < towers_.size()) {
+      const auto &t = towers_[idx];
+      out.ClearRect(t.pos.x, t.pos.y, t.pos.x + t.size - 1,
+                    t.pos.y + t.size - 1);
+    }
+  }
+}
+
+void Simulation::MoveTower(size_t index, const Position &to) {
+  Tower &t = towers_[index];
+  if (t.pos.x == to.x && t.pos.y == to.y) {
+    return;
+  }
+  tower_cells_.Remove(index, t.pos, t.size);
+  t.pos = to;
+  tower_cells_.Add(index, t.pos, t.size);
+}
+
+void Simulation::KittyAttackArea(const Vec2 &center,
+                                 const Position &target_cell,
+                                 std::vector<Position> &out) const {
+  const float dx = static_cast<float>(target_cell.x) - center.x;
+  const float dy = static_cast<float>(target_cell.y) - center.y;
+  const bool horizontal = std::abs(dx) >= std::abs(dy);
+  const int primary_x = horizontal ? ((dx > 0) - (dx < 0)) : 0;
+  const int primary_y = horizontal ? 0 : ((dy > 0) - (dy < 0));
+  const int perp_x = horizontal ? 0 : -primary_y;
+  const int perp_y = horizontal ? primary_x : 0;
+
+  out.clear();
+  for (int step = 1; step <= 3; ++step) { // depth 3
+    for (int off : {-1, 0, 1}) {          // overlapping 2-wide bands
+      const int gx = static_cast<int>(std::round(center.x)) +
+                     primary_x * step + perp_x * off;
+      const int gy = static_cast<int>(std::round(center.y)) +
+                     primary_y * step + perp_y * off;
+      if (!board().Contains(gx, gy)) {
+        continue;
+      }
+      out.push_back({gx, gy});
+    }
+  }
+}
+
+bool Simulation::KittyAreaHitsEnemy(const std::vector<Position> &cells) const {
+  const auto &grid = Grid();
+  bool hit = false;
+  for (const auto &c : cells) {
+    grid.ForEachInRect(c.x, c.y, c.x, c.y,
+                       [&](size_t i) { hit = hit || enemies_.hp[i] > 0; });
+    if (hit) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Simulation::KittyCellBlocked(
+    const Position &p, const BoardBitset &static_blocked,
+    const BoardBitset &reserved,
+    const std::optional<Position> &ignore_reserved) const {
+  if (!board().Contains(p)) {
+    return true;
+  }
+  if (path_mask_.Test(p)) {
+    return true;
+  }
+  if (reserved.Test(p)) {
+    if (!ignore_reserved.has_value() || ignore_reserved->x != p.x ||
+        ignore_reserved->y != p.y) {
+      return true;
+    }
+  }
+  return static_blocked.Test(p);
+}
+
+bool Simulation::CanKittyOccupyCell(size_t kitty_index,
+                                    const Position &p) const {
+  if (!board().Contains(p)) {
+    return false;
+  }
+  if (OccupiesPath(p, 1)) {
+    return false;
+  }
+  const auto owner = tower_cells_.OwnerAt(p);
+  return !owner.has_value() || *owner == kitty_index;
+}
+
+std::optional<Position>
+Simulation::ChooseKittyLanding(size_t tower_index,
+                               const BoardBitset &static_blocked,
+                               BoardBitset &reserved) {
+  const Tower &t = towers_[tower_index];
+  const Vec2 origin = TowerCenter(t);
+  const float jump_range = t.range + kKittyJumpBonusRange;
+  const float jump_r2 = jump_range * jump_range;
+
+  // Only cells inside the jump circle's bounding box can be in reach.
+  const int x0 =
+      std::max(0, static_cast<int>(std::floor(origin.x - jump_range)));
+  const int y0 =
+      std::max(0, static_cast<int>(std::floor(origin.y - jump_range)));
+  const int x1 = std::min(board().width - 1,
+                          static_cast<int>(std::ceil(origin.x + jump_range)));
+  const int y1 = std::min(board().height - 1,
+                          static_cast<int>(std::ceil(origin.y + jump_range)));
+  std::vector<Position> &candidates = landing_candidates_;
+  candidates.clear();
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      Position cell{x, y};
+      if (KittyCellBlocked(cell, static_blocked, reserved, t.pos)) {
+        continue;
+      }
+      const float d2 = DistanceSquared(origin, cell);
+      if (d2 > jump_r2) {
+        continue;
+      }
+
+      const Vec2 landing_center = TowerCenterAt(cell, t.size);
+      const auto target_idx = FindTargetAt(t, landing_center);
+      if (!target_idx.has_value()) {
+        continue;
+      }
+      KittyAttackArea(landing_center, EnemyCellAt(*target_idx),
+                      kitty_area_scratch_);
+      if (!KittyAreaHitsEnemy(kitty_area_scratch_)) {
+        continue;
+      }
+
+      candidates.push_back(cell);
+    }
+  }
+
+  if (candidates.empty()) {
+    if (!KittyCellBlocked(t.pos, static_blocked, reserved, t.pos)) {
+      reserved.Set(t.pos);
+      return t.pos;
+    }
+    return std::nullopt;
+  }
+
+  Shuffle(candidates.begin(), candidates.end(), rng_);
+  for (const auto &c : candidates) {
+    if (reserved.Test(c) && !(c.x == t.pos.x && c.y == t.pos.y)) {
+      continue;
+    }
+    reserved.Set(c);
+    return c;
+  }
+  return std::nullopt;
+}
+
+void Simulation::HandleKittyAttacks() {
+  std::vector<size_t> &ready_kitties = ready_kitties_;
+  ready_kitties.clear();
+  for (size_t i = 0; i < towers_.size(); ++i) {
+    Tower &t = towers_[i];
+    if (t.type != Tower::Type::Kitty || t.cooldown > 0.0F) {
+      continue;
+    }
+    if (enemies_.empty()) {
+      continue;
+    }
+    ready_kitties.push_back(i);
+  }
+  if (ready_kitties.empty()) {
+    return;
+  }
+
+  std::vector<size_t> &jumping_kitties = jumping_kitties_;
+  jumping_kitties.clear();
+  for (size_t idx : ready_kitties) {
+    if (towers_[idx].upgraded) {
+      jumping_kitties.push_back(idx);
+    }
+  }
+
+  BoardBitset &static_blocked = kitty_blocked_;
+  TowerOccupancyMaskSkipping(jumping_kitties, static_blocked);
+  BoardBitset &reserved = kitty_reserved_;
+  reserved.Resize(board());
+  for (size_t idx : jumping_kitties) {
+    reserved.Set(towers_[idx].pos);
+  }
+  std::vector<std::optional<Position>> &planned_landings = planned_landings_;
+  planned_landings.assign(towers_.size(), std::nullopt);
+
+  std::vector<size_t> &jump_order = kitty_jump_order_;
+  jump_order.assign(jumping_kitties.begin(), jumping_kitties.end());
+  Shuffle(jump_order.begin(), jump_order.end(), rng_);
+  for (size_t idx : jump_order) {
+    planned_landings[idx] = ChooseKittyLanding(idx, static_blocked, reserved);
+  }
+
+  for (size_t idx : ready_kitties) {
+    Tower &t = towers_[idx];
+    Position destination = t.pos;
+    if (t.upgraded) {
+      if (planned_landings[idx].has_value()) {
+        destination = *planned_landings[idx];
+      }
+      const bool destination_changed =
+          destination.x != t.pos.x || destination.y != t.pos.y;
+      if (destination_changed && !CanKittyOccupyCell(idx, destination)) {
+        destination = t.pos;
+      }
+    }
+
+    // Only jump if there is something to attack from the landing cell.
+    const auto target =
+        FindTargetAt(t, TowerCenterAt(destination, t.size));
+    if (!target.has_value()) {
+      continue;
+    }
+    MoveTower(idx, destination);
+
+    FireKitty(t, *target);
+    Sfx(SfxEvent::TowerKittyShoot);
+    t.cooldown = NextCooldown(t.fire_rate);
+  }
+}
+
+void Simulation::ReturnKittiesHome() {
+  std::vector<size_t> &kitty_indices = jumping_kitties_;
+  kitty_indices.clear();
+  for (size_t i = 0; i < towers_.size(); ++i) {
+    if (towers_[i].type == Tower::Type::Kitty) {
+      kitty_indices.push_back(i);
+    }
+  }
+  if (kitty_indices.empty()) {
+    return;
+  }
+
+  BoardBitset &static_blocked = kitty_blocked_;
+  TowerOccupancyMaskSkipping(kitty_indices, static_blocked);
+  BoardBitset &reserved = kitty_reserved_;
+  reserved.Resize(board());
+
+  for (size_t idx : kitty_indices) {
+    Tower &t = towers_[idx];
+    if (t.pos.x == t.home.x && t.pos.y == t.home.y) {
+      reserved.Set(t.pos);
+      continue;
+    }
+    MoveTower(idx, NearestOpenCell(t.home, static_blocked, reserved, t.pos));
+  }
+}
+
+void Simulation::Tick() {
+  if (game_over_ || victory_) {
+    return;
+  }
+
+  using Phase = TickProfiler::Phase;
+  const ScopedPhase whole(profiler_, Phase::Tick);
+  // Runs one phase, timed when a profiler is attached.
+  const auto phase = [this](Phase p, void (Simulation::*step)()) {
+    const ScopedPhase timed(profiler_, p);
+    (this->*step)();
+  };
+  phase(Phase::SpawnTick, &Simulation::SpawnTick);
+  phase(Phase::MoveEnemies, &Simulation::MoveEnemies);
+  phase(Phase::TowersAct, &Simulation::TowersAct);
+  phase(Phase::MoveProjectiles, &Simulation::MoveProjectiles);
+  phase(Phase::ResolveProjectiles, &Simulation::ResolveProjectiles);
+  phase(Phase::UpdateShockwaves, &Simulation::UpdateShockwaves);
+  phase(Phase::UpdateBeams, &Simulation::UpdateBeams);
+  phase(Phase::UpdateAreas, &Simulation::UpdateAreas);
+  phase(Phase::Cleanup, &Simulation::Cleanup);
+  phase(Phase::UpdateHitSplats, &Simulation::UpdateHitSplats);
+  phase(Phase::CheckWaveCompletion, &Simulation::CheckWaveCompletion);
+  if (lives_ <= 0) {
+    if (!game_over_) {
+      game_over_ = true;
+      auto_waves_ = false;
+      SetMusic(-1);
+    }
+  }
+}
+
+void Simulation::TracePath(const MapDef &map, std::vector<Position> &path,
+                           BoardBitset &mask) {
+  path.clear();
+  // Build center path.
+  for (size_t i = 1; i < map.anchors.size(); ++i) {
+    const auto &from = map.anchors[i - 1];
+    const auto &to = map.anchors[i];
+    if (from.x == to.x) {
+      const int dir = (to.y > from.y) ? 1 : -1;
+      for (int y = from.y; y != to.y + dir; y += dir) {
+        path.push_back({from.x, y});
+      }
+    } else if (from.y == to.y) {
+      const int dir = (to.x > from.x) ? 1 : -1;
+      for (int x = from.x; x != to.x + dir; x += dir) {
+        path.push_back({x, from.y});
+      }
+    }
+  }
+
+  mask.Resize(map.board);
+  const int spread = map.path_width - 1;
+  for (const auto &p : path) {
+    mask.SetRect(p.x - spread, p.y - spread, p.x + spread, p.y + spread);
+  }
+}
+
+void Simulation::BuildPath() {
+  const MapDef &map = CurrentMap();
+  TracePath(map, path_, path_mask_);
+  changed_cells_.Resize(map.board);
+
+  // Cell of every (path index, lane) pair, row-major by path index.
+  path_lane_span_ = std::max(1, map.path_width) - 1;
+  path_cells_.clear();
+  path_cells_.reserve(path_.size() *
+                      static_cast<size_t>(2 * path_lane_span_ + 1));
+  for (size_t i = 0; i < path_.size(); ++i) {
+    for (int lane = -path_lane_span_; lane <= path_lane_span_; ++lane) {
+      path_cells_.push_back(ComputePathCell(i, lane));
+    }
+  }
+  RefreshEnemyCells();
+}
+
+void Simulation::StartWave() {
+  if (wave_active_ || game_over_) {
+    return;
+  }
+  ++wave_;
+  spawn_remaining_ = 6 + DifficultyLevel() * 2;
+  if (const int level = EndlessLevel(); level > 0) {
+    spawn_remaining_ = static_cast<int>(
+        static_cast<float>(spawn_remaining_) *
+        (1.0F + wave_rules_.growth * static_cast<float>(level)));
+  }
+  spawn_cooldown_ms_ = 0;
+  wave_active_ = true;
+  Sfx(SfxEvent::WaveStart);
+}
+
+void Simulation::SpawnTick() {
+  if (!wave_active_) {
+    return;
+  }
+
+  if (spawn_remaining_ <= 0 && enemies_.empty()) {
+    return;
+  }
+
+  // Swarm waves land all at once, spread over the path's first quarter.
+  if (wave_rules_.swarm_every > 0 && wave_ % wave_rules_.swarm_every == 0 &&
+      spawn_remaining_ > 0) {
+    const float spread = static_cast<float>(path_.size() - 1) * 0.25F;
+    const int count = spawn_remaining_;
+    for (int i = 0; i < count; ++i) {
+      SpawnEnemy(spread * static_cast<float>(i) / static_cast<float>(count));
+    }
+    spawn_remaining_ = 0;
+    return;
+  }
+
+  spawn_cooldown_ms_ -= kTickMs;
+  if (spawn_cooldown_ms_ > 0 || spawn_remaining_ <= 0) {
+    return;
+  }
+
+  // Endless levels each add an enemy per spawn interval.
+  const int batch = std::min(spawn_remaining_, 1 + EndlessLevel());
+  for (int i = 0; i < batch; ++i) {
+    SpawnEnemy(0.0F);
+  }
+  spawn_remaining_ -= batch;
+  spawn_cooldown_ms_ = static_cast<int>(600.0F / kSpeedFactor);
+}
+
+void Simulation::SpawnEnemy(float progress) {
+  Enemy e;
+  e.path_progress = progress;
+  const int diff = DifficultyLevel();
+  e.type = SelectEnemyType(diff);
+  ApplyEnemyStats(e, diff);
+  const int width = std::max(1, CurrentMap().path_width);
+  if (width > 1) {
+    e.lane_offset = rng_.UniformInt(-(width - 1), width - 1);
+  }
+  AddEnemy(e);
+}
+
+void Simulation::MoveEnemies() {
+  int lives_before = lives_;
+  const size_t n = enemies_.size();
+  AdvanceEnemies(enemies_.path_progress.data(), enemies_.speed.data(),
+                 enemies_.sleep_timer.data(), n, Dt());
+
+  // floor(progress) >= end_index is progress >= end_index for a whole end.
+  const int end_index = static_cast<int>(path_.size() - 1);
+  const int finished =
+      ZeroFinished(enemies_.path_progress.data(), enemies_.hp.data(), n,
+                   static_cast<float>(end_index));
+  if (wave_rules_.leaks_cost_lives) {
+    lives_ = std::max(0, lives_ - finished);
+  }
+  lives_lost_ += lives_before - lives_;
+  if (lives_ < lives_before) {
+    Sfx(SfxEvent::LifeLost);
+  }
+  RefreshEnemyCells();
+  Grid();
+}
+
+void Simulation::AddEnemy(const Enemy &e) {
+  enemies_.Add(e);
+  RefreshEnemyCell(enemies_.size() - 1);
+}
+
+void Simulation::RefreshEnemyCell(size_t i) {
+  const Position cell =
+      PathCell(enemies_.path_progress[i], enemies_.lane_offset[i]);
+  enemies_.x[i] = cell.x;
+  enemies_.y[i] = cell.y;
+  enemy_grid_dirty_ = true;
+}
+
+void Simulation::RefreshEnemyCells() {
+  for (size_t i = 0; i < enemies_.size(); ++i) {
+    const Position cell =
+        PathCell(enemies_.path_progress[i], enemies_.lane_offset[i]);
+    enemies_.x[i] = cell.x;
+    enemies_.y[i] = cell.y;
+  }
+  enemy_grid_dirty_ = true;
+}
+
+const EnemyGrid &Simulation::Grid() const {
+  if (!enemy_grid_dirty_) {
+    return enemy_grid_;
+  }
+  enemy_grid_dirty_ = false;
+  enemy_grid_.Build(board(), enemies_.x, enemies_.y);
+  progress_order_.Build(enemies_.path_progress);
+  return enemy_grid_;
+}
+
+// Indices of enemies whose cell is within radius of center (the same test
+// as InRange), gathered from the covering buckets in bucket order.
+void Simulation::CollectInRange(const Vec2 &center, float radius,
+                                std::vector<size_t> &out) const {
+  const size_t first = out.size();
+  Grid().CollectRect(static_cast<int>(std::floor(center.x - radius)),
+                     static_cast<int>(std::floor(center.y - radius)),
+                     static_cast<int>(std::ceil(center.x + radius)),
+                     static_cast<int>(std::ceil(center.y + radius)), out);
+  const size_t kept = KeepInRange(enemies_.x.data(), enemies_.y.data(),
+                                  out.data() + first, out.size() - first,
+                                  center.x, center.y, radius * radius);
+  out.resize(first + kept);
+}
+
+// As CollectInRange, replacing out with the hits in ascending enemy order.
+void Simulation::EnemiesInRange(const Vec2 &center, float radius,
+                                std::vector<size_t> &out) const {
+  out.clear();
+  CollectInRange(center, radius, out);
+  std::sort(out.begin(), out.end());
+}
+
+// Replaces out with the indices, in ascending order, of enemies in cells
+// within roughly half_width of the ray from origin along the unit vector
+// dir, starting half_width behind origin and running to the board edge.
+void Simulation::EnemiesNearLine(const Vec2 &origin, const Vec2 &dir,
+                                 float half_width,
+                                 std::vector<size_t> &out) const {
+  out.clear();
+  const BoardSize &b = board();
+  // Columns the ray may cover in row y, or false if it misses the row.
+  const auto row_span = [&](int y, int &x0, int &x1) {
+    const float vy = static_cast<float>(y) - origin.y;
+    x0 = 0;
+    x1 = b.width - 1;
+    if (std::abs(dir.y) > 1e-4F) {
+      // Solve |vx * dir.y - vy * dir.x| <= half_width for vx.
+      float lo = (vy * dir.x - half_width) / dir.y;
+      float hi = (vy * dir.x + half_width) / dir.y;
+      if (lo > hi) {
+        std::swap(lo, hi);
+      }
+      x0 = static_cast<int>(std::floor(origin.x + lo)) - 1;
+      x1 = static_cast<int>(std::ceil(origin.x + hi)) + 1;
+      return true;
+    }
+    // A horizontal line only reaches the rows it runs along.
+    return std::abs(vy * dir.x) <= half_width + 0.01F;
+  };
+
+  // Rows between the start of the ray and where it leaves the board's
+  // columns (or its rows, for a ray that never leaves the columns).
+  const float rows_end = dir.y > 0.0F ? static_cast<float>(b.height) : -1.0F;
+  float y_end = rows_end;
+  if (std::abs(dir.x) > 1e-4F) {
+    const float x_end = dir.x > 0.0F
+                            ? static_cast<float>(b.width) + half_width
+                            : -1.0F - half_width;
+    y_end = origin.y + (x_end - origin.x) / dir.x * dir.y;
+    y_end = dir.y > 0.0F ? std::min(y_end, rows_end)
+                         : std::max(y_end, rows_end);
+  }
+  const float y_start = origin.y - half_width * dir.y;
+  const int y0 = std::max(
+      0, static_cast<int>(std::floor(std::min(y_start, y_end) - half_width)) -
+             1);
+  const int y1 = std::min(
+      b.height - 1,
+      static_cast<int>(std::ceil(std::max(y_start, y_end) + half_width)) + 1);
+  if (y0 > y1) {
+    return;
+  }
+
+  // Walking rows costs a search each; past one row per enemy, checking
+  // every enemy's cell against its row is cheaper.
+  if (static_cast<size_t>(y1 - y0 + 1) > enemies_.size()) {
+    for (size_t i = 0; i < enemies_.size(); ++i) {
+      const int y = enemies_.y[i];
+      int x0 = 0;
+      int x1 = 0;
+      if (y >= y0 && y <= y1 && row_span(y, x0, x1) && enemies_.x[i] >= x0 &&
+          enemies_.x[i] <= x1) {
+        out.push_back(i);
+      }
+    }
+    return;
+  }
+  const auto &grid = Grid();
+  for (int y = y0; y <= y1; ++y) {
+    int x0 = 0;
+    int x1 = 0;
+    if (row_span(y, x0, x1)) {
+      grid.CollectRect(x0, y, x1, y, out);
+    }
+  }
+  std::sort(out.begin(), out.end());
+}
+
+std::optional<size_t> Simulation::FindTargetAt(const Tower &t,
+                                               const Vec2 &center) const {
+  return FindTargetAt(t, center, target_scratch_);
+}
+
+std::optional<size_t>
+Simulation::FindTargetAt(const Tower &t, const Vec2 &center,
+                         std::vector<size_t> &scratch) const {
+  // The living enemy furthest along; ties go to the lowest index.
+  const ProgressOrder &order = Order();
+  // Thunder reaches the whole board.
+  if (t.type == Tower::Type::Thunder) {
+    for (uint32_t i : order.order()) {
+      if (enemies_.hp[i] > 0) {
+        return i;
+      }
+    }
+    return std::nullopt;
+  }
+  std::optional<size_t> best;
+  uint32_t best_rank = 0;
+  scratch.clear();
+  CollectInRange(center, t.range, scratch);
+  for (size_t i : scratch) {
+    if (enemies_.hp[i] > 0 &&
+        (!best.has_value() || order.rank(i) < best_rank)) {
+      best_rank = order.rank(i);
+      best = i;
+    }
+  }
+  return best;
+}
+
+std::optional<size_t> Simulation::FindTarget(const Tower &t) const {
+  return FindTargetAt(t, TowerCenter(t));
+}
+
+Position Simulation::NearestOpenCell(const Position &desired,
+                                     const BoardBitset &blocked,
+                                     BoardBitset &reserved,
+                                     const Position &fallback) {
+  std::vector<Position> best;
+  int best_d2 = std::numeric_limits<int>::max();
+  const auto consider = [&](int x, int y) {
+    if (!board().Contains(x, y) || path_mask_.Test(x, y) ||
+        blocked.Test(x, y) || reserved.Test(x, y)) {
+      return;
+    }
+    const int dx = x - desired.x;
+    const int dy = y - desired.y;
+    const int d2 = dx * dx + dy * dy;
+    if (d2 < best_d2) {
+      best_d2 = d2;
+      best.clear();
+      best.push_back({x, y});
+    } else if (d2 == best_d2) {
+      best.push_back({x, y});
+    }
+  };
+  // Square rings of growing radius r around desired. Every cell on ring r
+  // is at least r away, so the search ends at the first ring past the best
+  // distance found and its cost does not grow with the board.
+  const BoardSize &size = board();
+  const int max_r = std::max({desired.x, desired.y, size.width - 1 - desired.x,
+                              size.height - 1 - desired.y});
+  for (int r = 0; r <= max_r && r * r <= best_d2; ++r) {
+    for (int x = desired.x - r; x <= desired.x + r; ++x) {
+      consider(x, desired.y - r);
+      if (r > 0) {
+        consider(x, desired.y + r);
+      }
+    }
+    for (int y = desired.y - r + 1; y < desired.y + r; ++y) {
+      consider(desired.x - r, y);
+      consider(desired.x + r, y);
+    }
+  }
+  // Ties in row-major order, as a scan of the whole board meets them.
+  std::sort(best.begin(), best.end(), [](const Position &p, const Position &q) {
+    return p.y != q.y ? p.y < q.y : p.x < q.x;
+  });
+
+  if (best.empty()) {
+    reserved.Set(fallback);
+    return fallback;
+  }
+  Shuffle(best.begin(), best.end(), rng_);
+  const auto chosen = best.front();
+  reserved.Set(chosen);
+  return chosen;
+}
+
+void Simulation::TowersAct() {
+  for (auto &t : towers_) {
+    t.cooldown -= Dt();
+  }
+
+  // Phase one: each ready tower plans its attack against the enemies as
+  // they stand. Planning only reads the world, so it can run on the pool.
+  ready_towers_.clear();
+  for (size_t i = 0; i < towers_.size(); ++i) {
+    const Tower &t = towers_[i];
+    if (t.type != Tower::Type::Kitty && t.cooldown <= 0.0F) {
+      ready_towers_.push_back(i);
+    }
+  }
+  if (tower_plans_.size() < ready_towers_.size()) {
+    tower_plans_.resize(ready_towers_.size());
+  }
+  Grid(); // built here so the planners share it read-only
+  const auto plan_range = [this](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      PlanTower(towers_[ready_towers_[k]], tower_plans_[k]);
+    }
+  };
+  if (worker_pool_ != nullptr && ready_towers_.size() >= kMinParallelPlans) {
+    worker_pool_->ParallelFor(ready_towers_.size(), plan_range);
+  } else {
+    plan_range(0, ready_towers_.size());
+  }
+
+  // Phase two: apply the plans in tower order; damage, bounty, sound and
+  // every random draw happen here. A kill or teleport can change what a
+  // later tower would pick, so a plan whose reach covers a changed cell is
+  // redone first. Each tick thus matches firing the towers one by one.
+  changed_cells_.Reset();
+  enemies_changed_ = false;
+  for (size_t k = 0; k < ready_towers_.size(); ++k) {
+    Tower &t = towers_[ready_towers_[k]];
+    TowerPlan &plan = tower_plans_[k];
+    if (PlanIsStale(t)) {
+      PlanTower(t, plan);
+    }
+    ApplyPlan(t, plan);
+  }
+
+  HandleKittyAttacks();
+}
+
+void Simulation::PlanTower(const Tower &t, TowerPlan &plan) const {
+  plan.picks.clear();
+  plan.hits.clear();
+  plan.hit_ends.clear();
+  plan.hits_ready = true;
+  const auto target = FindTargetAt(t, TowerCenter(t), plan.scratch);
+  plan.fires = target.has_value();
+  if (!plan.fires) {
+    return;
+  }
+  plan.target = *target;
+
+  const auto c = TowerCenter(t);
+  switch (t.type) {
+  case Tower::Type::Default: {
+    if (!t.upgraded) {
+      plan.picks.push_back(plan.target);
+      break;
+    }
+    // Front, middle and back of the enemies in range, by rank.
+    const ProgressOrder &order = Order();
+    auto &ranks = plan.ranks;
+    ranks.clear();
+    plan.scratch.clear();
+    CollectInRange(c, t.range, plan.scratch);
+    for (size_t j : plan.scratch) {
+      if (enemies_.hp[j] > 0)
+        ranks.push_back(order.rank(j));
+    }
+    if (!ranks.empty()) {
+      const auto mid =
+          ranks.begin() + static_cast<std::ptrdiff_t>(ranks.size() / 2);
+      std::nth_element(ranks.begin(), mid, ranks.end());
+      const auto by_rank = order.order();
+      const size_t mid_idx = by_rank[*mid];
+      const size_t front_idx =
+          by_rank[*std::min_element(ranks.begin(), mid + 1)];
+      const size_t back_idx = by_rank[*std::max_element(mid, ranks.end())];
+      plan.picks.push_back(front_idx);
+      if (mid_idx != front_idx)
+        plan.picks.push_back(mid_idx);
+      if (back_idx != front_idx && back_idx != mid_idx)
+        plan.picks.push_back(back_idx);
+    }
+    break;
+  }
+  case Tower::Type::Thunder:
+    ThunderTargets(t, plan.scratch, plan.picks);
+    for (size_t idx : plan.picks) {
+      LaserHits(t, idx, plan.scratch, plan.hits);
+      plan.hit_ends.push_back(plan.hits.size());
+    }
+    break;
+  case Tower::Type::Fat:
+    EnemiesInRange(c, t.range, plan.hits);
+    break;
+  case Tower::Type::Catatonic:
+    EnemiesInRange(c, t.upgraded ? t.range + 0.8F : t.range, plan.hits);
+    break;
+  case Tower::Type::Galactic: {
+    // Cones are cached on first use, which only the apply phase may do.
+    const auto cell = EnemyCellAt(plan.target);
+    const ConeStencil *cone = cone_stencils_.Find(
+        t.size, t.range, cell.x - t.pos.x, cell.y - t.pos.y);
+    plan.hits_ready = cone != nullptr;
+    if (cone != nullptr) {
+      GalacticHits(t, *cone, plan.hits);
+    }
+    break;
+  }
+  case Tower::Type::Kitty:
+    plan.fires = false; // handled separately
+    break;
+  }
+}
+
+bool Simulation::PlanIsStale(const Tower &t) const {
+  if (!enemies_changed_) {
+    return false;
+  }
+  // Thunder ranks every enemy on the board.
+  if (t.type == Tower::Type::Thunder) {
+    return true;
+  }
+  const float reach = t.type == Tower::Type::Catatonic && t.upgraded
+                          ? t.range + 0.8F
+                          : t.range;
+  const auto c = TowerCenter(t);
+  return changed_cells_.AnyInRect(static_cast<int>(std::floor(c.x - reach)),
+                                  static_cast<int>(std::floor(c.y - reach)),
+                                  static_cast<int>(std::ceil(c.x + reach)),
+                                  static_cast<int>(std::ceil(c.y + reach)));
+}
+
+void Simulation::ApplyPlan(Tower &t, TowerPlan &plan) {
+  if (!plan.fires) {
+    return;
+  }
+  switch (t.type) {
+  case Tower::Type::Default: {
+    const auto c = TowerCenter(t);
+    for (size_t target : plan.picks) {
+      Projectile p;
+      p.x = static_cast<float>(c.x);
+      p.y = static_cast<float>(c.y);
+      p.target = EnemyCellAt(target);
+      p.speed = 17.0F;
+      p.damage = t.damage;
+      projectiles_.Push(p);
+    }
+    Sfx(SfxEvent::TowerDefaultShoot);
+    break;
+  }
+  case Tower::Type::Thunder: {
+    if (plan.picks.empty()) {
+      return;
+    }
+    size_t begin = 0;
+    for (size_t k = 0; k < plan.picks.size(); ++k) {
+      const size_t end = plan.hit_ends[k];
+      FireLaser(t, plan.picks[k],
+                std::span<const size_t>(plan.hits).subspan(begin, end - begin));
+      begin = end;
+    }
+    Sfx(SfxEvent::TowerThunderShoot);
+    break;
+  }
+  case Tower::Type::Fat:
+    FireShockwave(t, plan.hits);
+    Sfx(SfxEvent::TowerFatShoot);
+    break;
+  case Tower::Type::Catatonic:
+    FireCatatonic(t, plan.hits);
+    Sfx(SfxEvent::TowerCatatonicShoot);
+    break;
+  case Tower::Type::Galactic: {
+    const ConeStencil &cone = GalacticCone(t, plan.target);
+    if (!plan.hits_ready) {
+      GalacticHits(t, cone, plan.hits);
+    }
+    ApplyGalactic(t, cone, plan.hits);
+    Sfx(SfxEvent::TowerGalacticShoot);
+    break;
+  }
+  case Tower::Type::Kitty:
+    return;
+  }
+  t.cooldown = NextCooldown(t.fire_rate);
+}
+
+void Simulation::MoveProjectiles() {
+  for (auto &p : projectiles_) {
+    const float dx = static_cast<float>(p.target.x) - p.x;
+    const float dy = static_cast<float>(p.target.y) - p.y;
+    const float dist = std::sqrt(dx * dx + dy * dy);
+    const float step = p.speed * Dt();
+    if (dist <= step || dist < 1e-3F) {
+      p.x = static_cast<float>(p.target.x);
+      p.y = static_cast<float>(p.target.y);
+      continue;
+    }
+    const float norm = step / dist;
+    p.x += dx * norm;
+    p.y += dy * norm;
+  }
+}
+
+void Simulation::ResolveProjectiles() {
+  // Arrived projectiles hit and are compacted out; the rest keep flying.
+  projectiles_.RemoveIf([&](const Projectile &p) {
+    const float dx = static_cast<float>(p.target.x) - p.x;
+    const float dy = static_cast<float>(p.target.y) - p.y;
+    const float dist2 = dx * dx + dy * dy;
+    if (dist2 > 0.05F) { // not arrived yet
+      return false;
+    }
+
+    // Find nearest enemy to impact point.
+    std::optional<size_t> hit_index;
+    float best_d2 = 1.0F;
+    Grid().ForEachInRect(static_cast<int>(std::floor(p.x)) - 1,
+                         static_cast<int>(std::floor(p.y)) - 1,
+                         static_cast<int>(std::ceil(p.x)) + 1,
+                         static_cast<int>(std::ceil(p.y)) + 1, [&](size_t i) {
+                           const float ddx =
+                               static_cast<float>(enemies_.x[i]) - p.x;
+                           const float ddy =
+                               static_cast<float>(enemies_.y[i]) - p.y;
+                           const float d2 = ddx * ddx + ddy * ddy;
+                           if (d2 < best_d2 ||
+                               (d2 == best_d2 && hit_index.has_value() &&
+                                i < *hit_index)) {
+                             best_d2 = d2;
+                             hit_index = i;
+                           }
+                         });
+
+    if (hit_index.has_value()) {
+      const size_t target = *hit_index;
+      enemies_.hp[target] -= p.damage;
+      if (enemies_.hp[target] <= 0) {
+        kibbles_ += Bounty(enemies_.type[target]);
+        PlayDeathSfx(enemies_.type[target]);
+      } else {
+        hit_splats_.Push({EnemyCellAt(target), 0.28F});
+      }
+    }
+    return true;
+  });
+}
+
+void Simulation::Cleanup() {
+  progress_order_.RemoveDead(enemies_.hp);
+  if (enemies_.RemoveDead()) {
+    enemy_grid_dirty_ = true;
+  }
+}
+
+EnemyType Simulation::SelectEnemyType(int diff) {
+  // Keep mice present throughout; taper their share as difficulty rises.
+  const float mouse_share =
+      std::clamp(0.40F - 0.015F * static_cast<float>(diff), 0.18F, 0.40F);
+  const float roll = Rand(0.0F, 1.0F);
+  if (roll < mouse_share) {
+    return EnemyType::Mouse;
+  }
+  // Occasional big rats as mid bosses.
+  if (diff >= 9 && Rand(0.0F, 1.0F) < 0.18F) {
+    return EnemyType::BigRat;
+  }
+  // Chance for scary dogs once the player is a few maps in.
+  if (map_index_ >= 3 && diff >= 16 && Rand(0.0F, 1.0F) < 0.08F) {
+    return EnemyType::Dog;
+  }
+  return EnemyType::Rat;
+}
+
+void Simulation::ApplyEnemyStats(Enemy &e, const int diff) {
+  const EnemyDef &def = defs_->enemy(e.type);
+  const float fDiff = static_cast<float>(diff);
+  e.max_hp = def.hp + static_cast<int>(fDiff * def.hp_per_level);
+  e.speed = (def.speed + fDiff * def.speed_per_level) * kSpeedFactor;
+  e.hp = e.max_hp;
+}
+
+void Simulation::UpdateHitSplats() {
+  for (auto &hs : hit_splats_) {
+    hs.time_left -= Dt();
+  }
+  hit_splats_.RemoveIf(
+      [](const HitSplat &hs) { return hs.time_left <= 0.0F; });
+}
+
+void Simulation::CheckWaveCompletion() {
+  if (!wave_active_) {
+    return;
+  }
+  if (spawn_remaining_ > 0 || !enemies_.empty()) {
+    return;
+  }
+
+  wave_active_ = false;
+  ReturnKittiesHome();
+  kibbles_ += 20 + wave_ * 3;
+
+  if (wave_ % 10 == 0) {
+    const bool last_map = map_index_ == static_cast<int>(maps_.size()) - 1;
+    if (!last_map) {
+      AdvanceMap();
+    } else if (!wave_rules_.endless) {
+      victory_ = true;
+      auto_waves_ = false;
+      wave_active_ = false;
+      SetMusic(-1);
+      return;
+    }
+  }
+
+  if (auto_waves_ && !game_over_) {
+    StartWave();
+  }
+}
+
+void Simulation::AdvanceMap(bool dev_skip) {
+  map_index_ = (map_index_ + 1) % static_cast<int>(maps_.size());
+  wave_active_ = false;
+  spawn_remaining_ = 0;
+  enemies_.Clear();
+  progress_order_.Clear();
+  enemy_grid_dirty_ = true;
+  towers_.clear();
+  tower_cells_.Clear(board());
+  held_tower_.reset();
+  // Preserve kibbles across maps to let players invest between stages.
+  lives_ = kStartingLives;
+  auto_waves_ = false;
+  BuildPath();
+  if (dev_skip) {
+    wave_ = map_index_ * 10;
+  }
+  SetMusic(map_index_);
+  Sfx(SfxEvent::MapChange);
+}
+
+PlaceResult Simulation::PlaceTower(Tower::Type type, const Position &p) {
+  const TowerDef &def = defs_->tower(type);
+  if (!IsUnlocked(def.type)) {
+    return PlaceResult::Locked;
+  }
+  if (kibbles_ < def.cost) {
+    return PlaceResult::TooExpensive;
+  }
+  if (def.type == Tower::Type::Catatonic &&
+      CatatonicConflict(p, def.size, def.type, def.range, false)) {
+    return PlaceResult::CatatonicConflict;
+  }
+  if (!CanPlace(p, def.size, def.type, def.range, false)) {
+    return PlaceResult::Blocked;
+  }
+
+  Tower t;
+  t.pos = p;
+  t.damage = def.damage;
+  t.range = def.range;
+  t.fire_rate = def.fire_rate;
+  t.cooldown = Rand(0.05F, t.fire_rate); // offset starts for async cadence
+  t.type = def.type;
+  t.size = def.size;
+  t.home = t.pos;
+  AddTower(t);
+  kibbles_ -= def.cost;
+  Sfx(SfxEvent::Place);
+  return PlaceResult::Placed;
+}
+
+Position Simulation::EnemyCell(const Enemy &e) const {
+  return PathCell(e.path_progress, e.lane_offset);
+}
+
+Position Simulation::PathCell(float path_progress, int lane_offset) const {
+  const int idx =
+      static_cast<int>(std::clamp(std::floor(path_progress), 0.0F,
+                                  static_cast<float>(path_.size() - 1)));
+  if (lane_offset >= -path_lane_span_ && lane_offset <= path_lane_span_) {
+    const auto lanes = static_cast<size_t>(2 * path_lane_span_ + 1);
+    const auto lane = static_cast<size_t>(lane_offset + path_lane_span_);
+    return path_cells_[static_cast<size_t>(idx) * lanes + lane];
+  }
+  return ComputePathCell(static_cast<size_t>(idx), lane_offset);
+}
+
+Position Simulation::ComputePathCell(size_t i, int lane_offset) const {
+  Position base = path_[i];
+  int dx = 0;
+  int dy = 0;
+  if (i + 1 < path_.size()) {
+    dx = path_[i + 1].x - base.x;
+    dy = path_[i + 1].y - base.y;
+  } else if (i > 0) {
+    dx = base.x - path_[i - 1].x;
+    dy = base.y - path_[i - 1].y;
+  }
+  dx = (dx > 0) - (dx < 0);
+  dy = (dy > 0) - (dy < 0);
+  Position perp{-dy, dx};
+  base.x = std::clamp(base.x + perp.x * lane_offset, 0, board().width - 1);
+  base.y = std::clamp(base.y + perp.y * lane_offset, 0, board().height - 1);
+  return base;
+}
+
+float Simulation::Rand(float min, float max) {
+  return rng_.Uniform(min, max);
+}
+
+int Simulation::Bounty(const EnemyType type) const {
+  return defs_->enemy(type).bounty;
+}
+
+float Simulation::NextCooldown(float base_rate) {
+  const float scaled = base_rate / kSpeedFactor;
+  return std::max(0.06F, scaled + Rand(-0.14F, 0.14F));
+}
+
+int Simulation::DifficultyLevel() const {
+  const int local = (wave_ - 1) % 10 + 1;
+  return local + difficulty_.offset +
+         (map_index_ + EndlessLevel()) * difficulty_.per_map;
+}
+
+int Simulation::EndlessLevel() const {
+  if (!wave_rules_.endless || wave_ <= 0) {
+    return 0;
+  }
+  return std::max(0, (wave_ - 1) / 10 - (static_cast<int>(maps_.size()) - 1));
+}
+
+bool Simulation::Idle() const {
+  if (game_over_ || victory_) {
+    return true;
+  }
+  if (wave_active_ || !enemies_.empty() || !projectiles_.empty() ||
+      !hit_splats_.empty() || !shockwaves_.empty() || !beams_.empty() ||
+      !area_highlights_.empty()) {
+    return false;
+  }
+  // A cooling tower still counts down to its next shot.
+  return std::all_of(towers_.begin(), towers_.end(),
+                     [](const Tower &t) { return t.cooldown <= 0.0F; });
+}
+
+std::optional<int> Simulation::UpcomingMusic() const {
+  if (wave_ <= 0 || game_over_ || victory_) {
+    return std::nullopt;
+  }
+  // Maps change once their tenth wave is cleared, which leaves wave 10 of
+  // the new map's count showing until the next wave starts.
+  const int local = (wave_ - 1) % 10 + 1;
+  if (local < 9 || (local == 10 && !wave_active_)) {
+    return std::nullopt;
+  }
+  const bool last_map = map_index_ == static_cast<int>(maps_.size()) - 1;
+  if (last_map && wave_rules_.endless) {
+    return std::nullopt; // endless play stays on it
+  }
+  return last_map ? -1 : map_index_ + 1;
+}
+
+void Simulation::PlayDeathSfx(EnemyType type) {
+  switch (type) {
+  case EnemyType::Mouse:
+    Sfx(SfxEvent::MouseDie);
+    break;
+  case EnemyType::Rat:
+    Sfx(SfxEvent::RatDie);
+    break;
+  case EnemyType::BigRat:
+    Sfx(SfxEvent::BigRatDie);
+    break;
+  case EnemyType::Dog:
+    Sfx(SfxEvent::DogDie);
+    break;
+  }
+}
+
+bool Simulation::IsUnlocked(Tower::Type type) const {
+  switch (type) {
+  case Tower::Type::Default:
+    return true;
+  case Tower::Type::Fat:
+    return unlocked_fat_;
+  case Tower::Type::Kitty:
+    return unlocked_kitty_;
+  case Tower::Type::Thunder:
+    return unlocked_thunder_;
+  case Tower::Type::Catatonic:
+    return unlocked_catatonic_;
+  case Tower::Type::Galactic:
+    return unlocked_galactic_;
+  }
+  return true;
+}
+
+void Simulation::Unlock(Tower::Type type) {
+  if (type == Tower::Type::Fat)
+    unlocked_fat_ = true;
+  if (type == Tower::Type::Kitty)
+    unlocked_kitty_ = true;
+  if (type == Tower::Type::Thunder)
+    unlocked_thunder_ = true;
+  if (type == Tower::Type::Catatonic)
+    unlocked_catatonic_ = true;
+  if (type == Tower::Type::Galactic)
+    unlocked_galactic_ = true;
+}
+
+bool Simulation::OverlapsTower(const Position &p, int size) const {
+  return tower_cells_.AnyInRect(p.x, p.y, p.x + size - 1, p.y + size - 1);
+}
+
+bool Simulation::OccupiesPath(const Position &p, int size) const {
+  if (size <= 0) {
+    return false;
+  }
+  // Any part of the footprint off the board counts as blocked.
+  if (p.x < 0 || p.y < 0 || p.x + size > board().width ||
+      p.y + size > board().height) {
+    return true;
+  }
+  return path_mask_.AnyInRect(p.x, p.y, p.x + size - 1, p.y + size - 1);
+}
+
+bool Simulation::CatatonicConflict(const Position &p, int size,
+                                   Tower::Type type, float range,
+                                   bool upgraded) const {
+  if (type != Tower::Type::Catatonic) {
+    return false;
+  }
+  const float candidate_range = range + (upgraded ? 0.8F : 0.0F);
+  const Vec2 center = {
+      static_cast<float>(p.x) + (static_cast<float>(size) - 1.0F) / 2.0F,
+      static_cast<float>(p.y) + (static_cast<float>(size) - 1.0F) / 2.0F};
+  for (const auto &t : towers_) {
+    if (t.type != Tower::Type::Catatonic) {
+      continue;
+    }
+    const Vec2 other = TowerCenter(t);
+    const float dx = center.x - other.x;
+    const float dy = center.y - other.y;
+    const float dist2 = dx * dx + dy * dy;
+    const float max_r =
+        candidate_range + t.range + (t.upgraded ? 0.8F : 0.0F);
+    if (dist2 <= max_r * max_r) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Simulation::CanPlace(const Position &p, int size, Tower::Type type,
+                          float range, bool upgraded) const {
+  if (p.x < 0 || p.y < 0 || p.x + size - 1 >= board().width ||
+      p.y + size - 1 >= board().height) {
+    return false;
+  }
+  if (OccupiesPath(p, size)) {
+    return false;
+  }
+  if (OverlapsTower(p, size)) {
+    return false;
+  }
+  if (CatatonicConflict(p, size, type, range, upgraded)) {
+    return false;
+  }
+  return true;
+}
+
+std::optional<size_t> Simulation::TowerIndexAt(const Position &p) const {
+  return tower_cells_.OwnerAt(p);
+}
+
+bool Simulation::PickUpTower(const Position &p) {
+  if (held_tower_.has_value()) {
+    return false;
+  }
+  const auto idx = TowerIndexAt(p);
+  if (!idx.has_value()) {
+    return false;
+  }
+  HeldTower hold;
+  hold.tower = towers_[*idx];
+  hold.original = towers_[*idx].pos;
+  held_tower_ = hold;
+  tower_cells_.Erase(*idx, hold.tower.pos, hold.tower.size);
+  towers_.erase(towers_.begin() + static_cast<long>(*idx));
+  return true;
+}
+
+PlaceResult Simulation::PlaceHeld(const Position &p) {
+  if (!held_tower_.has_value()) {
+    return PlaceResult::Blocked;
+  }
+  auto t = held_tower_->tower;
+  if (t.type == Tower::Type::Catatonic &&
+      CatatonicConflict(p, t.size, t.type, t.range, t.upgraded)) {
+    return PlaceResult::CatatonicConflict;
+  }
+  if (!CanPlace(p, t.size, t.type, t.range, t.upgraded)) {
+    return PlaceResult::Blocked;
+  }
+  t.pos = p;
+  t.home = t.pos;
+  t.cooldown = Rand(0.05F, t.fire_rate);
+  AddTower(t);
+  held_tower_.reset();
+  return PlaceResult::Placed;
+}
+
+void Simulation::CancelHold() {
+  if (!held_tower_.has_value()) {
+    return;
+  }
+  auto t = held_tower_->tower;
+  t.pos = held_tower_->original;
+  AddTower(t);
+  held_tower_.reset();
+}
+
+bool Simulation::SellTowerAt(const Position &p) {
+  if (held_tower_.has_value()) {
+    return false;
+  }
+  const auto idx = TowerIndexAt(p);
+  if (!idx.has_value()) {
+    return false;
+  }
+  const Tower &t = towers_[*idx];
+  const TowerDef &def = defs_->tower(t.type);
+  const int refund =
+      static_cast<int>(std::round(static_cast<float>(def.cost) * 0.6F));
+  kibbles_ += refund;
+  tower_cells_.Erase(*idx, t.pos, t.size);
+  towers_.erase(towers_.begin() + static_cast<long>(*idx));
+  Sfx(SfxEvent::Sell);
+  return true;
+}
+
+bool Simulation::UpgradeTowerAt(const Position &p) {
+  if (held_tower_.has_value()) {
+    return false;
+  }
+  const auto idx = TowerIndexAt(p);
+  if (!idx.has_value()) {
+    return false;
+  }
+  Tower &t = towers_[*idx];
+  if (t.upgraded) {
+    return false;
+  }
+  const TowerDef &def = defs_->tower(t.type);
+  const int cost = def.cost * 2;
+  if (kibbles_ < cost) {
+    return false;
+  }
+  kibbles_ -= cost;
+  t.upgraded = true;
+  if (t.type == Tower::Type::Fat) {
+    t.range += 1.0F;
+  } else if (t.type == Tower::Type::Default) {
+    t.range += 2.0F;
+  }
+  Sfx(SfxEvent::Unlock);
+  return true;
+}
+
+// Appends to out the enemies, in ascending order, that a laser from t at
+// target would hit.
+void Simulation::LaserHits(const Tower &t, size_t target,
+                           std::vector<size_t> &scratch,
+                           std::vector<size_t> &out) const {
+  const auto center = TowerCenter(t);
+  const auto target_cell = EnemyCellAt(target);
+  const float dx = static_cast<float>(target_cell.x) - center.x;
+  const float dy = static_cast<float>(target_cell.y) - center.y;
+  const float len = std::max(0.001F, std::sqrt(dx * dx + dy * dy));
+  const float ndx = dx / len;
+  const float ndy = dy / len;
+
+  // Enemies near the line in front of the cat.
+  EnemiesNearLine(center, {ndx, ndy}, 0.35F, scratch);
+  for (size_t i : scratch) {
+    const auto pos = EnemyCellAt(i);
+    const float vx = static_cast<float>(pos.x) - center.x;
+    const float vy = static_cast<float>(pos.y) - center.y;
+    const float dot = vx * ndx + vy * ndy;
+    if (dot < -0.2F) {
+      continue;
+    }
+    const float cross = std::abs(vx * ndy - vy * ndx);
+    if (cross <= 0.35F) {
+      out.push_back(i);
+    }
+  }
+}
+
+void Simulation::FireLaser(const Tower &t, size_t target,
+                           std::span<const size_t> hits) {
+  const auto center = TowerCenter(t);
+  const auto target_cell = EnemyCellAt(target);
+  const float dx = static_cast<float>(target_cell.x) - center.x;
+  const float dy = static_cast<float>(target_cell.y) - center.y;
+  const float len = std::max(0.001F, std::sqrt(dx * dx + dy * dy));
+  const float ndx = dx / len;
+  const float ndy = dy / len;
+
+  for (size_t i : hits) {
+    DamageEnemy(i, t.damage, EnemyCellAt(i), 0.18F);
+  }
+
+  // The beam runs until its cells (the rounded points of the ray) leave the
+  // board; only its ends are kept, the renderer rasterizes the rest.
+  const BoardSize &size = board();
+  float reach = std::numeric_limits<float>::max();
+  if (ndx != 0.0F) {
+    const float edge =
+        ndx > 0.0F ? static_cast<float>(size.width) - 0.5F : -0.5F;
+    reach = std::min(reach, (edge - center.x) / ndx);
+  }
+  if (ndy != 0.0F) {
+    const float edge =
+        ndy > 0.0F ? static_cast<float>(size.height) - 0.5F : -0.5F;
+    reach = std::min(reach, (edge - center.y) / ndy);
+  }
+  const auto cell_at = [&](float along) {
+    return Position{
+        std::clamp(static_cast<int>(std::round(center.x + ndx * along)), 0,
+                   size.width - 1),
+        std::clamp(static_cast<int>(std::round(center.y + ndy * along)), 0,
+                   size.height - 1)};
+  };
+  Beam beam;
+  beam.from = cell_at(0.0F);
+  beam.to = cell_at(reach);
+  beams_.Push(beam);
+}
+
+// Front of the board's living enemies, plus its middle and back when
+// upgraded; alive is scratch for the living enemies front to back.
+void Simulation::ThunderTargets(const Tower &t, std::vector<size_t> &alive,
+                                std::vector<size_t> &picks) const {
+  picks.clear();
+  alive.clear();
+  for (uint32_t i : Order().order()) {
+    if (enemies_.hp[i] > 0) {
+      alive.push_back(i);
+    }
+  }
+  if (alive.empty()) {
+    return;
+  }
+  auto add_unique = [&](size_t idx) {
+    if (std::find(picks.begin(), picks.end(), idx) == picks.end()) {
+      picks.push_back(idx);
+    }
+  };
+  add_unique(alive.front());
+  if (!t.upgraded) {
+    return;
+  }
+  add_unique(alive[alive.size() / 2]);
+  add_unique(alive.back());
+}
+
+void Simulation::FireShockwave(const Tower &t, std::span<const size_t> hits) {
+  Shockwave sw;
+  sw.center = TowerCenter(t);
+  sw.radius = 0.0F;
+  sw.max_radius = t.range;
+  sw.speed = 10.0F;
+  sw.time_left = 0.45F;
+  shockwaves_.Push(sw);
+
+  for (size_t i : hits) {
+    DamageEnemy(i, t.damage, EnemyCellAt(i), 0.22F);
+  }
+}
+
+void Simulation::FireKitty(const Tower &t, size_t target) {
+  const auto center = TowerCenter(t);
+  const auto target_cell = EnemyCellAt(target);
+  AreaHighlight &area = area_highlights_.Acquire();
+  KittyAttackArea(center, target_cell, area.cells);
+  area.time_left = 0.22F;
+  area.kind = AreaHighlight::Kind::Swipe;
+
+  auto &hits = hit_scratch_;
+  hits.clear();
+  for (const auto &c : area.cells) {
+    Grid().CollectCell(c, hits);
+  }
+  std::sort(hits.begin(), hits.end());
+  for (size_t i : hits) {
+    DamageEnemy(i, t.damage, EnemyCellAt(i), 0.18F);
+  }
+
+  if (area.cells.empty()) {
+    area_highlights_.PopBack();
+  }
+}
+
+void Simulation::FireCatatonic(const Tower &t, std::span<const size_t> hits) {
+  const float sleep_dur = std::clamp(
+      t.upgraded ? kCatSleepUpgrade : kCatSleepBase, 0.0F, kCatSleepCap);
+  AreaHighlight &area = area_highlights_.Acquire();
+  area.cells.clear();
+  area.time_left = 0.6F;
+  area.kind = AreaHighlight::Kind::Sleep;
+  for (size_t i : hits) {
+    float &sleep = enemies_.sleep_timer[i];
+    sleep = std::min(kCatSleepCap, std::max(sleep, sleep_dur));
+    area.cells.push_back(EnemyCellAt(i));
+  }
+  if (area.cells.empty()) {
+    area_highlights_.PopBack();
+  }
+}
+
+const ConeStencil &Simulation::GalacticCone(const Tower &t, size_t target) {
+  const auto target_cell = EnemyCellAt(target);
+  return cone_stencils_.Get(t.size, t.range, target_cell.x - t.pos.x,
+                            target_cell.y - t.pos.y);
+}
+
+// Replaces out with the enemies, in ascending order, inside t's cone.
+void Simulation::GalacticHits(const Tower &t, const ConeStencil &cone,
+                              std::vector<size_t> &out) const {
+  EnemiesInRange(TowerCenter(t), t.range, out);
+  std::erase_if(out, [&](size_t i) {
+    const auto pos = EnemyCellAt(i);
+    return !cone.Contains(pos.x - t.pos.x, pos.y - t.pos.y);
+  });
+}
+
+void Simulation::FireGalactic(const Tower &t, size_t target) {
+  const ConeStencil &cone = GalacticCone(t, target);
+  GalacticHits(t, cone, hit_scratch_);
+  ApplyGalactic(t, cone, hit_scratch_);
+}
+
+void Simulation::ApplyGalactic(const Tower &t, const ConeStencil &cone,
+                               std::span<const size_t> hits) {
+  AreaHighlight &area = area_highlights_.Acquire();
+  auto &cells = area.cells;
+  cells.clear();
+  for (const auto &o : cone.offsets) {
+    const int x = t.pos.x + o.x;
+    const int y = t.pos.y + o.y;
+    if (board().Contains(x, y)) {
+      cells.push_back({x, y});
+    }
+  }
+
+  bool void_proc = t.upgraded && Rand(0.0F, 1.0F) < kGalacticVoidChance;
+  for (size_t i : hits) {
+    const auto pos = EnemyCellAt(i);
+    const bool teleported = void_proc;
+    if (teleported) {
+      NoteEnemyChanged(i);
+      enemies_.path_progress[i] =
+          std::max(0.0F, enemies_.path_progress[i] - kGalacticVoidBackstep);
+      RefreshEnemyCell(i);
+      NoteEnemyChanged(i);
+    }
+    DamageEnemy(i, t.damage, pos, 0.2F);
+  }
+
+  if (cells.empty()) {
+    area_highlights_.PopBack();
+    return;
+  }
+  area.time_left = void_proc ? 0.35F : 0.3F;
+  area.kind =
+      void_proc ? AreaHighlight::Kind::Void : AreaHighlight::Kind::Cosmic;
+}
+
+// One hit: bounty and death sound if it leaves the enemy at zero hp or
+// below (again, for one already there), otherwise a splat at `splat`.
+void Simulation::DamageEnemy(size_t i, int damage, const Position &splat,
+                             float splat_time) {
+  const bool was_alive = enemies_.hp[i] > 0;
+  enemies_.hp[i] -= damage;
+  if (enemies_.hp[i] <= 0) {
+    if (was_alive) {
+      NoteEnemyChanged(i);
+    }
+    kibbles_ += Bounty(enemies_.type[i]);
+    PlayDeathSfx(enemies_.type[i]);
+  } else {
+    hit_splats_.Push({splat, splat_time});
+  }
+}
+
+void Simulation::NoteEnemyChanged(size_t i) {
+  changed_cells_.Set(EnemyCellAt(i));
+  enemies_changed_ = true;
+}
+
+void Simulation::UpdateShockwaves() {
+  for (auto &sw : shockwaves_) {
+    sw.radius += sw.speed * Dt();
+    sw.time_left -= Dt();
+  }
+  shockwaves_.RemoveIf([](const Shockwave &sw) {
+    return sw.time_left <= 0.0F || sw.radius > sw.max_radius;
+  });
+}
+
+void Simulation::UpdateBeams() {
+  for (auto &b : beams_) {
+    b.time_left -= Dt();
+  }
+  beams_.RemoveIf([](const Beam &b) { return b.time_left <= 0.0F; });
+}
+
+void Simulation::UpdateAreas() {
+  for (auto &a : area_highlights_) {
+    a.time_left -= Dt();
+  }
+  area_highlights_.RemoveIf(
+      [](const AreaHighlight &a) { return a.time_left <= 0.0F; });
+}
+
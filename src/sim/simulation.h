@@ -0,0 +1,435 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sim/board.h"
+#include "sim/board_bitset.h"
+#include "sim/cone_stencils.h"
+#include "sim/definitions.h"
+#include "sim/effect_pool.h"
+#include "sim/enemy_grid.h"
+#include "sim/enemy_store.h"
+#include "sim/progress_order.h"
+#include "sim/rng.h"
+#include "sim/sfx.h"
+#include "sim/tick_profiler.h"
+#include "sim/tower_occupancy.h"
+#include "sim/worker_pool.h"
+
+constexpr int kTickMs = 16; // ~60 FPS
+constexpr float kTickSeconds = kTickMs / 1000.0F;
+constexpr int kStartingKibbles = 90;
+constexpr float kSpeedFactor = 1.3F; // Global pacing multiplier (~30% faster).
+constexpr int kFastForwardSteps = 5; // fixed ticks per frame when fast
+constexpr int kStartingLives = 9;
+constexpr float kCatSleepBase = 0.5F;
+constexpr float kCatSleepUpgrade = 1.0F;
+constexpr float kCatSleepCap = 5.0F;
+constexpr float kGalacticVoidChance = 0.50;
+constexpr float kGalacticVoidBackstep = 8.0F;
+constexpr float kKittyJumpBonusRange = 1.5F; // extra reach for upgraded jumps
+// Splats beyond this many recycle the oldest; they are only drawn.
+constexpr size_t kMaxHitSplats = 1024;
+// Fewer ready towers than this plan on the calling thread even with a pool.
+constexpr size_t kMinParallelPlans = 32;
+
+struct HitSplat {
+  Position pos{};
+  float time_left = 0.25F; // seconds
+};
+
+struct Projectile {
+  float x = 0.0F;
+  float y = 0.0F;
+  Position target{};
+  float speed = 17.0F; // cells per second
+  int damage = 0;
+};
+
+struct Shockwave {
+  Vec2 center{};
+  float radius = 0.0F;
+  float max_radius = 0.0F;
+  float speed = 10.0F;
+  float time_left = 0.4F;
+  float max_time = 0.4F;
+};
+
+// A laser from its tower to the board's edge, drawn as the line between its
+// end cells (see ForLineCells).
+struct Beam {
+  Position from{};
+  Position to{};
+  float time_left = 0.18F;
+};
+
+struct HeldTower {
+  Tower tower;
+  Position original{};
+};
+
+struct AreaHighlight {
+  // Which attack left the highlight; the renderer picks glyph and color.
+  enum class Kind { Swipe, Sleep, Cosmic, Void };
+
+  std::vector<Position> cells;
+  float time_left = 0.2F;
+  Kind kind = Kind::Swipe;
+};
+
+// DifficultyLevel() is the wave within the map (1-10) plus offset plus
+// per_map for every map already cleared (and endless level reached).
+struct DifficultyCurve {
+  int offset = 0;
+  int per_map = 2; // soft ramp to allow longer runs
+};
+
+// How waves grow beyond the normal game, for stress runs. The defaults are
+// the normal game.
+struct WaveRules {
+  // Clearing the last map's tenth wave does not win: play stays on that map
+  // and every further ten waves is an endless level, raising the difficulty
+  // by the curve's per_map, the wave size by `growth` of itself and the
+  // spawn rate by one more enemy per interval.
+  bool endless = false;
+  float growth = 1.0F;
+  // Every swarm_every-th wave (0: none) puts its whole count on the path at
+  // once, spread over the path's first quarter.
+  int swarm_every = 0;
+  // False for stress runs that should keep their load once the defence
+  // breaks: enemies reaching the end leave without costing lives.
+  bool leaks_cost_lives = true;
+};
+
+enum class PlaceResult {
+  Placed,
+  Locked,
+  TooExpensive,
+  Blocked,
+  CatatonicConflict
+};
+
+// The active definitions' tower of a type, and all of them ordered by
+// cost; the latter drives number keys and the shop.
+const TowerDef &GetDef(Tower::Type type);
+std::span<const TowerDef> SortedDefs();
+
+float DistanceSquared(const Vec2 &a, const Position &b);
+bool InRange(const Vec2 &center, const Position &cell, float range);
+Vec2 TowerCenterAt(const Position &p, int size);
+Vec2 TowerCenter(const Tower &t);
+std::vector<Position> KittyOverlayCells(const Vec2 &center,
+                                        const BoardSize &board);
+
+// The game world and its fixed-timestep step function. Has no rendering,
+// input or audio dependency; sound and music requests go through the
+// optional handlers so headless runs, tests and benchmarks can ignore them.
+class Simulation {
+public:
+  using SfxHandler = std::function<void(SfxEvent)>;
+  using MusicHandler = std::function<void(int)>;
+
+  // defs must outlive the simulation.
+  explicit Simulation(bool dev_mode = false,
+                      const Definitions &defs = Definitions::Active());
+
+  void SetSfxHandler(SfxHandler handler) { sfx_handler_ = std::move(handler); }
+  void SetMusicHandler(MusicHandler handler) {
+    music_handler_ = std::move(handler);
+  }
+  // Plans tower attacks on the pool's threads; nullptr (the default) plans
+  // on the calling thread. Results are identical either way. The pool is
+  // not owned and must outlive its use by Tick().
+  void SetWorkerPool(WorkerPool *pool) { worker_pool_ = pool; }
+  // Times every Tick() phase into profiler; nullptr (the default) times
+  // nothing. Not owned.
+  void SetProfiler(TickProfiler *profiler) { profiler_ = profiler; }
+  // Restarts the random sequence; a seeded run with the same inputs plays
+  // out identically on any platform. Reset() keeps the sequence going.
+  void Seed(uint64_t seed) { rng_.Seed(seed); }
+  void SetDifficultyCurve(const DifficultyCurve &curve) { difficulty_ = curve; }
+  // Not part of save states; a restored world keeps the rules it had.
+  void SetWaveRules(const WaveRules &rules) { wave_rules_ = rules; }
+  const WaveRules &wave_rules() const { return wave_rules_; }
+
+  // Save states, in the format described in sim/snapshot.h. A restored
+  // world plays on exactly as the saved one would have, random sequence
+  // included; handlers and the worker pool are kept. RestoreSnapshot leaves
+  // the world untouched and returns false if data is not a snapshot that
+  // fits this build.
+  std::vector<std::byte> SaveSnapshot() const;
+  bool RestoreSnapshot(std::span<const std::byte> data);
+
+  void Reset();
+  // Advances the world by one tick of Dt() seconds.
+  void Tick();
+
+  // Player commands.
+  PlaceResult PlaceTower(Tower::Type type, const Position &p);
+  bool PickUpTower(const Position &p);
+  PlaceResult PlaceHeld(const Position &p);
+  void CancelHold();
+  bool UpgradeTowerAt(const Position &p);
+  bool SellTowerAt(const Position &p);
+  bool TryUnlock(Tower::Type type);
+  void StartWave();
+  void SetAutoWaves(bool enabled) { auto_waves_ = enabled; }
+  void SetFastForward(bool enabled) { fast_forward_ = enabled; }
+  void AdvanceMap(bool dev_skip = false);
+
+  // Tick phases, in the order Tick() runs them. Public so tests and
+  // benchmarks can drive them one at a time.
+  void SpawnTick();
+  void MoveEnemies();
+  void TowersAct();
+  void HandleKittyAttacks();
+  void MoveProjectiles();
+  void ResolveProjectiles();
+  void UpdateShockwaves();
+  void UpdateBeams();
+  void UpdateAreas();
+  void Cleanup();
+  void UpdateHitSplats();
+  void CheckWaveCompletion();
+  void FireGalactic(const Tower &t, size_t target);
+
+  // Direct world edits for tests, benchmarks and synthetic scenarios; no
+  // cost or placement rules are applied.
+  void AddTower(const Tower &t) {
+    tower_cells_.Add(towers_.size(), t.pos, t.size);
+    towers_.push_back(t);
+  }
+  void AddEnemy(const Enemy &e);
+  void AddProjectile(const Projectile &p) { projectiles_.Push(p); }
+
+  // The current map's board.
+  const BoardSize &board() const { return CurrentMap().board; }
+  const std::vector<Position> &path() const { return path_; }
+  const BoardBitset &path_mask() const { return path_mask_; }
+  const EnemyStore &enemies() const { return enemies_; }
+  const std::vector<Tower> &towers() const { return towers_; }
+  // In-place edits only: moving or resizing a tower here would leave the
+  // occupancy map stale.
+  std::vector<Tower> &towers() { return towers_; }
+  const EffectPool<HitSplat> &hit_splats() const { return hit_splats_; }
+  const EffectPool<Projectile> &projectiles() const { return projectiles_; }
+  const EffectPool<Shockwave> &shockwaves() const { return shockwaves_; }
+  const EffectPool<Beam> &beams() const { return beams_; }
+  const EffectPool<AreaHighlight> &area_highlights() const {
+    return area_highlights_;
+  }
+  const std::optional<HeldTower> &held_tower() const { return held_tower_; }
+  int map_count() const { return static_cast<int>(maps_.size()); }
+  int map_index() const { return map_index_; }
+  int wave() const { return wave_; }
+  int lives() const { return lives_; }
+  // Lives lost since Reset(), over all maps.
+  int lives_lost() const { return lives_lost_; }
+  int kibbles() const { return kibbles_; }
+  bool wave_active() const { return wave_active_; }
+  bool auto_waves() const { return auto_waves_; }
+  bool fast_forward() const { return fast_forward_; }
+  bool game_over() const { return game_over_; }
+  bool victory() const { return victory_; }
+  bool dev_mode() const { return dev_mode_; }
+  // True when Tick() would change nothing anyone could see: the game has
+  // ended, or no wave is running, no effect is playing and every tower is
+  // ready. A front end may then stop ticking until the next input.
+  bool Idle() const;
+
+  // The music the next map will ask SetMusic() for (-1 after the last map),
+  // once the current map is into its last two waves; std::nullopt before
+  // then and once the game has ended. Lets the audio load it ahead.
+  std::optional<int> UpcomingMusic() const;
+
+  bool IsUnlocked(Tower::Type type) const;
+  Position EnemyCell(const Enemy &e) const;
+  // Cell of enemies()[i], kept current as enemies move.
+  Position EnemyCellAt(size_t i) const {
+    return {enemies_.x[i], enemies_.y[i]};
+  }
+  bool CanPlace(const Position &p, int size, Tower::Type type, float range,
+                bool upgraded) const;
+  bool OccupiesPath(const Position &p, int size) const;
+  bool OverlapsTower(const Position &p, int size) const;
+  std::optional<size_t> TowerIndexAt(const Position &p) const;
+  float Dt() const { return kTickSeconds; }
+  // Fixed ticks the front end runs per real-time tick period.
+  int StepsPerPeriod() const { return fast_forward_ ? kFastForwardSteps : 1; }
+
+private:
+  // What one ready tower does this tick, worked out by PlanTower() from the
+  // world as it stood before any tower fired.
+  struct TowerPlan {
+    bool fires = false;
+    size_t target = 0;
+    std::vector<size_t> picks;    // shot targets, in firing order
+    std::vector<size_t> hits;     // enemies hit, ascending per shot
+    std::vector<size_t> hit_ends; // thunder: end of each pick's hits
+    bool hits_ready = true;       // galactic: false until the cone is cached
+    std::vector<size_t> scratch;
+    std::vector<uint32_t> ranks; // ProgressOrder ranks of candidates
+  };
+
+  // Replaces out with the tower cells, leaving out the skipped towers.
+  void TowerOccupancyMaskSkipping(const std::vector<size_t> &skip_indices,
+                                  BoardBitset &out) const;
+  void KittyAttackArea(const Vec2 &center, const Position &target_cell,
+                       std::vector<Position> &out) const;
+  bool KittyAreaHitsEnemy(const std::vector<Position> &cells) const;
+  bool KittyCellBlocked(
+      const Position &p, const BoardBitset &static_blocked,
+      const BoardBitset &reserved,
+      const std::optional<Position> &ignore_reserved = std::nullopt) const;
+  bool CanKittyOccupyCell(size_t kitty_index, const Position &p) const;
+  void MoveTower(size_t index, const Position &to);
+  std::optional<Position> ChooseKittyLanding(size_t tower_index,
+                                             const BoardBitset &static_blocked,
+                                             BoardBitset &reserved);
+  void ReturnKittiesHome();
+  void BuildPath();
+  // Fills path with map's center path and mask with every cell it covers,
+  // lanes included.
+  static void TracePath(const MapDef &map, std::vector<Position> &path,
+                        BoardBitset &mask);
+  const EnemyGrid &Grid() const;
+  // Built alongside Grid(), so it is as current as the enemy cells.
+  const ProgressOrder &Order() const {
+    Grid();
+    return progress_order_;
+  }
+  void CollectInRange(const Vec2 &center, float radius,
+                      std::vector<size_t> &out) const;
+  void EnemiesInRange(const Vec2 &center, float radius,
+                      std::vector<size_t> &out) const;
+  void EnemiesNearLine(const Vec2 &origin, const Vec2 &dir, float half_width,
+                       std::vector<size_t> &out) const;
+  std::optional<size_t> FindTargetAt(const Tower &t, const Vec2 &center) const;
+  std::optional<size_t> FindTargetAt(const Tower &t, const Vec2 &center,
+                                     std::vector<size_t> &scratch) const;
+  std::optional<size_t> FindTarget(const Tower &t) const;
+  Position NearestOpenCell(const Position &desired, const BoardBitset &blocked,
+                           BoardBitset &reserved, const Position &fallback);
+  EnemyType SelectEnemyType(int diff);
+  void ApplyEnemyStats(Enemy &e, int diff);
+  // Table lookup for lanes on the current map; other offsets (synthetic
+  // enemies) fall back to ComputePathCell.
+  Position PathCell(float path_progress, int lane_offset) const;
+  Position ComputePathCell(size_t i, int lane_offset) const;
+  void RefreshEnemyCell(size_t i);
+  void RefreshEnemyCells();
+  bool CatatonicConflict(const Position &p, int size, Tower::Type type,
+                         float range, bool upgraded) const;
+  // Reads the world only; safe to run for several towers at once.
+  void PlanTower(const Tower &t, TowerPlan &plan) const;
+  // True if an enemy t's plan could have seen was killed or moved since.
+  bool PlanIsStale(const Tower &t) const;
+  void ApplyPlan(Tower &t, TowerPlan &plan);
+  void LaserHits(const Tower &t, size_t target, std::vector<size_t> &scratch,
+                 std::vector<size_t> &out) const;
+  void FireLaser(const Tower &t, size_t target, std::span<const size_t> hits);
+  void ThunderTargets(const Tower &t, std::vector<size_t> &alive,
+                      std::vector<size_t> &picks) const;
+  void FireShockwave(const Tower &t, std::span<const size_t> hits);
+  void FireKitty(const Tower &t, size_t target);
+  void FireCatatonic(const Tower &t, std::span<const size_t> hits);
+  const ConeStencil &GalacticCone(const Tower &t, size_t target);
+  void GalacticHits(const Tower &t, const ConeStencil &cone,
+                    std::vector<size_t> &out) const;
+  void ApplyGalactic(const Tower &t, const ConeStencil &cone,
+                     std::span<const size_t> hits);
+  void DamageEnemy(size_t i, int damage, const Position &splat,
+                   float splat_time);
+  void NoteEnemyChanged(size_t i);
+  float Rand(float min, float max);
+  int Bounty(EnemyType type) const;
+  float NextCooldown(float base_rate);
+  int DifficultyLevel() const;
+  // Endless levels reached: tens of waves past the last map's, or 0.
+  int EndlessLevel() const;
+  void SpawnEnemy(float progress);
+  const MapDef &CurrentMap() const {
+    return maps_[static_cast<size_t>(map_index_)];
+  }
+  void Unlock(Tower::Type type);
+  void Sfx(SfxEvent event);
+  void PlayDeathSfx(EnemyType type);
+  void SetMusic(int map_idx);
+
+  std::vector<Position> path_;
+  BoardBitset path_mask_;
+  // PathCell() per path index and lane offset, built by BuildPath().
+  std::vector<Position> path_cells_;
+  int path_lane_span_ = 0;
+  EnemyStore enemies_;
+  std::vector<Tower> towers_;
+  TowerOccupancy tower_cells_; // owner of every cell towers_ cover
+  EffectPool<HitSplat> hit_splats_{kMaxHitSplats};
+  EffectPool<Projectile> projectiles_;
+  EffectPool<Shockwave> shockwaves_;
+  EffectPool<Beam> beams_;
+  EffectPool<AreaHighlight> area_highlights_;
+  std::optional<HeldTower> held_tower_;
+  const Definitions *defs_;
+  std::vector<MapDef> maps_; // defs_->maps()
+
+  // Enemies bucketed by cell; rebuilt after MoveEnemies, or on the next
+  // query when anything else adds, removes or teleports an enemy.
+  mutable EnemyGrid enemy_grid_;
+  mutable ProgressOrder progress_order_;
+  mutable bool enemy_grid_dirty_ = true;
+
+  // Scratch buffers reused across ticks so tower attacks don't allocate.
+  mutable std::vector<size_t> target_scratch_; // FindTargetAt candidates
+  std::vector<size_t> hit_scratch_;            // enemies an attack hits
+  std::vector<Position> kitty_area_scratch_;
+  std::vector<size_t> ready_kitties_;
+  std::vector<size_t> jumping_kitties_;
+  std::vector<size_t> kitty_jump_order_;
+  std::vector<Position> landing_candidates_;
+  BoardBitset kitty_blocked_;  // other towers, while kitties move
+  BoardBitset kitty_reserved_; // cells kitties have claimed this tick
+  std::vector<std::optional<Position>> planned_landings_; // by tower index
+  ConeStencils cone_stencils_; // galactic cones by tower shape and target
+
+  // Two-phase tower firing (see TowersAct).
+  WorkerPool *worker_pool_ = nullptr;
+  TickProfiler *profiler_ = nullptr;
+  std::vector<size_t> ready_towers_;
+  std::vector<TowerPlan> tower_plans_; // by position in ready_towers_
+  // Cells of enemies killed or teleported since this tick's plans were made.
+  BoardBitset changed_cells_;
+  bool enemies_changed_ = false;
+
+  Rng rng_;
+  SfxHandler sfx_handler_;
+  MusicHandler music_handler_;
+
+  bool unlocked_thunder_ = false;
+  bool unlocked_fat_ = false;
+  bool unlocked_kitty_ = false;
+  bool unlocked_catatonic_ = false;
+  bool unlocked_galactic_ = false;
+  bool auto_waves_ = false;
+  bool fast_forward_ = false;
+  bool dev_mode_ = false;
+  DifficultyCurve difficulty_;
+  WaveRules wave_rules_;
+  bool victory_ = false;
+  int map_index_ = 0;
+  int kibbles_ = 0;
+  int lives_ = 0;
+  int lives_lost_ = 0;
+  int wave_ = 0;
+  bool wave_active_ = false;
+  bool game_over_ = false;
+  int spawn_remaining_ = 0;
+  int spawn_cooldown_ms_ = 0;
+};
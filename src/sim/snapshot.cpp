@@ -0,0 +1,527 @@
+#include "sim/snapshot.h"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CATCAT_HAVE_MMAP 1
+#endif
+
+#include "sim/simulation.h"
+
+static_assert(std::endian::native == std::endian::little,
+              "snapshots are stored little-endian and copied as is");
+static_assert(sizeof(SnapshotHeader) == 352, "header layout changed");
+static_assert(sizeof(SnapshotTower) == 44 && sizeof(SnapshotCells) == 16);
+// Records stored as the simulation's own structs.
+static_assert(std::is_trivially_copyable_v<Projectile> &&
+              sizeof(Projectile) == 24);
+static_assert(std::is_trivially_copyable_v<HitSplat> && sizeof(HitSplat) == 12);
+static_assert(std::is_trivially_copyable_v<Shockwave> &&
+              sizeof(Shockwave) == 28);
+static_assert(sizeof(Position) == 8 && sizeof(EnemyType) == 4);
+
+namespace {
+
+// SnapshotHeader::flags bits.
+enum SnapshotFlag : uint32_t {
+  kUnlockedFat = 1U << 0U,
+  kUnlockedKitty = 1U << 1U,
+  kUnlockedThunder = 1U << 2U,
+  kUnlockedCatatonic = 1U << 3U,
+  kUnlockedGalactic = 1U << 4U,
+  kAutoWaves = 1U << 5U,
+  kFastForward = 1U << 6U,
+  kDevMode = 1U << 7U,
+  kWaveActive = 1U << 8U,
+  kGameOver = 1U << 9U,
+  kVictory = 1U << 10U,
+  kHasHeld = 1U << 11U,
+};
+
+constexpr int kAreaKindCount = 4;
+
+uint64_t Align8(uint64_t n) { return (n + 7U) & ~uint64_t{7U}; }
+
+// The element size of each section, indexed by SnapshotSection.
+constexpr std::array<size_t, static_cast<size_t>(SnapshotSection::Count)>
+    kRecordSize = {sizeof(SnapshotTower), sizeof(float), sizeof(float),
+                   sizeof(int),           sizeof(int),   sizeof(int),
+                   sizeof(EnemyType),     sizeof(float), sizeof(Projectile),
+                   sizeof(HitSplat),      sizeof(Shockwave),
+                   sizeof(SnapshotCells), sizeof(SnapshotCells),
+                   sizeof(Position)};
+
+SnapshotTower ToRecord(const Tower &t) {
+  return {t.pos.x,
+          t.pos.y,
+          t.home.x,
+          t.home.y,
+          t.damage,
+          t.range,
+          t.cooldown,
+          t.fire_rate,
+          static_cast<int32_t>(t.type),
+          t.size,
+          t.upgraded ? 1 : 0};
+}
+
+bool ValidTower(const SnapshotTower &r, const BoardSize &board) {
+  return r.type >= 0 && r.type < kTowerTypeCount && r.size >= 1 &&
+         r.size <= 2 && r.pos_x >= 0 && r.pos_y >= 0 &&
+         r.pos_x + r.size <= board.width && r.pos_y + r.size <= board.height;
+}
+
+Tower FromRecord(const SnapshotTower &r) {
+  Tower t;
+  t.pos = {r.pos_x, r.pos_y};
+  t.home = {r.home_x, r.home_y};
+  t.damage = r.damage;
+  t.range = r.range;
+  t.cooldown = r.cooldown;
+  t.fire_rate = r.fire_rate;
+  t.type = static_cast<Tower::Type>(r.type);
+  t.size = r.size;
+  t.upgraded = r.upgraded != 0;
+  return t;
+}
+
+// Lays sections out back to back after the header and copies them in.
+class Writer {
+public:
+  Writer() : header_{} {
+    header_.magic = kSnapshotMagic;
+    header_.version = kSnapshotVersion;
+    header_.header_size = sizeof(SnapshotHeader);
+  }
+
+  SnapshotHeader &header() { return header_; }
+
+  template <typename T>
+  void Add(SnapshotSection section, const T *data, size_t count) {
+    chunks_.push_back({section, data, count * sizeof(T), count});
+  }
+  template <typename T>
+  void Add(SnapshotSection section, const std::vector<T> &v) {
+    Add(section, v.data(), v.size());
+  }
+
+  std::vector<std::byte> Finish() {
+    uint64_t offset = Align8(sizeof(SnapshotHeader));
+    for (const auto &c : chunks_) {
+      auto &range = header_.sections[static_cast<size_t>(c.section)];
+      range.offset = offset;
+      range.count = c.count;
+      offset = Align8(offset + c.bytes);
+    }
+    std::vector<std::byte> out(offset);
+    std::memcpy(out.data(), &header_, sizeof(header_));
+    for (const auto &c : chunks_) {
+      if (c.bytes != 0) {
+        const auto &range = header_.sections[static_cast<size_t>(c.section)];
+        std::memcpy(out.data() + range.offset, c.data, c.bytes);
+      }
+    }
+    return out;
+  }
+
+private:
+  struct Chunk {
+    SnapshotSection section;
+    const void *data;
+    size_t bytes;
+    size_t count;
+  };
+
+  SnapshotHeader header_;
+  std::vector<Chunk> chunks_;
+};
+
+const SnapshotHeader &HeaderOf(std::span<const std::byte> data) {
+  return *reinterpret_cast<const SnapshotHeader *>(data.data());
+}
+
+const SnapshotRange &RangeOf(std::span<const std::byte> data,
+                             SnapshotSection section) {
+  return HeaderOf(data).sections[static_cast<size_t>(section)];
+}
+
+// Copies one section into a vector of its records.
+template <typename T>
+void ReadSection(std::span<const std::byte> data, SnapshotSection section,
+                 std::vector<T> &out) {
+  const auto &range = RangeOf(data, section);
+  out.resize(static_cast<size_t>(range.count));
+  if (!out.empty()) {
+    std::memcpy(out.data(), data.data() + range.offset,
+                out.size() * sizeof(T));
+  }
+}
+
+template <typename T>
+std::span<const T> SectionView(std::span<const std::byte> data,
+                               SnapshotSection section) {
+  const auto &range = RangeOf(data, section);
+  return {reinterpret_cast<const T *>(data.data() + range.offset),
+          static_cast<size_t>(range.count)};
+}
+
+} // namespace
+
+bool SnapshotValid(std::span<const std::byte> data) {
+  if (data.size() < sizeof(SnapshotHeader) ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(SnapshotHeader) != 0) {
+    return false;
+  }
+  const SnapshotHeader &h = HeaderOf(data);
+  if (h.magic != kSnapshotMagic || h.version != kSnapshotVersion ||
+      h.header_size != sizeof(SnapshotHeader)) {
+    return false;
+  }
+  for (size_t s = 0; s < h.sections.size(); ++s) {
+    const auto &range = h.sections[s];
+    if (range.count == 0) {
+      continue;
+    }
+    if (range.offset % 8 != 0 || range.offset > data.size() ||
+        range.count > (data.size() - range.offset) / kRecordSize[s]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<std::byte> Simulation::SaveSnapshot() const {
+  Writer w;
+  SnapshotHeader &h = w.header();
+  h.rng_state = rng_.state;
+  h.rng_inc = rng_.inc;
+  h.map_index = map_index_;
+  h.wave = wave_;
+  h.kibbles = kibbles_;
+  h.lives = lives_;
+  h.lives_lost = lives_lost_;
+  h.spawn_remaining = spawn_remaining_;
+  h.spawn_cooldown_ms = spawn_cooldown_ms_;
+  h.difficulty_offset = difficulty_.offset;
+  h.difficulty_per_map = difficulty_.per_map;
+  const std::pair<bool, uint32_t> flags[] = {
+      {unlocked_fat_, kUnlockedFat},
+      {unlocked_kitty_, kUnlockedKitty},
+      {unlocked_thunder_, kUnlockedThunder},
+      {unlocked_catatonic_, kUnlockedCatatonic},
+      {unlocked_galactic_, kUnlockedGalactic},
+      {auto_waves_, kAutoWaves},
+      {fast_forward_, kFastForward},
+      {dev_mode_, kDevMode},
+      {wave_active_, kWaveActive},
+      {game_over_, kGameOver},
+      {victory_, kVictory},
+      {held_tower_.has_value(), kHasHeld},
+  };
+  for (const auto &[set, bit] : flags) {
+    h.flags |= set ? bit : 0U;
+  }
+  if (held_tower_) {
+    h.held = ToRecord(held_tower_->tower);
+    h.held_original_x = held_tower_->original.x;
+    h.held_original_y = held_tower_->original.y;
+  }
+
+  std::vector<SnapshotTower> towers;
+  towers.reserve(towers_.size());
+  for (const auto &t : towers_) {
+    towers.push_back(ToRecord(t));
+  }
+  w.Add(SnapshotSection::Towers, towers);
+  w.Add(SnapshotSection::EnemyProgress, enemies_.path_progress);
+  w.Add(SnapshotSection::EnemySpeed, enemies_.speed);
+  w.Add(SnapshotSection::EnemyHp, enemies_.hp);
+  w.Add(SnapshotSection::EnemyMaxHp, enemies_.max_hp);
+  w.Add(SnapshotSection::EnemyLane, enemies_.lane_offset);
+  w.Add(SnapshotSection::EnemyType, enemies_.type);
+  w.Add(SnapshotSection::EnemySleep, enemies_.sleep_timer);
+  // Pools may wrap around their slots, so entries are copied out oldest
+  // first.
+  const std::vector<Projectile> projectiles(projectiles_.begin(),
+                                            projectiles_.end());
+  const std::vector<HitSplat> hit_splats(hit_splats_.begin(),
+                                         hit_splats_.end());
+  const std::vector<Shockwave> shockwaves(shockwaves_.begin(),
+                                          shockwaves_.end());
+  w.Add(SnapshotSection::Projectiles, projectiles);
+  w.Add(SnapshotSection::HitSplats, hit_splats);
+  w.Add(SnapshotSection::Shockwaves, shockwaves);
+
+  std::vector<SnapshotCells> beams;
+  std::vector<SnapshotCells> areas;
+  std::vector<Position> cells;
+  const auto add_cells = [&](std::span<const Position> from) {
+    const auto first = static_cast<uint32_t>(cells.size());
+    cells.insert(cells.end(), from.begin(), from.end());
+    return std::pair{first, static_cast<uint32_t>(from.size())};
+  };
+  for (const auto &b : beams_) {
+    const std::array<Position, 2> ends{b.from, b.to};
+    const auto [first, count] = add_cells(ends);
+    beams.push_back({first, count, b.time_left, 0});
+  }
+  for (const auto &a : area_highlights_) {
+    const auto [first, count] = add_cells(a.cells);
+    areas.push_back({first, count, a.time_left, static_cast<int32_t>(a.kind)});
+  }
+  w.Add(SnapshotSection::Beams, beams);
+  w.Add(SnapshotSection::Areas, areas);
+  w.Add(SnapshotSection::Cells, cells);
+  return w.Finish();
+}
+
+bool Simulation::RestoreSnapshot(std::span<const std::byte> data) {
+  if (!SnapshotValid(data)) {
+    return false;
+  }
+  const SnapshotHeader &h = HeaderOf(data);
+
+  // Check everything that could leave the world inconsistent before
+  // touching it.
+  if (h.map_index < 0 || h.map_index >= map_count()) {
+    return false;
+  }
+  const MapDef &map = maps_[static_cast<size_t>(h.map_index)];
+  const BoardSize &board = map.board;
+  // Towers keep off the path and each other, so every cell has at most one
+  // owner; start from the path and claim each footprint in turn.
+  std::vector<Position> path;
+  BoardBitset claimed;
+  TracePath(map, path, claimed);
+  const auto towers = SectionView<SnapshotTower>(data, SnapshotSection::Towers);
+  for (const auto &r : towers) {
+    if (!ValidTower(r, board)) {
+      return false;
+    }
+    const int x1 = r.pos_x + r.size - 1;
+    const int y1 = r.pos_y + r.size - 1;
+    if (claimed.AnyInRect(r.pos_x, r.pos_y, x1, y1)) {
+      return false;
+    }
+    claimed.SetRect(r.pos_x, r.pos_y, x1, y1);
+  }
+  if ((h.flags & kHasHeld) != 0 && !ValidTower(h.held, board)) {
+    return false;
+  }
+  const auto enemy_count = RangeOf(data, SnapshotSection::EnemyHp).count;
+  for (auto s : {SnapshotSection::EnemyProgress, SnapshotSection::EnemySpeed,
+                 SnapshotSection::EnemyMaxHp, SnapshotSection::EnemyLane,
+                 SnapshotSection::EnemyType, SnapshotSection::EnemySleep}) {
+    if (RangeOf(data, s).count != enemy_count) {
+      return false;
+    }
+  }
+  for (const auto type :
+       SectionView<int32_t>(data, SnapshotSection::EnemyType)) {
+    if (type < 0 || type >= kEnemyTypeCount) {
+      return false;
+    }
+  }
+  const auto cell_count = RangeOf(data, SnapshotSection::Cells).count;
+  for (auto s : {SnapshotSection::Beams, SnapshotSection::Areas}) {
+    for (const auto &c : SectionView<SnapshotCells>(data, s)) {
+      if (uint64_t{c.first} + c.count > cell_count || c.kind < 0 ||
+          c.kind >= kAreaKindCount) {
+        return false;
+      }
+    }
+  }
+
+  rng_.state = h.rng_state;
+  rng_.inc = h.rng_inc;
+  map_index_ = h.map_index;
+  wave_ = h.wave;
+  kibbles_ = h.kibbles;
+  lives_ = h.lives;
+  lives_lost_ = h.lives_lost;
+  spawn_remaining_ = h.spawn_remaining;
+  spawn_cooldown_ms_ = h.spawn_cooldown_ms;
+  difficulty_.offset = h.difficulty_offset;
+  difficulty_.per_map = h.difficulty_per_map;
+  unlocked_fat_ = (h.flags & kUnlockedFat) != 0;
+  unlocked_kitty_ = (h.flags & kUnlockedKitty) != 0;
+  unlocked_thunder_ = (h.flags & kUnlockedThunder) != 0;
+  unlocked_catatonic_ = (h.flags & kUnlockedCatatonic) != 0;
+  unlocked_galactic_ = (h.flags & kUnlockedGalactic) != 0;
+  auto_waves_ = (h.flags & kAutoWaves) != 0;
+  fast_forward_ = (h.flags & kFastForward) != 0;
+  dev_mode_ = (h.flags & kDevMode) != 0;
+  wave_active_ = (h.flags & kWaveActive) != 0;
+  game_over_ = (h.flags & kGameOver) != 0;
+  victory_ = (h.flags & kVictory) != 0;
+  held_tower_.reset();
+  if ((h.flags & kHasHeld) != 0) {
+    held_tower_ =
+        HeldTower{FromRecord(h.held), {h.held_original_x, h.held_original_y}};
+  }
+
+  towers_.clear();
+  tower_cells_.Clear(board);
+  for (const auto &r : towers) {
+    AddTower(FromRecord(r));
+  }
+
+  ReadSection(data, SnapshotSection::EnemyProgress, enemies_.path_progress);
+  ReadSection(data, SnapshotSection::EnemySpeed, enemies_.speed);
+  ReadSection(data, SnapshotSection::EnemyHp, enemies_.hp);
+  ReadSection(data, SnapshotSection::EnemyMaxHp, enemies_.max_hp);
+  ReadSection(data, SnapshotSection::EnemyLane, enemies_.lane_offset);
+  ReadSection(data, SnapshotSection::EnemyType, enemies_.type);
+  ReadSection(data, SnapshotSection::EnemySleep, enemies_.sleep_timer);
+  enemies_.x.resize(enemies_.size());
+  enemies_.y.resize(enemies_.size());
+  progress_order_.Clear();
+
+  projectiles_.Clear();
+  for (const auto &p :
+       SectionView<Projectile>(data, SnapshotSection::Projectiles)) {
+    projectiles_.Push(p);
+  }
+  hit_splats_.Clear();
+  for (const auto &s :
+       SectionView<HitSplat>(data, SnapshotSection::HitSplats)) {
+    hit_splats_.Push(s);
+  }
+  shockwaves_.Clear();
+  for (const auto &s :
+       SectionView<Shockwave>(data, SnapshotSection::Shockwaves)) {
+    shockwaves_.Push(s);
+  }
+  const auto cells = SectionView<Position>(data, SnapshotSection::Cells);
+  const auto cells_of = [&](const SnapshotCells &c) {
+    return cells.subspan(c.first, c.count);
+  };
+  beams_.Clear();
+  for (const auto &c :
+       SectionView<SnapshotCells>(data, SnapshotSection::Beams)) {
+    const auto from = cells_of(c);
+    if (from.empty()) {
+      continue;
+    }
+    Beam b;
+    b.from = from.front();
+    b.to = from.back();
+    b.time_left = c.time_left;
+    beams_.Push(b);
+  }
+  area_highlights_.Clear();
+  for (const auto &c :
+       SectionView<SnapshotCells>(data, SnapshotSection::Areas)) {
+    AreaHighlight &a = area_highlights_.Acquire();
+    const auto from = cells_of(c);
+    a.cells.assign(from.begin(), from.end());
+    a.time_left = c.time_left;
+    a.kind = static_cast<AreaHighlight::Kind>(c.kind);
+  }
+
+  BuildPath();
+  RefreshEnemyCells();
+  SetMusic(map_index_);
+  return true;
+}
+
+std::optional<SnapshotFile> SnapshotFile::Open(const std::string &path) {
+  SnapshotFile file;
+#ifdef CATCAT_HAVE_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  struct stat st {};
+  if (fd >= 0 && ::fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      file.data_ = static_cast<const std::byte *>(p);
+      file.size_ = static_cast<size_t>(st.st_size);
+      file.mapped_ = true;
+    }
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+#endif
+  if (!file.mapped_) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      std::cerr << "catcat: cannot open snapshot " << path << "\n";
+      return std::nullopt;
+    }
+    const std::string bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    file.buffer_.resize(bytes.size());
+    std::memcpy(file.buffer_.data(), bytes.data(), bytes.size());
+    file.data_ = file.buffer_.data();
+    file.size_ = file.buffer_.size();
+  }
+  if (!SnapshotValid(file.bytes())) {
+    std::cerr << "catcat: " << path
+              << ": not a snapshot, or from another version\n";
+    return std::nullopt;
+  }
+  return file;
+}
+
+SnapshotFile::SnapshotFile(SnapshotFile &&other) noexcept {
+  *this = std::move(other);
+}
+
+SnapshotFile &SnapshotFile::operator=(SnapshotFile &&other) noexcept {
+  if (this != &other) {
+    Unmap();
+    mapped_ = std::exchange(other.mapped_, false);
+    size_ = std::exchange(other.size_, 0);
+    buffer_ = std::move(other.buffer_);
+    data_ = mapped_ ? other.data_ : buffer_.data();
+    other.data_ = nullptr;
+  }
+  return *this;
+}
+
+SnapshotFile::~SnapshotFile() { Unmap(); }
+
+void SnapshotFile::Unmap() {
+#ifdef CATCAT_HAVE_MMAP
+  if (mapped_) {
+    ::munmap(const_cast<std::byte *>(data_), size_);
+    mapped_ = false;
+  }
+#endif
+}
+
+bool WriteSnapshotFile(const Simulation &sim, const std::string &path) {
+  const auto bytes = sim.SaveSnapshot();
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
+  if (!out) {
+    std::cerr << "catcat: cannot write snapshot " << path << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool LoadSnapshotFile(Simulation &sim, const std::string &path) {
+  const auto file = SnapshotFile::Open(path);
+  if (!file.has_value()) {
+    return false;
+  }
+  if (!sim.RestoreSnapshot(file->bytes())) {
+    std::cerr << "catcat: " << path << ": snapshot does not fit this game\n";
+    return false;
+  }
+  return true;
+}
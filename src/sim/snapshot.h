@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+class Simulation;
+
+// Save-state format. A snapshot is one SnapshotHeader followed by arrays of
+// fixed-size records, each starting on an 8-byte boundary; the header gives
+// every array's byte offset and length. All fields are fixed-width and
+// little-endian, so a mapped file is used in place: restoring checks the
+// bounds and copies each array straight into the simulation's containers.
+// Bump kSnapshotVersion whenever a record or the header changes.
+constexpr std::array<char, 8> kSnapshotMagic = {'C', 'C', 'S', 'N',
+                                                'A', 'P', '\0', '\0'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+enum class SnapshotSection : uint32_t {
+  Towers,        // SnapshotTower
+  EnemyProgress, // EnemyStore columns, one array each
+  EnemySpeed,
+  EnemyHp,
+  EnemyMaxHp,
+  EnemyLane,
+  EnemyType,
+  EnemySleep,
+  Projectiles, // Projectile
+  HitSplats,   // HitSplat
+  Shockwaves,  // Shockwave
+  Beams,       // SnapshotCells
+  Areas,       // SnapshotCells
+  Cells,       // Position, shared by Beams and Areas
+  Count,
+};
+
+struct SnapshotRange {
+  uint64_t offset = 0; // bytes from the start of the snapshot
+  uint64_t count = 0;  // records
+};
+
+struct SnapshotTower {
+  int32_t pos_x, pos_y, home_x, home_y;
+  int32_t damage;
+  float range, cooldown, fire_rate;
+  int32_t type, size, upgraded;
+};
+
+// A beam or area highlight; its cells are Cells[first, first + count). A
+// beam's are its two ends.
+struct SnapshotCells {
+  uint32_t first, count;
+  float time_left;
+  int32_t kind; // AreaHighlight::Kind; 0 for beams
+};
+
+struct SnapshotHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t header_size; // sizeof(SnapshotHeader) when written
+  uint64_t rng_state, rng_inc;
+  int32_t map_index, wave, kibbles, lives, lives_lost;
+  int32_t spawn_remaining, spawn_cooldown_ms;
+  int32_t difficulty_offset, difficulty_per_map;
+  uint32_t flags; // SnapshotFlag bits
+  SnapshotTower held;
+  int32_t held_original_x, held_original_y;
+  int32_t reserved; // zero; keeps sections 8-byte aligned without padding
+  std::array<SnapshotRange, static_cast<size_t>(SnapshotSection::Count)>
+      sections;
+};
+
+// A snapshot file mapped read-only (read into memory where mapping is not
+// available). Movable, not copyable.
+class SnapshotFile {
+public:
+  // Prints the problem and returns std::nullopt if the file cannot be read
+  // or is not a snapshot this build understands.
+  static std::optional<SnapshotFile> Open(const std::string &path);
+
+  SnapshotFile(SnapshotFile &&other) noexcept;
+  SnapshotFile &operator=(SnapshotFile &&other) noexcept;
+  SnapshotFile(const SnapshotFile &) = delete;
+  SnapshotFile &operator=(const SnapshotFile &) = delete;
+  ~SnapshotFile();
+
+  std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+private:
+  SnapshotFile() = default;
+  void Unmap();
+
+  const std::byte *data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::vector<std::byte> buffer_; // when not mapped
+};
+
+// True if data holds a well-formed snapshot of this version: the header
+// matches and every array lies inside data.
+bool SnapshotValid(std::span<const std::byte> data);
+
+// Writes sim's snapshot to path. Prints the problem and returns false if
+// the file cannot be written.
+bool WriteSnapshotFile(const Simulation &sim, const std::string &path);
+// Opens path and restores it into sim. Prints the problem and returns false
+// if it cannot be loaded; sim is unchanged then.
+bool LoadSnapshotFile(Simulation &sim, const std::string &path);
@@ -0,0 +1,119 @@
+#include "sim/tick_profiler.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <ostream>
+
+const char *TickProfiler::Name(Phase phase) {
+  switch (phase) {
+  case Phase::Tick:
+    return "Tick";
+  case Phase::SpawnTick:
+    return "SpawnTick";
+  case Phase::MoveEnemies:
+    return "MoveEnemies";
+  case Phase::TowersAct:
+    return "TowersAct";
+  case Phase::MoveProjectiles:
+    return "MoveProjectiles";
+  case Phase::ResolveProjectiles:
+    return "ResolveProjectiles";
+  case Phase::UpdateShockwaves:
+    return "UpdateShockwaves";
+  case Phase::UpdateBeams:
+    return "UpdateBeams";
+  case Phase::UpdateAreas:
+    return "UpdateAreas";
+  case Phase::Cleanup:
+    return "Cleanup";
+  case Phase::UpdateHitSplats:
+    return "UpdateHitSplats";
+  case Phase::CheckWaveCompletion:
+    return "CheckWaveCompletion";
+  case Phase::Render:
+    return "Render";
+  case Phase::Count:
+    break;
+  }
+  return "?";
+}
+
+void TickProfiler::Record(Phase phase, Clock::time_point start,
+                          Clock::time_point end) {
+  const auto ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count();
+  Window &w = windows_[static_cast<size_t>(phase)];
+  w.ns[w.next] = static_cast<uint32_t>(
+      std::clamp<int64_t>(ns, 0, std::numeric_limits<uint32_t>::max()));
+  w.next = (w.next + 1) % kWindow;
+  w.count = std::min(w.count + 1, kWindow);
+
+  if (tracing_ && start >= origin_) {
+    const auto since =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_)
+            .count();
+    trace_.push_back({phase, since, ns});
+    tracing_ = trace_.size() < trace_limit_;
+  }
+}
+
+TickProfiler::Stats TickProfiler::PhaseStats(Phase phase) const {
+  const Window &w = windows_[static_cast<size_t>(phase)];
+  Stats stats;
+  stats.samples = w.count;
+  if (w.count == 0) {
+    return stats;
+  }
+  std::array<uint32_t, kWindow> sorted = w.ns;
+  const auto end = sorted.begin() + static_cast<std::ptrdiff_t>(w.count);
+  std::sort(sorted.begin(), end);
+  const auto at = [&](size_t pct) {
+    return static_cast<double>(sorted[(w.count - 1) * pct / 100]) / 1000.0;
+  };
+  stats.p50_us = at(50);
+  stats.p99_us = at(99);
+  return stats;
+}
+
+void TickProfiler::StartTrace(size_t max_events) {
+  trace_.clear();
+  trace_.reserve(std::min<size_t>(max_events, size_t{1} << 16U));
+  trace_limit_ = max_events;
+  tracing_ = max_events > 0;
+  origin_ = Clock::now();
+}
+
+void TickProfiler::WriteTrace(std::ostream &out) const {
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  char buf[160];
+  for (size_t i = 0; i < trace_.size(); ++i) {
+    const TraceEvent &e = trace_[i];
+    // Complete events in microseconds with nanosecond fractions; phases
+    // nest inside their Tick by time, so the viewer stacks them.
+    std::snprintf(buf, sizeof(buf),
+                  "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                  "\"ts\":%" PRId64 ".%03" PRId64 ",\"dur\":%" PRId64
+                  ".%03" PRId64 ",\"pid\":1,\"tid\":1}",
+                  i == 0 ? "" : ",\n", Name(e.phase),
+                  e.phase == Phase::Render ? "frame" : "tick",
+                  e.start_ns / 1000, e.start_ns % 1000, e.dur_ns / 1000,
+                  e.dur_ns % 1000);
+    out << buf;
+  }
+  out << "]}\n";
+}
+
+bool TickProfiler::WriteTraceFile(const std::string &path) const {
+  std::ofstream out(path);
+  WriteTrace(out);
+  if (!out) {
+    std::cerr << "catcat: cannot write trace " << path << "\n";
+    return false;
+  }
+  return true;
+}
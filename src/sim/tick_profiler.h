@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Wall-clock cost of each tick phase and of building a frame. The last
+// kWindow samples of every phase are kept for rolling percentiles (the dev
+// overlay), and while a trace is running every sample is also logged as a
+// Chrome trace event so frame spikes can be inspected offline. Not thread
+// safe: phases are recorded from the thread that ticks and renders.
+class TickProfiler {
+public:
+  enum class Phase : uint8_t {
+    Tick, // the whole of Simulation::Tick()
+    SpawnTick,
+    MoveEnemies,
+    TowersAct,
+    MoveProjectiles,
+    ResolveProjectiles,
+    UpdateShockwaves,
+    UpdateBeams,
+    UpdateAreas,
+    Cleanup,
+    UpdateHitSplats,
+    CheckWaveCompletion,
+    Render, // Game::Render(), building the frame's element tree
+    Count,
+  };
+  static constexpr size_t kPhaseCount = static_cast<size_t>(Phase::Count);
+  static constexpr size_t kWindow = 240; // ~4 s of ticks at 60 Hz
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    double p50_us = 0.0;
+    double p99_us = 0.0;
+    size_t samples = 0; // in the window
+  };
+
+  static const char *Name(Phase phase);
+
+  void Record(Phase phase, Clock::time_point start, Clock::time_point end);
+  Stats PhaseStats(Phase phase) const;
+
+  // Starts logging trace events, dropping any logged before. Logging stops
+  // by itself after max_events so a long session cannot grow without bound.
+  void StartTrace(size_t max_events = size_t{1} << 20U);
+  bool tracing() const { return tracing_; }
+  size_t trace_size() const { return trace_.size(); }
+  // Writes the logged events as Chrome trace JSON, which chrome://tracing
+  // and ui.perfetto.dev open directly.
+  void WriteTrace(std::ostream &out) const;
+  // As above, to a file. Prints the problem and returns false on failure.
+  bool WriteTraceFile(const std::string &path) const;
+
+private:
+  struct Window {
+    std::array<uint32_t, kWindow> ns{}; // ring of sample durations
+    size_t next = 0;
+    size_t count = 0;
+  };
+  struct TraceEvent {
+    Phase phase;
+    int64_t start_ns; // since origin_
+    int64_t dur_ns;
+  };
+
+  std::array<Window, kPhaseCount> windows_{};
+  std::vector<TraceEvent> trace_;
+  size_t trace_limit_ = 0;
+  bool tracing_ = false;
+  Clock::time_point origin_ = Clock::now();
+};
+
+// Times the enclosing scope as one phase; does nothing without a profiler.
+class ScopedPhase {
+public:
+  ScopedPhase(TickProfiler *profiler, TickProfiler::Phase phase)
+      : profiler_(profiler), phase_(phase) {
+    if (profiler_ != nullptr) {
+      start_ = TickProfiler::Clock::now();
+    }
+  }
+  ~ScopedPhase() {
+    if (profiler_ != nullptr) {
+      profiler_->Record(phase_, start_, TickProfiler::Clock::now());
+    }
+  }
+  ScopedPhase(const ScopedPhase &) = delete;
+  ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+private:
+  TickProfiler *profiler_;
+  TickProfiler::Phase phase_;
+  TickProfiler::Clock::time_point start_{};
+};
@@ -0,0 +1,56 @@
+#include "sim/tower_occupancy.h"
+
+#include <algorithm>
+
+namespace {
+
+// Calls fn(x, y) for every on-board cell of the footprint.
+template <typename Fn>
+void ForFootprint(const BoardSize &board, const Position &pos, int size,
+                  Fn fn) {
+  const int x0 = std::max(0, pos.x);
+  const int y0 = std::max(0, pos.y);
+  const int x1 = std::min(board.width - 1, pos.x + size - 1);
+  const int y1 = std::min(board.height - 1, pos.y + size - 1);
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      fn(x, y);
+    }
+  }
+}
+
+} // namespace
+
+void TowerOccupancy::Add(size_t index, const Position &pos, int size) {
+  ForFootprint(board(), pos, size, [&](int x, int y) {
+    owners_(x, y) = static_cast<uint32_t>(index);
+    occupied_.Set(x, y);
+  });
+}
+
+void TowerOccupancy::Remove(size_t index, const Position &pos, int size) {
+  ForFootprint(board(), pos, size, [&](int x, int y) {
+    if (occupied_.Test(x, y) && owners_(x, y) == index) {
+      occupied_.Clear(x, y);
+    }
+  });
+}
+
+void TowerOccupancy::Erase(size_t index, const Position &pos, int size) {
+  Remove(index, pos, size);
+  occupied_.ForEach([&](int x, int y) {
+    uint32_t &owner = owners_(x, y);
+    if (owner > index) {
+      --owner;
+    }
+  });
+}
+
+void TowerOccupancy::Clear(const BoardSize &board) {
+  if (board == occupied_.board()) {
+    occupied_.Reset();
+    return;
+  }
+  occupied_.Resize(board);
+  owners_.Assign(board);
+}
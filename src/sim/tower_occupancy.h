@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "sim/board.h"
+#include "sim/board_bitset.h"
+#include "sim/board_grid.h"
+
+// Owning tower index for every board cell, kept in step with the tower list
+// so "which tower is here" and "is this footprint free" are table reads
+// instead of scans over every tower. Towers never overlap (placement and
+// kitty landings both reject occupied cells), so each cell has at most one
+// owner. Footprints are clipped to the board.
+class TowerOccupancy {
+public:
+  // Marks the size x size footprint at pos as owned by tower `index`.
+  void Add(size_t index, const Position &pos, int size);
+  // Frees the cells of the footprint at pos that tower `index` owns.
+  void Remove(size_t index, const Position &pos, int size);
+  // Removes tower `index` and renumbers the owners above it, matching
+  // towers.erase(towers.begin() + index).
+  void Erase(size_t index, const Position &pos, int size);
+  // Frees every cell and covers board from now on.
+  void Clear(const BoardSize &board);
+  const BoardSize &board() const { return occupied_.board(); }
+
+  std::optional<size_t> OwnerAt(const Position &p) const {
+    if (!occupied_.Test(p)) {
+      return std::nullopt;
+    }
+    return owners_[p];
+  }
+  bool AnyInRect(int x0, int y0, int x1, int y1) const {
+    return occupied_.AnyInRect(x0, y0, x1, y1);
+  }
+  const BoardBitset &occupied() const { return occupied_; }
+
+private:
+  BoardGrid<uint32_t> owners_; // valid where occupied_ is set
+  BoardBitset occupied_;
+};
@@ -0,0 +1,82 @@
+#include "sim/worker_pool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threads) {
+  if (threads < 1) {
+    threads =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  workers_.reserve(static_cast<size_t>(threads - 1));
+  for (int i = 1; i < threads; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkerPool::ParallelFor(size_t count, const RangeFn &fn, size_t chunk) {
+  if (count == 0) {
+    return;
+  }
+  if (workers_.empty() || count == 1) {
+    fn(0, count);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &fn;
+    count_ = count;
+    // A few chunks per thread keeps the counter cold but still balances
+    // uneven work.
+    chunk_ = chunk != 0 ? chunk
+                        : std::max<size_t>(
+                              1, count / (static_cast<size_t>(size()) * 4));
+    next_.store(0, std::memory_order_relaxed);
+    busy_ = workers_.size();
+    ++generation_;
+  }
+  wake_.notify_all();
+  RunChunks();
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return busy_ == 0; });
+  job_ = nullptr;
+}
+
+void WorkerPool::WorkerLoop() {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+    }
+    RunChunks();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--busy_ == 0) {
+      done_.notify_one();
+    }
+  }
+}
+
+void WorkerPool::RunChunks() {
+  for (;;) {
+    const size_t begin = next_.fetch_add(chunk_, std::memory_order_relaxed);
+    if (begin >= count_) {
+      return;
+    }
+    (*job_)(begin, std::min(count_, begin + chunk_));
+  }
+}
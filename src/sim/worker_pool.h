@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that split index ranges between them. Workers pull
+// chunks from a shared counter, so a thread that finishes early takes over
+// work that would otherwise queue behind a slow one. The calling thread
+// works too and ParallelFor() returns once every index is done. One caller
+// at a time; a pool of one thread runs everything inline.
+class WorkerPool {
+public:
+  // fn(begin, end) handles the indices [begin, end).
+  using RangeFn = std::function<void(size_t, size_t)>;
+
+  // threads counts the caller; values below 1 mean one per hardware thread.
+  explicit WorkerPool(int threads);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // Calls fn over [0, count) in chunks of `chunk` indices (0 picks a few
+  // chunks per thread), in no particular order or thread.
+  void ParallelFor(size_t count, const RangeFn &fn, size_t chunk = 0);
+
+private:
+  void WorkerLoop();
+  void RunChunks();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const RangeFn *job_ = nullptr;
+  size_t count_ = 0;
+  size_t chunk_ = 1;
+  std::atomic<size_t> next_{0};
+  size_t busy_ = 0;         // workers still on the current job
+  uint64_t generation_ = 0; // bumped once per ParallelFor()
+  bool stop_ = false;
+};
@@ -15,14 +15,17 @@ using namespace std::chrono_literals;
 
 namespace {
 
-std::filesystem::path PrefsPath() {
+std::filesystem::path ConfigDir() {
   std::filesystem::path home = std::getenv("HOME") ? std::getenv("HOME") : "";
   if (home.empty()) {
     home = ".";
   }
-  return home / ".config" / "catcat" / "update_prefs.cfg";
+  return home / ".config" / "catcat";
 }
 
+std::filesystem::path PrefsPath() { return ConfigDir() / "update_prefs.cfg"; }
+std::filesystem::path CachePath() { return ConfigDir() / "update_cache.cfg"; }
+
 std::optional<std::string> StableVersionFromJson(const std::string &data) {
   const std::string key = "\"stable\"";
   const auto key_pos = data.find(key);
@@ -98,6 +101,56 @@ void SavePrefs(const UpdatePrefs &prefs) {
   out << "skip_version=" << prefs.skip_version << "\n";
 }
 
+std::optional<UpdateCache> LoadUpdateCache() {
+  std::ifstream in(CachePath());
+  if (!in) {
+    return std::nullopt;
+  }
+  UpdateCache cache;
+  bool has_time = false;
+  std::string line;
+  while (std::getline(in, line)) {
+    const auto pos = line.find('=');
+    if (pos == std::string::npos)
+      continue;
+    const auto key = line.substr(0, pos);
+    const auto value = line.substr(pos + 1);
+    if (key == "latest") {
+      cache.latest = NormalizeVersion(value);
+    } else if (key == "checked_at") {
+      try {
+        cache.checked_at = std::stoll(value);
+        has_time = true;
+      } catch (...) {
+        return std::nullopt;
+      }
+    }
+  }
+  if (!has_time) {
+    return std::nullopt;
+  }
+  return cache;
+}
+
+void SaveUpdateCache(const UpdateCache &cache) {
+  const auto path = CachePath();
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  std::ofstream out(path, std::ios::trunc);
+  if (!out) {
+    return;
+  }
+  out << "latest=" << cache.latest << "\n"
+      << "checked_at=" << cache.checked_at << "\n";
+}
+
+bool UpdateCacheFresh(const UpdateCache &cache, int64_t now) {
+  const int64_t ttl =
+      cache.latest.empty() ? kUpdateRetrySeconds : kUpdateCacheTtlSeconds;
+  // A clock set backwards makes the cache look newer than now; recheck.
+  return cache.checked_at <= now && now - cache.checked_at < ttl;
+}
+
 bool HasNetworkConnectivity() {
   // Quick connectivity probe with 1s timeout; avoid blocking when offline.
   int ret = std::system("ping -c 1 -W 1 8.8.8.8 >/dev/null 2>&1");
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <string>
 
@@ -11,5 +12,19 @@ std::string NormalizeVersion(const std::string &v);
 UpdatePrefs LoadPrefs();
 void SavePrefs(const UpdatePrefs &prefs);
 
+// The last brew lookup, kept in update_cache.cfg next to the prefs so a
+// launch soon after another does not run brew again.
+struct UpdateCache {
+  std::string latest; // empty if the lookup failed
+  int64_t checked_at = 0; // unix seconds
+};
+constexpr int64_t kUpdateCacheTtlSeconds = 24 * 60 * 60;
+constexpr int64_t kUpdateRetrySeconds = 60 * 60; // after a failed lookup
+
+std::optional<UpdateCache> LoadUpdateCache();
+void SaveUpdateCache(const UpdateCache &cache);
+// True if cache is recent enough to stand in for a lookup at now.
+bool UpdateCacheFresh(const UpdateCache &cache, int64_t now);
+
 bool HasNetworkConnectivity();
 std::optional<std::string> DetectLatestViaBrew();
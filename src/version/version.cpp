@@ -1,18 +1,41 @@
 #include "version/version.h"
 
 #include <cctype>
+#include <chrono>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <thread>
+#include <utility>
 
 #include "version/update_checker.h"
 
+namespace {
+
+int64_t UnixNow() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// Asks brew for the latest version and records the answer in the cache.
+std::optional<std::string> LookUpLatest() {
+  const auto latest = DetectLatestViaBrew();
+  UpdateCache cache;
+  cache.latest = latest.has_value() ? NormalizeVersion(*latest) : "";
+  cache.checked_at = UnixNow();
+  SaveUpdateCache(cache);
+  return latest;
+}
+
+} // namespace
+
 std::string CurrentVersion() { return CATCAT_VERSION; }
 
 UpdateAction CheckForUpdates(bool interactive_prompt, bool show_up_to_date) {
   const std::string current_raw = CurrentVersion();
   const std::string current = NormalizeVersion(current_raw);
-  const auto latest = DetectLatestViaBrew();
+  const auto latest = LookUpLatest();
   if (!latest.has_value() || latest->empty()) {
     if (show_up_to_date) {
       std::cout << "catcat " << current_raw
@@ -59,3 +82,44 @@ UpdateAction CheckForUpdates(bool interactive_prompt, bool show_up_to_date) {
   }
   return UpdateAction::Continue;
 }
+
+BackgroundUpdateCheck::BackgroundUpdateCheck() {
+  std::thread([state = state_] {
+    const auto cache = LoadUpdateCache();
+    std::optional<std::string> latest;
+    if (cache.has_value() && UpdateCacheFresh(*cache, UnixNow())) {
+      latest = cache->latest;
+    } else {
+      latest = LookUpLatest();
+    }
+    if (!latest.has_value() || latest->empty()) {
+      return;
+    }
+    const std::string latest_norm = NormalizeVersion(*latest);
+    if (latest_norm == NormalizeVersion(CurrentVersion()) ||
+        LoadPrefs().skip_version == latest_norm) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->newer = latest_norm;
+    if (state->on_found) {
+      state->on_found();
+    }
+  }).detach();
+}
+
+void BackgroundUpdateCheck::SetOnFound(std::function<void()> on_found) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->on_found = std::move(on_found);
+}
+
+std::optional<std::string> BackgroundUpdateCheck::NewerVersion() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->newer;
+}
+
+void BackgroundUpdateCheck::SkipVersion(const std::string &version) {
+  UpdatePrefs prefs = LoadPrefs();
+  prefs.skip_version = NormalizeVersion(version);
+  SavePrefs(prefs);
+}
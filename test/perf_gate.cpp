@@ -0,0 +1,231 @@
+// Plays the heavy scenarios of a perf gate file headless and fails if a
+// tick takes longer, or allocates more, than the scenario's budget allows.
+// Registered with CTest as perf_gate:
+//
+//   catcat_perf_gate scripts/perf_gate.json
+//
+// The file is a batch runs file (see sim/batch.h) whose runs may also set:
+//   measure_from_wave  ticks of earlier waves only build the scenario up
+//   frame_ticks        ticks timed together as one frame (5: fast-forward)
+//   p99_us             budget for the 99th percentile frame time
+//   allocs_per_frame   budget for the mean allocations per measured frame
+// Time budgets are only enforced in optimized (NDEBUG) builds; allocation
+// counts do not depend on the build type and are always enforced.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#include <nlohmann/json.hpp>
+
+#include "sim/batch.h"
+#include "sim/headless.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+// MSVC has no std::aligned_alloc, and its aligned blocks need their own free.
+void *AlignedAlloc(std::size_t size, std::size_t align) {
+#ifdef _MSC_VER
+  return _aligned_malloc(size, align);
+#else
+  // aligned_alloc wants a size that is a multiple of the alignment.
+  return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+}
+
+void AlignedFree(void *p) {
+#ifdef _MSC_VER
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+} // namespace
+
+// The array and nothrow forms of operator new forward to these two, so
+// they count every allocation. Kept out of line so GCC does not pair an
+// inlined malloc with std::free and warn about mismatched new and delete.
+[[gnu::noinline]] void *operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void *operator new(std::size_t size, std::align_val_t al) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = AlignedAlloc(size == 0 ? 1 : size,
+                             static_cast<std::size_t>(al))) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+[[gnu::noinline]] void operator delete(void *p, std::align_val_t) noexcept {
+  AlignedFree(p);
+}
+[[gnu::noinline]] void operator delete(void *p, std::size_t,
+                                       std::align_val_t) noexcept {
+  AlignedFree(p);
+}
+
+namespace {
+
+struct Budget {
+  int measure_from_wave = 0;
+  int frame_ticks = 1;
+  double p99_us = 0.0;           // 0 = not checked
+  double allocs_per_frame = -1.0; // negative = not checked
+};
+
+// Times and counts allocations of every frame_ticks ticks once the wave
+// reaches measure_from_wave. A frame the end of a wave cuts short is
+// measured as it is, so the time between waves is never counted.
+class FrameMeter {
+public:
+  explicit FrameMeter(const Budget &budget) : budget_(budget) {}
+
+  void BeforeTick(const Simulation &sim) {
+    measuring_ = sim.wave() >= budget_.measure_from_wave;
+    if (!measuring_ || ticks_in_frame_ > 0) {
+      return;
+    }
+    frame_start_ = std::chrono::steady_clock::now();
+    frame_allocations_ = g_allocations.load(std::memory_order_relaxed);
+  }
+
+  void AfterTick(const Simulation &sim) {
+    if (!measuring_ ||
+        (++ticks_in_frame_ < budget_.frame_ticks && sim.wave_active())) {
+      return;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    allocations_ +=
+        g_allocations.load(std::memory_order_relaxed) - frame_allocations_;
+    frame_us_.push_back(
+        std::chrono::duration<double, std::micro>(end - frame_start_)
+            .count());
+    ticks_in_frame_ = 0;
+  }
+
+  size_t frames() const { return frame_us_.size(); }
+  double P99() {
+    if (frame_us_.empty()) {
+      return 0.0;
+    }
+    std::sort(frame_us_.begin(), frame_us_.end());
+    return frame_us_[(frame_us_.size() - 1) * 99 / 100];
+  }
+  double AllocationsPerFrame() const {
+    return frame_us_.empty() ? 0.0
+                             : static_cast<double>(allocations_) /
+                                   static_cast<double>(frame_us_.size());
+  }
+
+private:
+  Budget budget_;
+  bool measuring_ = false;
+  int ticks_in_frame_ = 0;
+  std::chrono::steady_clock::time_point frame_start_{};
+  uint64_t frame_allocations_ = 0;
+  uint64_t allocations_ = 0;
+  std::vector<double> frame_us_;
+};
+
+// The budget fields of every run in the file, in file order. Prints the
+// problem and returns false on error.
+bool LoadBudgets(const std::string &path, std::vector<Budget> &budgets) {
+  std::ifstream in(path);
+  try {
+    const auto doc = nlohmann::json::parse(in);
+    for (const auto &run : doc.at("runs")) {
+      if (run.value("count", 1) != 1) {
+        std::fprintf(stderr, "perf_gate: %s: runs must not set count\n",
+                     path.c_str());
+        return false;
+      }
+      Budget b;
+      b.measure_from_wave = run.value("measure_from_wave", 0);
+      b.frame_ticks = std::max(1, run.value("frame_ticks", 1));
+      b.p99_us = run.value("p99_us", 0.0);
+      b.allocs_per_frame = run.value("allocs_per_frame", -1.0);
+      budgets.push_back(b);
+    }
+  } catch (const nlohmann::json::exception &e) {
+    std::fprintf(stderr, "perf_gate: %s: %s\n", path.c_str(), e.what());
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <perf_gate.json>\n", argv[0]);
+    return 2;
+  }
+  const auto runs = LoadBatch(argv[1]);
+  std::vector<Budget> budgets;
+  if (!runs.has_value() || !LoadBudgets(argv[1], budgets) ||
+      budgets.size() != runs->size()) {
+    return 2;
+  }
+#ifdef NDEBUG
+  constexpr bool kCheckTime = true;
+#else
+  constexpr bool kCheckTime = false;
+#endif
+
+  bool pass = true;
+  for (size_t i = 0; i < runs->size(); ++i) {
+    const BatchRun &run = (*runs)[i];
+    const Budget &budget = budgets[i];
+    FrameMeter meter(budget);
+    HeadlessOptions options = run.options;
+    options.before_tick = [&](const Simulation &s) { meter.BeforeTick(s); };
+    options.after_tick = [&](const Simulation &s) { meter.AfterTick(s); };
+    const auto result = RunHeadless(options);
+    if (!result.has_value()) {
+      return 2;
+    }
+
+    const double p99 = meter.P99();
+    const double allocs = meter.AllocationsPerFrame();
+    const bool no_frames = meter.frames() == 0;
+    const bool slow =
+        kCheckTime && budget.p99_us > 0.0 && p99 > budget.p99_us;
+    const bool allocating =
+        budget.allocs_per_frame >= 0.0 && allocs > budget.allocs_per_frame;
+    const bool ok = !no_frames && !slow && !allocating;
+    pass = pass && ok;
+    std::printf("%-14s %s frames=%zu wave=%d p99_us=%.1f (budget %.0f%s) "
+                "allocs_per_frame=%.2f (budget %.2f)\n",
+                run.name.c_str(), ok ? "ok  " : "FAIL", meter.frames(),
+                result->wave, p99, budget.p99_us,
+                kCheckTime ? "" : ", unchecked", allocs,
+                budget.allocs_per_frame);
+  }
+  if (!pass) {
+    std::printf("perf budget exceeded; `catcat --headless --trace` shows "
+                "which phase\n");
+  }
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sim/batch.h"
+#include "sim/headless.h"
+#include "sim/snapshot.h"
+
+namespace {
+
+std::vector<BatchRun> Parse(const std::string &text) {
+  std::istringstream in(text);
+  auto runs = ParseBatch(in, "test");
+  EXPECT_TRUE(runs.has_value());
+  return runs.value_or(std::vector<BatchRun>{});
+}
+
+// Result lines sorted by run, with the timing dropped.
+std::vector<std::string> Play(const std::vector<BatchRun> &runs, int jobs) {
+  std::ostringstream out;
+  EXPECT_TRUE(RunBatch(runs, jobs, out));
+  std::vector<std::string> lines;
+  std::istringstream in(out.str());
+  for (std::string line; std::getline(in, line);) {
+    lines.push_back(line.substr(0, line.find(",\"elapsed_ms\"")));
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+} // namespace
+
+TEST(BatchTest, CountExpandsIntoConsecutiveSeeds) {
+  const auto runs = Parse(R"({
+    "defaults": {"max_waves": 3, "difficulty_per_map": 5},
+    "runs": [{"name": "a", "seed": 10, "count": 3}, {"name": "b"}]
+  })");
+  ASSERT_EQ(runs.size(), 4U);
+  EXPECT_EQ(runs[0].options.seed, 10U);
+  EXPECT_EQ(runs[2].options.seed, 12U);
+  EXPECT_EQ(runs[3].name, "b");
+  EXPECT_EQ(runs[3].options.seed, 1U);
+  EXPECT_EQ(runs[3].options.max_waves, 3);
+  EXPECT_EQ(runs[3].options.difficulty.per_map, 5);
+}
+
+TEST(BatchTest, RejectsMalformedFiles) {
+  std::istringstream bad_json("[{\"seed\": }]");
+  EXPECT_FALSE(ParseBatch(bad_json, "test").has_value());
+  std::istringstream bad_type(R"([{"max_waves": "many"}])");
+  EXPECT_FALSE(ParseBatch(bad_type, "test").has_value());
+}
+
+TEST(BatchTest, SeededRunsDoNotDependOnJobCount) {
+  const auto runs = Parse(R"([{"seed": 5, "count": 4, "max_waves": 2}])");
+  const auto serial = Play(runs, 1);
+  ASSERT_EQ(serial.size(), 4U);
+  EXPECT_EQ(Play(runs, 3), serial);
+}
+
+TEST(HeadlessTest, FillPlacesACatInEveryFreeCell) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "catcat_fill_test.txt")
+          .string();
+  {
+    std::ofstream out(path);
+    out << "wave 2\nfill default 3 4 1 5\n";
+  }
+  const auto script = LoadHeadlessScript(path);
+  std::filesystem::remove(path);
+  ASSERT_TRUE(script.has_value());
+  ASSERT_EQ(script->size(), 6U);
+  for (size_t i = 0; i < script->size(); ++i) {
+    const auto &a = (*script)[i];
+    EXPECT_EQ(a.wave, 2);
+    EXPECT_EQ(a.kind, ScriptedAction::Kind::Place);
+    EXPECT_EQ(a.pos.x, 1 + static_cast<int>(i % 3));
+    EXPECT_EQ(a.pos.y, 4 + static_cast<int>(i / 3));
+  }
+}
+
+TEST(HeadlessTest, TickHooksBracketEveryTick) {
+  HeadlessOptions options;
+  options.seed = 3;
+  options.max_waves = 2;
+  long long before = 0;
+  long long after = 0;
+  options.before_tick = [&](const Simulation &) {
+    EXPECT_EQ(before, after);
+    ++before;
+  };
+  options.after_tick = [&](const Simulation &) { ++after; };
+  const auto result = RunHeadless(options, {});
+  ASSERT_TRUE(result.has_value());
+  EXPECT_GT(result->ticks, 0);
+  EXPECT_EQ(before, result->ticks);
+  EXPECT_EQ(after, result->ticks);
+}
+
+TEST(HeadlessTest, SnapshotThatDoesNotFitPlaysNothing) {
+  // A valid file whose map is not among the loaded ones.
+  auto saved = Simulation().SaveSnapshot();
+  SnapshotHeader header;
+  std::memcpy(&header, saved.data(), sizeof(header));
+  header.map_index = 99;
+  std::memcpy(saved.data(), &header, sizeof(header));
+  ASSERT_TRUE(SnapshotValid(saved));
+  EXPECT_FALSE(RunHeadless(HeadlessOptions{}, {}, saved).has_value());
+
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "catcat_misfit_test.snap")
+          .string();
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(saved.data()),
+              static_cast<std::streamsize>(saved.size()));
+  }
+  auto runs = Parse(R"([{"max_waves": 1}])");
+  runs[0].options.snapshot_path = path;
+  std::ostringstream out;
+  EXPECT_FALSE(RunBatch(runs, 1, out));
+  std::filesystem::remove(path);
+  EXPECT_NE(out.str().find("\"result\":\"error\""), std::string::npos);
+}
+
+TEST(HeadlessTest, SaveThatCannotBeWrittenFailsTheRun) {
+  const auto missing_dir =
+      std::filesystem::temp_directory_path() / "catcat_no_such_dir";
+  HeadlessOptions options;
+  options.max_waves = 1;
+  options.save_path = (missing_dir / "out.snap").string();
+  EXPECT_FALSE(RunHeadless(options, {}).has_value());
+  options.save_path.clear();
+  options.trace_path = (missing_dir / "trace.json").string();
+  EXPECT_FALSE(RunHeadless(options, {}).has_value());
+}
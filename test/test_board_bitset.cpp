@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "sim/board_bitset.h"
+
+TEST(BoardBitsetTest, SetRectClipsToBoard) {
+  BoardBitset mask;
+  mask.SetRect(-2, -2, 1, 1);
+  EXPECT_EQ(mask.Count(), 4);
+  EXPECT_TRUE(mask.Test(0, 0));
+  EXPECT_TRUE(mask.Test(1, 1));
+  EXPECT_FALSE(mask.Test(2, 1));
+  EXPECT_FALSE(mask.Test(-1, 0));
+
+  mask.Reset();
+  mask.SetRect(kBoardWidth - 1, kBoardHeight - 1, kBoardWidth + 3,
+               kBoardHeight + 3);
+  EXPECT_EQ(mask.Count(), 1);
+  EXPECT_TRUE(mask.AnyInRect(kBoardWidth - 2, kBoardHeight - 2,
+                             kBoardWidth + 5, kBoardHeight + 5));
+  EXPECT_FALSE(mask.AnyInRect(0, 0, kBoardWidth - 2, kBoardHeight - 1));
+}
+
+TEST(BoardBitsetTest, ForEachVisitsRowMajor) {
+  BoardBitset mask;
+  mask.Set(3, 2);
+  mask.Set(1, 2);
+  mask.Set(5, 0);
+  mask.Set(kBoardWidth, 0); // off the board, ignored
+  std::vector<Position> seen;
+  mask.ForEach([&](int x, int y) { seen.push_back({x, y}); });
+  ASSERT_EQ(seen.size(), 3U);
+  EXPECT_EQ(seen[0].x, 5);
+  EXPECT_EQ(seen[1].x, 1);
+  EXPECT_EQ(seen[2].x, 3);
+  EXPECT_EQ(seen[2].y, 2);
+}
+
+TEST(BoardBitsetTest, AndNotClearsOtherCells) {
+  BoardBitset a;
+  a.SetRect(0, 0, 3, 0);
+  BoardBitset b;
+  b.Set(1, 0);
+  b.Set(2, 4);
+  a.AndNot(b);
+  EXPECT_EQ(a.Count(), 3);
+  EXPECT_FALSE(a.Test(1, 0));
+  EXPECT_EQ((a | b).Count(), 5);
+  EXPECT_TRUE((a & b).None());
+}
+
+TEST(BoardBitsetTest, WideBoardsSpanSeveralWords) {
+  BoardBitset mask(BoardSize{200, 3});
+  mask.SetRect(60, 1, 130, 1);
+  EXPECT_EQ(mask.Count(), 71);
+  EXPECT_TRUE(mask.Test(63, 1));
+  EXPECT_TRUE(mask.Test(64, 1));
+  EXPECT_TRUE(mask.Test(128, 1));
+  EXPECT_FALSE(mask.Test(131, 1));
+  EXPECT_TRUE(mask.AnyInRect(130, 0, 199, 2));
+  EXPECT_FALSE(mask.AnyInRect(131, 0, 199, 2));
+  mask.Set(199, 2);
+  mask.Set(200, 2); // off the board, ignored
+  mask.ClearRect(0, 0, 127, 2);
+
+  std::vector<Position> seen;
+  mask.ForEach([&](int x, int y) { seen.push_back({x, y}); });
+  ASSERT_EQ(seen.size(), 4U);
+  EXPECT_EQ(seen[0].x, 128);
+  EXPECT_EQ(seen[2].x, 130);
+  EXPECT_EQ(seen[3].x, 199);
+  EXPECT_EQ(seen[3].y, 2);
+}
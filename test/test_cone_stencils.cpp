@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "sim/cone_stencils.h"
+
+namespace {
+
+// The board scan FireGalactic used before stencils.
+std::vector<Position> ScanCone(const Position &pos, int size, float range,
+                               const Position &target) {
+  const float cx =
+      static_cast<float>(pos.x) + (static_cast<float>(size) - 1.0F) / 2.0F;
+  const float cy =
+      static_cast<float>(pos.y) + (static_cast<float>(size) - 1.0F) / 2.0F;
+  const float dx = static_cast<float>(target.x) - cx;
+  const float dy = static_cast<float>(target.y) - cy;
+  const float len = std::max(0.001F, std::sqrt(dx * dx + dy * dy));
+  const float ndx = dx / len;
+  const float ndy = dy / len;
+  std::vector<Position> cells;
+  for (int y = 0; y < kBoardHeight; ++y) {
+    for (int x = 0; x < kBoardWidth; ++x) {
+      const float vx = static_cast<float>(x) - cx;
+      const float vy = static_cast<float>(y) - cy;
+      const float dist2 = vx * vx + vy * vy;
+      if (dist2 > range * range)
+        continue;
+      const float dist = std::sqrt(dist2);
+      if (dist < 0.1F)
+        continue;
+      if ((vx / dist) * ndx + (vy / dist) * ndy >= std::cos(0.6F)) {
+        cells.push_back({x, y});
+      }
+    }
+  }
+  return cells;
+}
+
+} // namespace
+
+TEST(ConeStencilsTest, MatchesBoardScan) {
+  ConeStencils stencils;
+  const std::vector<Position> towers = {{6, 15}, {0, 0}, {47, 27}, {20, 3}};
+  for (int size : {1, 2}) {
+    for (const auto &pos : towers) {
+      for (int ty = pos.y - 8; ty <= pos.y + 8; ty += 3) {
+        for (int tx = pos.x - 8; tx <= pos.x + 8; tx += 2) {
+          const ConeStencil &cone =
+              stencils.Get(size, 7.5F, tx - pos.x, ty - pos.y);
+          const auto want = ScanCone(pos, size, 7.5F, {tx, ty});
+          std::vector<Position> got;
+          for (int y = 0; y < kBoardHeight; ++y) {
+            for (int x = 0; x < kBoardWidth; ++x) {
+              if (cone.Contains(x - pos.x, y - pos.y)) {
+                got.push_back({x, y});
+              }
+            }
+          }
+          ASSERT_EQ(got.size(), want.size()) << tx << "," << ty;
+          for (size_t i = 0; i < got.size(); ++i) {
+            EXPECT_EQ(got[i].x, want[i].x);
+            EXPECT_EQ(got[i].y, want[i].y);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(ConeStencilsTest, ReusesStencilForSameShape) {
+  ConeStencils stencils;
+  const ConeStencil &a = stencils.Get(1, 7.5F, 3, -2);
+  const ConeStencil &b = stencils.Get(1, 7.5F, 3, -2);
+  EXPECT_EQ(&a, &b);
+  stencils.Get(1, 9.0F, 3, -2);
+  EXPECT_EQ(stencils.size(), 2U);
+}
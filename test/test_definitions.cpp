@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "sim/definitions.h"
+#include "sim/simulation.h"
+
+namespace {
+
+std::unique_ptr<Definitions> Parse(const std::string &text) {
+  std::istringstream in(text);
+  return ParseDefinitions(in, "test");
+}
+
+} // namespace
+
+TEST(DefinitionsTest, BuiltinTables) {
+  const Definitions &defs = Definitions::Builtin();
+  const TowerDef &fat = defs.tower(Tower::Type::Fat);
+  EXPECT_EQ(fat.type, Tower::Type::Fat);
+  EXPECT_EQ(fat.cost, 35);
+  EXPECT_EQ(fat.size, 2);
+  EXPECT_EQ(defs.maps().size(), 10U);
+  const auto by_cost = defs.towers_by_cost();
+  ASSERT_EQ(by_cost.size(), static_cast<size_t>(kTowerTypeCount));
+  EXPECT_EQ(by_cost.front().type, Tower::Type::Default);
+  for (size_t i = 1; i < by_cost.size(); ++i) {
+    EXPECT_LE(by_cost[i - 1].cost, by_cost[i].cost);
+  }
+  EXPECT_EQ(&Definitions::Active(), &defs);
+}
+
+TEST(DefinitionsTest, OverridesOnlyTheFieldsGiven) {
+  const auto defs = Parse(R"({
+    "towers": {"default": {"cost": 500, "name": "Pricey"}},
+    "enemies": {"dog": {"bounty": 99}}
+  })");
+  ASSERT_NE(defs, nullptr);
+  const TowerDef &def = defs->tower(Tower::Type::Default);
+  const TowerDef &builtin = Definitions::Builtin().tower(Tower::Type::Default);
+  EXPECT_EQ(def.cost, 500);
+  EXPECT_EQ(def.name, "Pricey");
+  EXPECT_EQ(def.damage, builtin.damage);
+  EXPECT_EQ(defs->towers_by_cost().back().type, Tower::Type::Default);
+  EXPECT_EQ(defs->enemy(EnemyType::Dog).bounty, 99);
+  EXPECT_EQ(defs->enemy(EnemyType::Dog).hp,
+            Definitions::Builtin().enemy(EnemyType::Dog).hp);
+  EXPECT_EQ(defs->maps().size(), Definitions::Builtin().maps().size());
+}
+
+TEST(DefinitionsTest, RejectsBadInput) {
+  EXPECT_EQ(Parse("[1, 2]"), nullptr);
+  EXPECT_EQ(Parse(R"({"towers": {"lion": {"cost": 5}}})"), nullptr);
+  EXPECT_EQ(Parse(R"({"towers": {"fat": {"size": 3}}})"), nullptr);
+  EXPECT_EQ(Parse(R"({"enemies": {"rat": {"hp": 0}}})"), nullptr);
+  EXPECT_EQ(Parse(R"({"maps": []})"), nullptr);
+  EXPECT_EQ(Parse(R"({"maps": [{"path": [[0, 3]]}]})"), nullptr);
+  EXPECT_EQ(Parse(R"({"maps": [{"path": [[0, 3], [5, 5]]}]})"), nullptr);
+  EXPECT_EQ(Parse(R"({"maps": [{"path": [[0, 3], [999, 3]]}]})"), nullptr);
+  EXPECT_EQ(Parse(R"({"maps": [{"width": 2, "path": [[0, 0], [1, 0]]}]})"),
+            nullptr);
+}
+
+TEST(DefinitionsTest, SimulationPlaysACustomMap) {
+  const auto defs = Parse(R"({
+    "towers": {"default": {"cost": 7}},
+    "maps": [{"path_width": 2, "path": [[0, 3], [20, 3], [20, 9]]}]
+  })");
+  ASSERT_NE(defs, nullptr);
+  Simulation sim(/*dev_mode=*/false, *defs);
+  ASSERT_FALSE(sim.path().empty());
+  EXPECT_EQ(sim.path().front().y, 3);
+  EXPECT_EQ(sim.path().back().x, 20);
+  EXPECT_EQ(sim.path().back().y, 9);
+  const int kibbles = sim.kibbles();
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Default, {5, 12}),
+            PlaceResult::Placed);
+  EXPECT_EQ(sim.kibbles(), kibbles - 7);
+}
+
+TEST(DefinitionsTest, MapsCanBringTheirOwnBoard) {
+  const auto defs = Parse(R"({"maps": [{"width": 512, "height": 300,
+    "path": [[0, 150], [511, 150], [511, 0]]}]})");
+  ASSERT_NE(defs, nullptr);
+  Simulation sim(/*dev_mode=*/true, *defs);
+  EXPECT_EQ(sim.board(), (BoardSize{512, 300}));
+  EXPECT_TRUE(sim.path_mask().Test(400, 150));
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Galactic, {6, 145}),
+            PlaceResult::Placed);
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Default, {511, 299}),
+            PlaceResult::Placed);
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Fat, {511, 298}),
+            PlaceResult::Blocked); // would hang off the board
+  const int kibbles = sim.kibbles();
+  sim.StartWave();
+  for (int i = 0; i < 2000; ++i) {
+    sim.Tick();
+  }
+  EXPECT_GT(sim.kibbles(), kibbles); // bounties from the first enemies
+  EXPECT_FALSE(sim.game_over());
+}
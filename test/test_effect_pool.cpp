@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "sim/effect_pool.h"
+
+TEST(EffectPoolTest, RemoveIfKeepsOrderOfSurvivors) {
+  EffectPool<int> pool;
+  for (int i = 0; i < 6; ++i) {
+    pool.Push(i);
+  }
+  pool.RemoveIf([](int v) { return v % 2 == 0; });
+  EXPECT_EQ(std::vector<int>(pool.begin(), pool.end()),
+            (std::vector<int>{1, 3, 5}));
+}
+
+TEST(EffectPoolTest, ReusedSlotsKeepOwnedBuffers) {
+  EffectPool<std::vector<int>> pool;
+  auto &first = pool.Acquire();
+  first.assign(64, 7);
+  const int *buffer = first.data();
+  pool.RemoveIf([](const std::vector<int> &) { return true; });
+  ASSERT_TRUE(pool.empty());
+
+  auto &again = pool.Acquire();
+  again.clear();
+  again.push_back(1);
+  EXPECT_EQ(again.data(), buffer);
+}
+
+TEST(EffectPoolTest, FullRingRecyclesOldest) {
+  EffectPool<int> pool(3);
+  for (int i = 0; i < 5; ++i) {
+    pool.Push(i);
+  }
+  EXPECT_EQ(std::vector<int>(pool.begin(), pool.end()),
+            (std::vector<int>{2, 3, 4}));
+}
+
+TEST(EffectPoolTest, WrappedRingIndexesOldestFirst) {
+  EffectPool<int> pool(3);
+  for (int i = 0; i < 7; ++i) {
+    pool.Push(i);
+  }
+  EXPECT_EQ(pool.front(), 4);
+  EXPECT_EQ(pool.back(), 6);
+  EXPECT_EQ(pool[1], 5);
+  const int *newest = &pool.back();
+  pool.Push(7); // overwrites 4 in place
+  EXPECT_EQ(&pool[1], newest);
+  EXPECT_EQ(std::vector<int>(pool.begin(), pool.end()),
+            (std::vector<int>{5, 6, 7}));
+}
+
+TEST(EffectPoolTest, WrappedRingRemovesAndRefills) {
+  EffectPool<int> pool(4);
+  for (int i = 0; i < 6; ++i) {
+    pool.Push(i);
+  }
+  pool.RemoveIf([](int v) { return v == 3; });
+  EXPECT_EQ(std::vector<int>(pool.begin(), pool.end()),
+            (std::vector<int>{2, 4, 5}));
+  pool.Push(6);
+  pool.Push(7); // full again: 2 goes
+  EXPECT_EQ(std::vector<int>(pool.begin(), pool.end()),
+            (std::vector<int>{4, 5, 6, 7}));
+}
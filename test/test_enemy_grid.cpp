@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "sim/enemy_grid.h"
+
+namespace {
+
+const BoardSize kBoard; // the default board
+
+} // namespace
+
+TEST(EnemyGridTest, EmptyGridVisitsNothing) {
+  EnemyGrid grid;
+  grid.Build(kBoard, {}, {});
+  std::vector<size_t> out;
+  grid.CollectRect(0, 0, kBoardWidth - 1, kBoardHeight - 1, out);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(EnemyGridTest, CellBucketsKeepEnemyOrder) {
+  EnemyGrid grid;
+  grid.Build(kBoard, {3, 10, 3, 0, 3}, {4, 10, 4, 0, 4});
+  std::vector<size_t> out;
+  grid.CollectCell({3, 4}, out);
+  EXPECT_EQ(out, (std::vector<size_t>{0, 2, 4}));
+}
+
+TEST(EnemyGridTest, RectIsInclusiveAndClamped) {
+  EnemyGrid grid;
+  grid.Build(kBoard, {0, 5, 6, kBoardWidth - 1, 7},
+             {0, 5, 5, kBoardHeight - 1, 7});
+  std::vector<size_t> out;
+  grid.CollectRect(-10, -10, 6, 6, out);
+  EXPECT_EQ(out, (std::vector<size_t>{0, 1, 2}));
+
+  out.clear();
+  grid.CollectRect(40, 20, 100, 100, out);
+  EXPECT_EQ(out, (std::vector<size_t>{3}));
+
+  out.clear();
+  grid.CollectRect(8, 8, 7, 7, out);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(EnemyGridTest, RebuildReplacesBuckets) {
+  EnemyGrid grid;
+  grid.Build(kBoard, {1, 2}, {1, 2});
+  grid.Build(kBoard, {2}, {2});
+  std::vector<size_t> out;
+  grid.CollectRect(0, 0, 3, 3, out);
+  EXPECT_EQ(out, (std::vector<size_t>{0}));
+}
+
+TEST(EnemyGridTest, FollowsTheBoardSize) {
+  EnemyGrid grid;
+  const BoardSize wide{300, 200};
+  grid.Build(wide, {299, 260, 2}, {199, 150, 2});
+  std::vector<size_t> out;
+  grid.CollectRect(250, 150, 400, 400, out);
+  EXPECT_EQ(out, (std::vector<size_t>{1, 0})); // row-major buckets
+
+  // Same cells on the default board: the old buckets are dropped.
+  grid.Build(kBoard, {2}, {2});
+  out.clear();
+  grid.CollectRect(0, 0, 400, 400, out);
+  EXPECT_EQ(out, (std::vector<size_t>{0}));
+}
+
+TEST(EnemyGridTest, EnemyThatChangesCellMovesBucket) {
+  EnemyGrid grid;
+  grid.Build(kBoard, {1, 5}, {1, 5});
+  grid.Build(kBoard, {1, 6}, {1, 5});
+  std::vector<size_t> out;
+  grid.CollectCell({5, 5}, out);
+  EXPECT_TRUE(out.empty());
+  grid.CollectCell({6, 5}, out);
+  EXPECT_EQ(out, (std::vector<size_t>{1}));
+}
+
+TEST(EnemyGridTest, RowsOfALargeBoardStayApart) {
+  EnemyGrid grid;
+  const BoardSize large{kMaxBoardSide, kMaxBoardSide};
+  grid.Build(large, {kMaxBoardSide - 1, 0, 3},
+             {kMaxBoardSide - 2, kMaxBoardSide - 1, kMaxBoardSide - 1});
+  std::vector<size_t> out;
+  grid.CollectRect(0, kMaxBoardSide - 1, 3, kMaxBoardSide - 1, out);
+  EXPECT_EQ(out, (std::vector<size_t>{1, 2}));
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "sim/enemy_kernels.h"
+
+// Odd sizes so every variant runs both its vector body and scalar tail.
+constexpr size_t kCount = 37;
+
+TEST(EnemyKernelsTest, AdvanceMovesAwakeAndWakesSleepers) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> unit(0.0F, 1.0F);
+  std::vector<float> progress(kCount), speed(kCount), sleep(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    progress[i] = unit(rng) * 40.0F;
+    speed[i] = unit(rng) * 2.0F;
+    sleep[i] = i % 3 == 0 ? unit(rng) * 0.05F : 0.0F;
+  }
+  auto want_progress = progress;
+  auto want_sleep = sleep;
+  const float dt = 0.016F;
+  for (size_t i = 0; i < kCount; ++i) {
+    if (want_sleep[i] > 0.0F) {
+      want_sleep[i] = std::max(0.0F, want_sleep[i] - dt);
+      continue;
+    }
+    want_progress[i] += speed[i] * dt;
+  }
+
+  AdvanceEnemies(progress.data(), speed.data(), sleep.data(), kCount, dt);
+  EXPECT_EQ(progress, want_progress);
+  EXPECT_EQ(sleep, want_sleep);
+}
+
+TEST(EnemyKernelsTest, ZeroFinishedCountsEnemiesPastTheEnd) {
+  std::vector<float> progress(kCount);
+  std::vector<int> hp(kCount, 5);
+  for (size_t i = 0; i < kCount; ++i) {
+    progress[i] = static_cast<float>(i);
+  }
+  EXPECT_EQ(ZeroFinished(progress.data(), hp.data(), kCount, 30.0F), 7);
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(hp[i], i >= 30 ? 0 : 5) << i;
+  }
+}
+
+TEST(EnemyKernelsTest, KeepInRangeFiltersInOrder) {
+  std::vector<int> xs(kCount), ys(kCount);
+  std::vector<size_t> indices(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    xs[i] = static_cast<int>(i % 9);
+    ys[i] = static_cast<int>(i / 9);
+    indices[i] = kCount - 1 - i; // reversed to check order is kept
+  }
+  const float cx = 4.0F;
+  const float cy = 2.0F;
+  const float range2 = 2.5F * 2.5F;
+  std::vector<size_t> want;
+  for (size_t i : indices) {
+    const float dx = cx - static_cast<float>(xs[i]);
+    const float dy = cy - static_cast<float>(ys[i]);
+    if (dx * dx + dy * dy <= range2) {
+      want.push_back(i);
+    }
+  }
+
+  const size_t kept = KeepInRange(xs.data(), ys.data(), indices.data(),
+                                  kCount, cx, cy, range2);
+  indices.resize(kept);
+  EXPECT_FALSE(want.empty());
+  EXPECT_EQ(indices, want);
+}
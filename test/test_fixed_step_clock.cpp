@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "sim/fixed_step_clock.h"
+
+using std::chrono::milliseconds;
+
+TEST(FixedStepClockTest, CarriesPartialPeriods) {
+  FixedStepClock clock(milliseconds(16));
+  EXPECT_EQ(clock.Advance(milliseconds(10)), 0);
+  EXPECT_EQ(clock.Advance(milliseconds(10)), 1);
+  EXPECT_EQ(clock.backlog(), milliseconds(4));
+  EXPECT_EQ(clock.Advance(milliseconds(28)), 2);
+  EXPECT_EQ(clock.backlog(), milliseconds(0));
+}
+
+TEST(FixedStepClockTest, CapsCatchUpAndDropsTheRest) {
+  FixedStepClock clock(milliseconds(16), 5);
+  EXPECT_EQ(clock.Advance(milliseconds(1000)), 5);
+  EXPECT_EQ(clock.dropped_periods(), 57);
+  EXPECT_EQ(clock.backlog(), milliseconds(8));
+  EXPECT_EQ(clock.Advance(milliseconds(8)), 1);
+}
+
+TEST(FixedStepClockTest, IgnoresNegativeElapsed) {
+  FixedStepClock clock(milliseconds(16));
+  EXPECT_EQ(clock.Advance(milliseconds(-50)), 0);
+  EXPECT_EQ(clock.backlog(), milliseconds(0));
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "sim/frame_ticker.h"
+
+using std::chrono::milliseconds;
+
+namespace {
+
+// Counts posts and hands each frame straight back, as the UI thread would.
+struct CountingTicker {
+  std::atomic<int> posts{0};
+  FrameTicker ticker{milliseconds(2), [this] {
+                       ++posts;
+                       ticker.Handled();
+                     }};
+};
+
+// Waits up to a second for `posts` to reach `count`.
+bool WaitForPosts(const std::atomic<int> &posts, int count) {
+  const auto give_up = std::chrono::steady_clock::now() + milliseconds(1000);
+  while (posts < count) {
+    if (std::chrono::steady_clock::now() > give_up) {
+      return false;
+    }
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  return true;
+}
+
+} // namespace
+
+TEST(FrameTickerTest, PostsWhileRunning) {
+  CountingTicker t;
+  EXPECT_TRUE(t.ticker.running());
+  EXPECT_TRUE(WaitForPosts(t.posts, 5));
+}
+
+TEST(FrameTickerTest, SleepsUntilWoken) {
+  CountingTicker t;
+  t.ticker.Sleep();
+  EXPECT_FALSE(t.ticker.running());
+  std::this_thread::sleep_for(milliseconds(5)); // a post already on its way
+  const int before = t.posts;
+  std::this_thread::sleep_for(milliseconds(50));
+  EXPECT_EQ(t.posts, before);
+
+  t.ticker.Wake();
+  EXPECT_TRUE(WaitForPosts(t.posts, before + 1));
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_EQ(t.posts, before + 1);
+}
+
+TEST(FrameTickerTest, PostsOnceAtTheDeadline) {
+  CountingTicker t;
+  t.ticker.Sleep();
+  std::this_thread::sleep_for(milliseconds(5));
+  const int before = t.posts;
+  const auto deadline = std::chrono::steady_clock::now() + milliseconds(30);
+  t.ticker.Sleep(deadline);
+  EXPECT_TRUE(WaitForPosts(t.posts, before + 1));
+  EXPECT_GE(std::chrono::steady_clock::now(), deadline);
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_EQ(t.posts, before + 1);
+}
+
+TEST(FrameTickerTest, HoldsPostsUntilHandled) {
+  std::atomic<int> posts{0};
+  FrameTicker ticker(milliseconds(1), [&] { ++posts; });
+  EXPECT_TRUE(WaitForPosts(posts, 1));
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_EQ(posts, 1);
+  ticker.Handled();
+  EXPECT_TRUE(WaitForPosts(posts, 2));
+}
+
+TEST(FrameTickerTest, KeepsAWakeThatArrivesWhileAFrameIsPending) {
+  std::atomic<int> posts{0};
+  FrameTicker ticker(milliseconds(1), [&] { ++posts; });
+  EXPECT_TRUE(WaitForPosts(posts, 1));
+  ticker.Sleep();
+  ticker.Wake(); // the posted frame may predate what this reports
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_EQ(posts, 1);
+  ticker.Handled();
+  EXPECT_TRUE(WaitForPosts(posts, 2));
+  ticker.Handled();
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_EQ(posts, 2); // asleep again
+}
+
+TEST(FrameTickerTest, KeepsADeadlineThatPassesWhileAFrameIsPending) {
+  std::atomic<int> posts{0};
+  FrameTicker ticker(milliseconds(1), [&] { ++posts; });
+  EXPECT_TRUE(WaitForPosts(posts, 1));
+  ticker.Sleep(std::chrono::steady_clock::now() + milliseconds(5));
+  std::this_thread::sleep_for(milliseconds(20));
+  EXPECT_EQ(posts, 1);
+  ticker.Handled();
+  EXPECT_TRUE(WaitForPosts(posts, 2));
+}
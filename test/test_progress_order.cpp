@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "sim/progress_order.h"
+
+namespace {
+
+std::vector<uint32_t> Order(const ProgressOrder &order) {
+  return {order.order().begin(), order.order().end()};
+}
+
+} // namespace
+
+TEST(ProgressOrderTest, FurthestFirstWithTiesByIndex) {
+  ProgressOrder order;
+  order.Build({2.0F, 7.5F, 2.0F, 0.0F, 7.5F});
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{1, 4, 0, 2, 3}));
+  for (uint32_t r = 0; r < order.order().size(); ++r) {
+    EXPECT_EQ(order.rank(order.order()[r]), r);
+  }
+}
+
+TEST(ProgressOrderTest, RebuildFollowsOvertakesAndCountChanges) {
+  ProgressOrder order;
+  order.Build({1.0F, 2.0F, 3.0F});
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{2, 1, 0}));
+  order.Build({4.0F, 2.5F, 3.5F}); // enemy 0 overtakes both
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{0, 2, 1}));
+  EXPECT_EQ(order.rank(1), 2U);
+  order.Build({4.0F, 3.5F});
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{0, 1}));
+  order.Build({});
+  EXPECT_TRUE(order.order().empty());
+}
+
+TEST(ProgressOrderTest, RemoveDeadRenumbersLikeTheStore) {
+  ProgressOrder order;
+  order.Build({5.0F, 1.0F, 4.0F, 3.0F, 2.0F});
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{0, 2, 3, 4, 1}));
+  order.RemoveDead({7, 0, 7, 0, 7}); // enemies 1 and 3 die
+  // Survivors 0, 2, 4 are now 0, 1, 2 and keep their order.
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{0, 1, 2}));
+  order.Build({5.0F, 4.0F, 2.0F});
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{0, 1, 2}));
+  EXPECT_EQ(order.rank(2), 2U);
+}
+
+TEST(ProgressOrderTest, SpawnsJoinWhereTheirProgressPutsThem) {
+  ProgressOrder order;
+  order.Build({3.0F, 1.0F});
+  order.Build({3.0F, 1.0F, 0.0F, 2.0F}); // two spawns, one already ahead
+  EXPECT_EQ(Order(order), (std::vector<uint32_t>{0, 3, 1, 2}));
+  EXPECT_EQ(order.rank(3), 1U);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "sim/raster.h"
+#include "sim/rng.h"
+
+namespace {
+
+using Cells = std::set<std::pair<int, int>>;
+
+Cells RingByScan(const Vec2 &center, float radius, const CellRect &clip) {
+  Cells cells;
+  for (int y = clip.y0; y <= clip.y1; ++y) {
+    for (int x = clip.x0; x <= clip.x1; ++x) {
+      const float dx = center.x - static_cast<float>(x);
+      const float dy = center.y - static_cast<float>(y);
+      if (std::abs(std::sqrt(dx * dx + dy * dy) - radius) < 0.6F) {
+        cells.insert({x, y});
+      }
+    }
+  }
+  return cells;
+}
+
+} // namespace
+
+TEST(RasterTest, RingSpansMatchAFullScan) {
+  Rng rng;
+  rng.Seed(7);
+  const CellRect clip{-3, 2, 60, 40};
+  for (int i = 0; i < 500; ++i) {
+    const Vec2 center{rng.Uniform(-5.0F, 60.0F), rng.Uniform(0.0F, 45.0F)};
+    // Whole and half cells too, where ring edges land on cell centres.
+    const float radius = i % 3 == 0 ? static_cast<float>(i % 40) * 0.5F
+                                    : rng.Uniform(0.0F, 35.0F);
+    Cells spans;
+    int previous_y = clip.y0 - 1;
+    ForRingSpans(center, radius, 0.6F, clip, [&](int y, int x0, int x1) {
+      EXPECT_GE(y, previous_y);
+      EXPECT_LT(x0, x1);
+      previous_y = y;
+      for (int x = x0; x < x1; ++x) {
+        EXPECT_TRUE(spans.insert({x, y}).second) << "cell twice";
+      }
+    });
+    EXPECT_EQ(spans, RingByScan(center, radius, clip))
+        << center.x << "," << center.y << " r=" << radius;
+  }
+}
+
+TEST(RasterTest, LineIsUnbrokenAndClipsLikeAFilter) {
+  const CellRect board{0, 0, 47, 27};
+  const CellRect window{10, 5, 29, 14};
+  Rng rng;
+  rng.Seed(3);
+  for (int i = 0; i < 300; ++i) {
+    const Position from{rng.UniformInt(0, 47), rng.UniformInt(0, 27)};
+    const Position to{rng.UniformInt(0, 47), rng.UniformInt(0, 27)};
+    std::vector<Position> line;
+    ForLineCells(from, to, board,
+                 [&](int x, int y) { line.push_back({x, y}); });
+    ASSERT_FALSE(line.empty());
+    EXPECT_EQ(line.front().x, from.x);
+    EXPECT_EQ(line.front().y, from.y);
+    EXPECT_EQ(line.back().x, to.x);
+    EXPECT_EQ(line.back().y, to.y);
+    const size_t steps = static_cast<size_t>(
+        std::max(std::abs(to.x - from.x), std::abs(to.y - from.y)));
+    EXPECT_EQ(line.size(), steps + 1);
+    for (size_t k = 1; k < line.size(); ++k) {
+      EXPECT_LE(std::abs(line[k].x - line[k - 1].x), 1);
+      EXPECT_LE(std::abs(line[k].y - line[k - 1].y), 1);
+    }
+
+    std::vector<Position> expected;
+    for (const auto &p : line) {
+      if (window.Contains(p.x, p.y)) {
+        expected.push_back(p);
+      }
+    }
+    std::vector<Position> clipped;
+    ForLineCells(from, to, window,
+                 [&](int x, int y) { clipped.push_back({x, y}); });
+    ASSERT_EQ(clipped.size(), expected.size());
+    for (size_t k = 0; k < clipped.size(); ++k) {
+      EXPECT_EQ(clipped[k].x, expected[k].x);
+      EXPECT_EQ(clipped[k].y, expected[k].y);
+    }
+  }
+}
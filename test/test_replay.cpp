@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sim/replay.h"
+#include "sim/rng.h"
+
+namespace {
+
+InputEvent Event(uint64_t tick, InputEvent::Kind kind, Position pos = {},
+                 Tower::Type type = Tower::Type::Default, bool flag = false) {
+  InputEvent e;
+  e.tick = tick;
+  e.kind = kind;
+  e.type = type;
+  e.pos = pos;
+  e.flag = flag;
+  return e;
+}
+
+bool SameEvent(const InputEvent &a, const InputEvent &b) {
+  return a.tick == b.tick && a.kind == b.kind && a.type == b.type &&
+         a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.flag == b.flag;
+}
+
+std::string Encode(const ReplayLog &log) {
+  std::ostringstream out;
+  ReplayWriter writer(out, log.seed, log.dev_mode);
+  for (const auto &e : log.events) {
+    writer.Record(e);
+  }
+  writer.Finish(log.end_tick);
+  return out.str();
+}
+
+ReplayLog SampleLog() {
+  using Kind = InputEvent::Kind;
+  ReplayLog log;
+  log.seed = 0x0123456789ABCDEFULL;
+  log.dev_mode = true;
+  log.events = {
+      Event(0, Kind::Unlock, {}, Tower::Type::Thunder),
+      Event(0, Kind::PlaceTower, {6, 15}, Tower::Type::Thunder),
+      Event(3, Kind::PlaceTower, {20, 3}, Tower::Type::Default),
+      Event(5, Kind::SetAutoWaves, {}, Tower::Type::Default, true),
+      Event(5, Kind::StartWave),
+      Event(400, Kind::UpgradeTower, {6, 15}),
+      Event(900, Kind::SetFastForward, {}, Tower::Type::Default, true),
+      Event(1500, Kind::PickUpTower, {20, 3}),
+      Event(1501, Kind::PlaceHeld, {30, 10}),
+      Event(2600, Kind::SellTower, {30, 10}),
+  };
+  log.end_tick = 4000;
+  return log;
+}
+
+} // namespace
+
+TEST(RngTest, MatchesPcg32Reference) {
+  // First outputs of the PCG reference demo (seed 42, stream 54).
+  Rng rng;
+  rng.Seed(42, 54);
+  EXPECT_EQ(rng.Next(), 0xa15c02b7U);
+  EXPECT_EQ(rng.Next(), 0x7b47f409U);
+  EXPECT_EQ(rng.Next(), 0xba1d3330U);
+
+  for (int i = 0; i < 1000; ++i) {
+    const int v = rng.UniformInt(-3, 3);
+    EXPECT_GE(v, -3);
+    EXPECT_LE(v, 3);
+    const float f = rng.Uniform(0.5F, 2.0F);
+    EXPECT_GE(f, 0.5F);
+    EXPECT_LT(f, 2.0F);
+  }
+}
+
+TEST(ReplayTest, LogRoundTrips) {
+  const ReplayLog log = SampleLog();
+  std::istringstream in(Encode(log));
+  const auto read = ReadReplay(in, "test");
+  ASSERT_TRUE(read.has_value());
+  EXPECT_EQ(read->seed, log.seed);
+  EXPECT_TRUE(read->dev_mode);
+  EXPECT_EQ(read->end_tick, log.end_tick);
+  ASSERT_EQ(read->events.size(), log.events.size());
+  for (size_t i = 0; i < log.events.size(); ++i) {
+    EXPECT_TRUE(SameEvent(read->events[i], log.events[i])) << "event " << i;
+  }
+}
+
+TEST(ReplayTest, TruncatedLogKeepsCompleteEvents) {
+  const ReplayLog log = SampleLog();
+  const std::string bytes = Encode(log);
+  // Drop the end marker (delta + tag) and half of the last event.
+  std::istringstream in(bytes.substr(0, bytes.size() - 4));
+  const auto read = ReadReplay(in, "test");
+  ASSERT_TRUE(read.has_value());
+  ASSERT_EQ(read->events.size(), log.events.size() - 1);
+  EXPECT_EQ(read->end_tick, log.events[log.events.size() - 2].tick);
+
+  std::istringstream garbage("not a replay");
+  EXPECT_FALSE(ReadReplay(garbage, "test").has_value());
+}
+
+TEST(ReplayTest, ReplayReproducesLiveSession) {
+  const ReplayLog log = SampleLog();
+  Simulation live(log.dev_mode);
+  live.Seed(log.seed);
+  size_t next = 0;
+  for (uint64_t tick = 0; tick < log.end_tick; ++tick) {
+    for (; next < log.events.size() && log.events[next].tick == tick; ++next) {
+      ApplyInput(live, log.events[next]);
+    }
+    live.Tick();
+  }
+
+  const HeadlessResult replayed = RunReplay(log);
+  EXPECT_GT(live.wave(), 1);
+  EXPECT_EQ(replayed.wave, live.wave());
+  EXPECT_EQ(replayed.map_index, live.map_index());
+  EXPECT_EQ(replayed.lives, live.lives());
+  EXPECT_EQ(replayed.kibbles, live.kibbles());
+  EXPECT_EQ(replayed.ticks, static_cast<long long>(log.end_tick));
+  EXPECT_EQ(RunReplay(log, 2).kibbles, replayed.kibbles);
+}
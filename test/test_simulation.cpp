@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+#include "sim/definitions.h"
+#include "sim/simulation.h"
+
+namespace {
+
+// Runs ticks until the current wave is fully spawned and resolved.
+void RunWave(Simulation &sim, int max_ticks = 100000) {
+  sim.StartWave();
+  for (int i = 0; i < max_ticks && sim.wave_active() && !sim.game_over();
+       ++i) {
+    sim.Tick();
+  }
+}
+
+} // namespace
+
+TEST(SimulationTest, StartsWithKibblesAndLives) {
+  Simulation sim;
+  EXPECT_EQ(sim.kibbles(), kStartingKibbles);
+  EXPECT_EQ(sim.lives(), kStartingLives);
+  EXPECT_EQ(sim.wave(), 0);
+  EXPECT_FALSE(sim.path().empty());
+}
+
+TEST(SimulationTest, PlacingTowerSpendsKibbles) {
+  Simulation sim;
+  const int cost = GetDef(Tower::Type::Default).cost;
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}), PlaceResult::Placed);
+  EXPECT_EQ(sim.kibbles(), kStartingKibbles - cost);
+  ASSERT_EQ(sim.towers().size(), 1U);
+  EXPECT_TRUE(sim.TowerIndexAt({3, 3}).has_value());
+}
+
+TEST(SimulationTest, IdleOnlyWhenTicksChangeNothing) {
+  Simulation sim;
+  EXPECT_TRUE(sim.Idle());
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}), PlaceResult::Placed);
+  EXPECT_FALSE(sim.Idle()); // the new tower is cooling down
+  for (int i = 0; i < 1000 && !sim.Idle(); ++i) {
+    sim.Tick();
+  }
+  EXPECT_TRUE(sim.Idle());
+  sim.StartWave();
+  EXPECT_FALSE(sim.Idle());
+}
+
+TEST(SimulationTest, CannotPlaceOnPathOrOtherTower) {
+  Simulation sim;
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Default, sim.path().front()),
+            PlaceResult::Blocked);
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}), PlaceResult::Placed);
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}),
+            PlaceResult::Blocked);
+}
+
+TEST(SimulationTest, LockedTowersNeedUnlocking) {
+  Simulation sim;
+  EXPECT_FALSE(sim.IsUnlocked(Tower::Type::Thunder));
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Thunder, {3, 3}),
+            PlaceResult::Locked);
+
+  Simulation dev(/*dev_mode=*/true);
+  EXPECT_TRUE(dev.TryUnlock(Tower::Type::Thunder));
+  EXPECT_EQ(dev.PlaceTower(Tower::Type::Thunder, {3, 3}),
+            PlaceResult::Placed);
+}
+
+TEST(SimulationTest, CatatonicRangesMayNotOverlap) {
+  Simulation sim(/*dev_mode=*/true);
+  ASSERT_TRUE(sim.TryUnlock(Tower::Type::Catatonic));
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Catatonic, {3, 3}),
+            PlaceResult::Placed);
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Catatonic, {5, 3}),
+            PlaceResult::CatatonicConflict);
+}
+
+TEST(SimulationTest, SellingRefundsSixtyPercent) {
+  Simulation sim;
+  const int cost = GetDef(Tower::Type::Default).cost;
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}), PlaceResult::Placed);
+  EXPECT_TRUE(sim.SellTowerAt({3, 3}));
+  EXPECT_TRUE(sim.towers().empty());
+  EXPECT_EQ(sim.kibbles(),
+            kStartingKibbles - cost +
+                static_cast<int>(std::round(static_cast<float>(cost) * 0.6F)));
+}
+
+TEST(SimulationTest, MovedAndSoldTowersFreeTheirCells) {
+  Simulation sim(/*dev_mode=*/true);
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}), PlaceResult::Placed);
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Default, {7, 3}), PlaceResult::Placed);
+  ASSERT_TRUE(sim.PickUpTower({3, 3}));
+  EXPECT_FALSE(sim.TowerIndexAt({3, 3}).has_value());
+  EXPECT_EQ(sim.TowerIndexAt({7, 3}), 0U);
+  ASSERT_EQ(sim.PlaceHeld({3, 5}), PlaceResult::Placed);
+  EXPECT_EQ(sim.TowerIndexAt({3, 5}), 1U);
+
+  EXPECT_TRUE(sim.SellTowerAt({7, 3}));
+  EXPECT_EQ(sim.TowerIndexAt({3, 5}), 0U);
+  EXPECT_EQ(sim.PlaceTower(Tower::Type::Default, {7, 3}), PlaceResult::Placed);
+}
+
+TEST(SimulationTest, UpgradeCostsDoubleAndExtendsRange) {
+  Simulation sim(/*dev_mode=*/true);
+  const TowerDef def = GetDef(Tower::Type::Default);
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Default, {3, 3}), PlaceResult::Placed);
+  const int before = sim.kibbles();
+  EXPECT_TRUE(sim.UpgradeTowerAt({3, 3}));
+  EXPECT_EQ(sim.kibbles(), before - def.cost * 2);
+  EXPECT_TRUE(sim.towers().front().upgraded);
+  EXPECT_GT(sim.towers().front().range, def.range);
+  EXPECT_FALSE(sim.UpgradeTowerAt({3, 3}));
+}
+
+TEST(SimulationTest, UnguardedWaveCostsLives) {
+  Simulation sim;
+  RunWave(sim);
+  EXPECT_EQ(sim.wave(), 1);
+  EXPECT_FALSE(sim.wave_active());
+  EXPECT_LT(sim.lives(), kStartingLives);
+  EXPECT_TRUE(sim.enemies().empty());
+}
+
+TEST(SimulationTest, EnemyAtPathEndCostsOneLife) {
+  Simulation sim;
+  Enemy e;
+  e.path_progress = static_cast<float>(sim.path().size());
+  sim.AddEnemy(e);
+  sim.MoveEnemies();
+  sim.Cleanup();
+  EXPECT_EQ(sim.lives(), kStartingLives - 1);
+  EXPECT_TRUE(sim.enemies().empty());
+}
+
+TEST(SimulationTest, TowerShootsEnemyInRange) {
+  Simulation sim;
+  const Position start = sim.path().front();
+  Tower t;
+  t.pos = {start.x, start.y - 1};
+  t.home = t.pos;
+  sim.AddTower(t);
+  Enemy e;
+  e.hp = 100;
+  e.max_hp = 100;
+  sim.AddEnemy(e);
+  for (int i = 0; i < 30; ++i) {
+    sim.TowersAct();
+    sim.MoveProjectiles();
+    sim.ResolveProjectiles();
+  }
+  EXPECT_LT(sim.enemies().hp.front(), 100);
+}
+
+TEST(SimulationTest, LaserBeamRunsToTheBoardEdge) {
+  Simulation sim(/*dev_mode=*/true);
+  const Position start = sim.path().front();
+  ASSERT_EQ(sim.PlaceTower(Tower::Type::Thunder, {start.x + 4, start.y - 3}),
+            PlaceResult::Placed);
+  Enemy e;
+  e.hp = 1000;
+  e.max_hp = 1000;
+  sim.AddEnemy(e);
+  for (int i = 0; i < 300 && sim.beams().empty(); ++i) {
+    sim.TowersAct(); // well past one cooldown
+  }
+  ASSERT_FALSE(sim.beams().empty());
+  const Beam &beam = sim.beams().front();
+  EXPECT_EQ(beam.from.x, start.x + 4);
+  EXPECT_EQ(beam.from.y, start.y - 3);
+  const BoardSize &board = sim.board();
+  ASSERT_TRUE(board.Contains(beam.to));
+  EXPECT_TRUE(beam.to.x == 0 || beam.to.y == 0 ||
+              beam.to.x == board.width - 1 || beam.to.y == board.height - 1);
+  EXPECT_LT(beam.to.x, beam.from.x); // aimed through the enemy at the start
+}
+
+TEST(SimulationTest, FailedWaveIsGameOver) {
+  Simulation sim;
+  for (int i = 0; i < 20 && !sim.game_over(); ++i) {
+    RunWave(sim);
+  }
+  EXPECT_TRUE(sim.game_over());
+  EXPECT_EQ(sim.lives(), 0);
+}
+
+TEST(SimulationTest, TowerTargetsEnemyFurthestAlongPath) {
+  Simulation sim;
+  const auto &path = sim.path();
+  Tower t;
+  t.pos = {path[4].x, path[4].y - 1};
+  t.home = t.pos;
+  t.range = 3.0F;
+  t.damage = 1;
+  sim.AddTower(t);
+  // In range at cells 2 and 5; the far-off enemy is furthest along.
+  for (float progress : {2.0F, 5.0F, static_cast<float>(path.size() - 2)}) {
+    Enemy e;
+    e.path_progress = progress;
+    e.hp = 10;
+    e.max_hp = 10;
+    sim.AddEnemy(e);
+  }
+  sim.TowersAct();
+  ASSERT_EQ(sim.projectiles().size(), 1U);
+  const Position aim = sim.projectiles().front().target;
+  const Position expected = sim.EnemyCellAt(1);
+  EXPECT_EQ(aim.x, expected.x);
+  EXPECT_EQ(aim.y, expected.y);
+}
+
+TEST(SimulationTest, UpcomingMusicCoversTheLastTwoWavesOfAMap) {
+  Simulation sim(/*dev_mode=*/true);
+  for (int y = 1; y < kBoardHeight; y += 3) {
+    for (int x = 1; x < kBoardWidth; x += 3) {
+      sim.PlaceTower(Tower::Type::Galactic, {x, y});
+    }
+  }
+  EXPECT_FALSE(sim.UpcomingMusic().has_value());
+  while (sim.wave() < 8) {
+    RunWave(sim);
+    EXPECT_FALSE(sim.UpcomingMusic().has_value()) << "wave " << sim.wave();
+  }
+  sim.StartWave();
+  EXPECT_EQ(sim.UpcomingMusic(), std::optional<int>(1));
+  RunWave(sim); // waiting for wave 10 still counts
+  EXPECT_EQ(sim.UpcomingMusic(), std::optional<int>(1));
+  ASSERT_FALSE(sim.game_over());
+
+  sim.AdvanceMap(/*dev_skip=*/true);
+  EXPECT_FALSE(sim.UpcomingMusic().has_value());
+}
+
+TEST(SimulationTest, SwarmWavesSpawnAtOnce) {
+  Simulation sim;
+  WaveRules rules;
+  rules.swarm_every = 2;
+  sim.SetWaveRules(rules);
+  sim.StartWave();
+  sim.Tick();
+  EXPECT_EQ(sim.enemies().size(), 1U); // wave 1 trickles in
+  RunWave(sim);
+  sim.StartWave();
+  sim.SpawnTick();
+  const auto &progress = sim.enemies().path_progress;
+  ASSERT_EQ(progress.size(), static_cast<size_t>(6 + 2 * 2));
+  EXPECT_LT(progress.front(), progress.back());
+  EXPECT_LE(progress.back(), static_cast<float>(sim.path().size()) * 0.25F);
+}
+
+TEST(SimulationTest, EndlessPlayOutlastsTheLastMap) {
+  std::istringstream in(R"({"maps": [{"path": [[0, 3], [40, 3], [40, 20]]}]})");
+  const auto defs = ParseDefinitions(in, "test");
+  ASSERT_NE(defs, nullptr);
+  for (bool endless : {false, true}) {
+    Simulation sim(/*dev_mode=*/true, *defs);
+    sim.Seed(1);
+    WaveRules rules;
+    rules.endless = endless;
+    sim.SetWaveRules(rules);
+    for (int x = 1; x < 40; x += 3) {
+      sim.PlaceTower(Tower::Type::Galactic, {x, 5});
+      sim.UpgradeTowerAt({x, 5});
+    }
+    for (int i = 0; i < 11 && !sim.victory() && !sim.game_over(); ++i) {
+      RunWave(sim);
+    }
+    EXPECT_FALSE(sim.game_over());
+    EXPECT_EQ(sim.victory(), !endless);
+    EXPECT_EQ(sim.wave(), endless ? 11 : 10);
+    EXPECT_EQ(sim.map_index(), 0);
+    EXPECT_FALSE(sim.towers().empty()); // no map change cleared them
+  }
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "sim/simulation.h"
+#include "sim/snapshot.h"
+
+namespace {
+
+// A seeded dev game a little way into its first wave, with a mix of cats,
+// sturdy enemies and effects in flight.
+Simulation MidWaveWorld() {
+  Simulation sim(/*dev_mode=*/true);
+  sim.Seed(11);
+  const Tower::Type types[] = {Tower::Type::Galactic, Tower::Type::Fat,
+                               Tower::Type::Kitty, Tower::Type::Thunder,
+                               Tower::Type::Catatonic, Tower::Type::Default};
+  int placed = 0;
+  for (int y = 1; y < kBoardHeight; y += 4) {
+    for (int x = 1; x < kBoardWidth; x += 5) {
+      if (sim.PlaceTower(types[placed % 6], {x, y}) == PlaceResult::Placed) {
+        if (placed % 2 == 0) {
+          sim.UpgradeTowerAt({x, y});
+        }
+        ++placed;
+      }
+    }
+  }
+  sim.SetAutoWaves(true);
+  sim.StartWave();
+  for (int i = 0; i < 60; ++i) {
+    Enemy e;
+    e.path_progress = static_cast<float>(i);
+    e.hp = e.max_hp = 400;
+    e.type = static_cast<EnemyType>(i % 4);
+    e.lane_offset = i % 3 - 1;
+    sim.AddEnemy(e);
+  }
+  for (int i = 0; i < 120; ++i) {
+    sim.Tick();
+  }
+  return sim;
+}
+
+// saved with tower i moved to pos.
+std::vector<std::byte> WithTowerAt(std::vector<std::byte> saved, size_t i,
+                                   const Position &pos) {
+  SnapshotHeader header;
+  std::memcpy(&header, saved.data(), sizeof(header));
+  const SnapshotRange &towers =
+      header.sections[static_cast<size_t>(SnapshotSection::Towers)];
+  EXPECT_LT(i, towers.count);
+  std::byte *at = saved.data() + towers.offset + i * sizeof(SnapshotTower);
+  SnapshotTower record;
+  std::memcpy(&record, at, sizeof(record));
+  record.pos_x = pos.x;
+  record.pos_y = pos.y;
+  std::memcpy(at, &record, sizeof(record));
+  return saved;
+}
+
+} // namespace
+
+TEST(SnapshotTest, RestoredWorldPlaysOnIdentically) {
+  Simulation original = MidWaveWorld();
+  ASSERT_FALSE(original.enemies().empty());
+  ASSERT_FALSE(original.hit_splats().empty());
+  const std::vector<std::byte> saved = original.SaveSnapshot();
+  ASSERT_TRUE(SnapshotValid(saved));
+
+  Simulation restored; // different mode and seed until restored
+  ASSERT_TRUE(restored.RestoreSnapshot(saved));
+  EXPECT_TRUE(restored.dev_mode());
+  EXPECT_EQ(restored.SaveSnapshot(), saved);
+
+  for (int i = 0; i < 3000; ++i) {
+    original.Tick();
+    restored.Tick();
+  }
+  EXPECT_NE(original.SaveSnapshot(), saved); // the world moved on
+  EXPECT_EQ(restored.wave(), original.wave());
+  EXPECT_EQ(restored.kibbles(), original.kibbles());
+  EXPECT_EQ(restored.lives(), original.lives());
+  EXPECT_EQ(restored.SaveSnapshot(), original.SaveSnapshot());
+}
+
+TEST(SnapshotTest, RejectsMalformedData) {
+  const Simulation source = MidWaveWorld();
+  const std::vector<std::byte> saved = source.SaveSnapshot();
+  Simulation sim;
+  const auto before = sim.SaveSnapshot();
+
+  const std::span<const std::byte> all(saved);
+  EXPECT_FALSE(sim.RestoreSnapshot(all.first(all.size() - 8)));
+  auto bad_magic = saved;
+  bad_magic[0] = std::byte{'X'};
+  EXPECT_FALSE(sim.RestoreSnapshot(bad_magic));
+  auto bad_map = saved;
+  SnapshotHeader header;
+  std::memcpy(&header, bad_map.data(), sizeof(header));
+  header.map_index = 99;
+  std::memcpy(bad_map.data(), &header, sizeof(header));
+  EXPECT_TRUE(SnapshotValid(bad_map));
+  EXPECT_FALSE(sim.RestoreSnapshot(bad_map));
+
+  EXPECT_EQ(sim.SaveSnapshot(), before);
+}
+
+TEST(SnapshotTest, FileRoundTrip) {
+  const Simulation source = MidWaveWorld();
+  const auto path =
+      (std::filesystem::temp_directory_path() / "catcat_snapshot_test.snap")
+          .string();
+  ASSERT_TRUE(WriteSnapshotFile(source, path));
+  Simulation loaded;
+  ASSERT_TRUE(LoadSnapshotFile(loaded, path));
+  EXPECT_EQ(loaded.SaveSnapshot(), source.SaveSnapshot());
+  std::filesystem::remove(path);
+  EXPECT_FALSE(LoadSnapshotFile(loaded, path));
+}
+
+TEST(SnapshotTest, RejectsTowersOnThePathOrOnEachOther) {
+  const Simulation source = MidWaveWorld();
+  const std::vector<std::byte> saved = source.SaveSnapshot();
+  ASSERT_GE(source.towers().size(), 2U);
+  Simulation sim;
+  const auto before = sim.SaveSnapshot();
+
+  EXPECT_FALSE(sim.RestoreSnapshot(
+      WithTowerAt(saved, 1, source.towers()[0].pos)));
+  EXPECT_FALSE(sim.RestoreSnapshot(WithTowerAt(saved, 0, source.path()[3])));
+  EXPECT_EQ(sim.SaveSnapshot(), before);
+  EXPECT_TRUE(sim.RestoreSnapshot(saved));
+}
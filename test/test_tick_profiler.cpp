@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "sim/simulation.h"
+#include "sim/tick_profiler.h"
+
+using Phase = TickProfiler::Phase;
+
+TEST(TickProfilerTest, RollingPercentilesCoverTheWindow) {
+  TickProfiler profiler;
+  const auto t0 = TickProfiler::Clock::time_point{};
+  // Older samples fall out of the window: only 1..kWindow us remain.
+  for (int i = 0; i < 100; ++i) {
+    profiler.Record(Phase::MoveEnemies, t0, t0 + std::chrono::seconds(1));
+  }
+  for (size_t i = 1; i <= TickProfiler::kWindow; ++i) {
+    profiler.Record(Phase::MoveEnemies, t0,
+                    t0 + std::chrono::microseconds(i));
+  }
+  const auto stats = profiler.PhaseStats(Phase::MoveEnemies);
+  EXPECT_EQ(stats.samples, TickProfiler::kWindow);
+  EXPECT_DOUBLE_EQ(stats.p50_us, 120.0);
+  EXPECT_DOUBLE_EQ(stats.p99_us, 237.0);
+  EXPECT_EQ(profiler.PhaseStats(Phase::Render).samples, 0U);
+}
+
+TEST(TickProfilerTest, TraceHasEveryPhaseOfEveryTick) {
+  TickProfiler profiler;
+  profiler.StartTrace();
+  Simulation sim(/*dev_mode=*/true);
+  sim.SetProfiler(&profiler);
+  sim.StartWave();
+  constexpr int kTicks = 5;
+  for (int i = 0; i < kTicks; ++i) {
+    sim.Tick();
+  }
+  EXPECT_EQ(profiler.PhaseStats(Phase::TowersAct).samples,
+            static_cast<size_t>(kTicks));
+
+  std::ostringstream out;
+  profiler.WriteTrace(out);
+  const auto trace = nlohmann::json::parse(out.str());
+  const auto &events = trace.at("traceEvents");
+  // Every phase but Render, once per tick.
+  ASSERT_EQ(events.size(), kTicks * (TickProfiler::kPhaseCount - 1));
+  EXPECT_EQ(events[0].at("name"), "SpawnTick");
+  EXPECT_EQ(events[0].at("ph"), "X");
+  EXPECT_GE(events[0].at("dur").get<double>(), 0.0);
+
+  profiler.StartTrace(/*max_events=*/3);
+  sim.Tick();
+  EXPECT_EQ(profiler.trace_size(), 3U);
+  EXPECT_FALSE(profiler.tracing());
+}
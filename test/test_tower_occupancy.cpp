@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include "sim/tower_occupancy.h"
+
+TEST(TowerOccupancyTest, OwnersFollowAddAndRemove) {
+  TowerOccupancy cells;
+  cells.Add(0, {2, 3}, 2);
+  cells.Add(1, {kBoardWidth - 1, 0}, 3); // clipped to the board
+  EXPECT_EQ(cells.OwnerAt({3, 4}), 0U);
+  EXPECT_EQ(cells.OwnerAt({kBoardWidth - 1, 2}), 1U);
+  EXPECT_FALSE(cells.OwnerAt({4, 3}).has_value());
+  EXPECT_EQ(cells.occupied().Count(), 4 + 3);
+
+  cells.Remove(0, {2, 3}, 2);
+  EXPECT_FALSE(cells.OwnerAt({2, 3}).has_value());
+  EXPECT_FALSE(cells.AnyInRect(0, 0, 10, 10));
+}
+
+TEST(TowerOccupancyTest, EraseRenumbersLaterTowers) {
+  TowerOccupancy cells;
+  cells.Add(0, {0, 0}, 1);
+  cells.Add(1, {5, 5}, 1);
+  cells.Add(2, {9, 9}, 2);
+  cells.Erase(1, {5, 5}, 1);
+  EXPECT_EQ(cells.OwnerAt({0, 0}), 0U);
+  EXPECT_FALSE(cells.OwnerAt({5, 5}).has_value());
+  EXPECT_EQ(cells.OwnerAt({10, 10}), 1U);
+}
+
+TEST(TowerOccupancyTest, ClearCoversANewBoard) {
+  TowerOccupancy cells;
+  cells.Add(0, {2, 3}, 2);
+  cells.Clear(BoardSize{500, 400});
+  EXPECT_FALSE(cells.AnyInRect(0, 0, 499, 399));
+  cells.Add(3, {498, 398}, 2);
+  EXPECT_EQ(cells.OwnerAt({499, 399}), 3U);
+  EXPECT_EQ(cells.occupied().Count(), 4);
+}
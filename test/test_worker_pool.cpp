@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "sim/simulation.h"
+#include "sim/worker_pool.h"
+
+TEST(WorkerPoolTest, VisitsEveryIndexOnce) {
+  WorkerPool pool(4);
+  for (size_t count : {0U, 1U, 7U, 1000U}) {
+    std::vector<std::atomic<int>> seen(count);
+    pool.ParallelFor(count, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        seen[i].fetch_add(1);
+      }
+    });
+    for (const auto &s : seen) {
+      EXPECT_EQ(s.load(), 1);
+    }
+  }
+}
+
+// Planning on a pool must not change what the towers do.
+TEST(WorkerPoolTest, PooledTowersMatchSerial) {
+  Simulation serial(/*dev_mode=*/true);
+  for (const auto &def : SortedDefs()) {
+    serial.TryUnlock(def.type);
+  }
+  const Tower::Type types[] = {Tower::Type::Default, Tower::Type::Thunder,
+                               Tower::Type::Fat, Tower::Type::Galactic};
+  int placed = 0;
+  for (int y = 0; y < kBoardHeight; y += 2) {
+    for (int x = 0; x < kBoardWidth; x += 2) {
+      const auto type = types[placed % 4];
+      if (serial.PlaceTower(type, {x, y}) == PlaceResult::Placed) {
+        if (placed % 2 == 1) {
+          serial.UpgradeTowerAt({x, y});
+        }
+        ++placed;
+      }
+    }
+  }
+  ASSERT_GT(serial.towers().size(), kMinParallelPlans);
+
+  Simulation pooled = serial;
+  WorkerPool pool(3);
+  pooled.SetWorkerPool(&pool);
+  for (int wave = 1; wave <= 5; ++wave) {
+    serial.StartWave();
+    pooled.StartWave();
+    for (int i = 0; i < 5000 && serial.wave_active(); ++i) {
+      serial.Tick();
+      pooled.Tick();
+      ASSERT_EQ(serial.enemies().hp, pooled.enemies().hp)
+          << "wave " << wave << " tick " << i;
+      ASSERT_EQ(serial.kibbles(), pooled.kibbles())
+          << "wave " << wave << " tick " << i;
+    }
+  }
+}